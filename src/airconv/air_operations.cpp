@@ -91,7 +91,7 @@ AIRBuilderResult call_float_unary_op(std::string op, pvalue a) {
     using namespace llvm;
     auto &context = ctx.llvm;
     auto &module = ctx.module;
-    assert(a->getType()->getScalarType()->isFloatTy());
+    assert(a->getType()->getScalarType()->isFloatingPointTy());
     auto att = AttributeList::get(
       context, {{~0U, Attribute::get(context, Attribute::AttrKind::NoUnwind)},
                 {~0U, Attribute::get(context, Attribute::AttrKind::WillReturn)},
@@ -146,8 +146,8 @@ AIRBuilderResult call_float_binop(std::string op, pvalue a, pvalue b) {
     using namespace llvm;
     auto &context = ctx.llvm;
     auto &module = ctx.module;
-    assert(a->getType()->getScalarType()->isFloatTy());
-    assert(b->getType()->getScalarType()->isFloatTy());
+    assert(a->getType()->getScalarType()->isFloatingPointTy());
+    assert(b->getType()->getScalarType()->isFloatingPointTy());
     assert(a->getType() == b->getType());
     auto att = AttributeList::get(
       context, {{~0U, Attribute::get(context, Attribute::AttrKind::NoUnwind)},
@@ -171,19 +171,21 @@ AIRBuilderResult call_dot_product(uint32_t dimension, pvalue a, pvalue b) {
     using namespace llvm;
     auto &context = ctx.llvm;
     auto &module = ctx.module;
-    auto &types = ctx.types;
     auto att = AttributeList::get(
       context, {{~0U, Attribute::get(context, Attribute::AttrKind::NoUnwind)},
                 {~0U, Attribute::get(context, Attribute::AttrKind::WillReturn)},
                 {~0U, Attribute::get(context, Attribute::AttrKind::ReadNone)}}
     );
-    auto operand_type = dimension == 4   ? types._float4
-                        : dimension == 3 ? types._float3
-                                         : types._float2;
+    // float or half vector of `dimension` components
+    auto operand_type = a->getType();
+    assert(
+      llvm::cast<llvm::FixedVectorType>(operand_type)->getNumElements() ==
+      dimension
+    );
     auto fn = (module.getOrInsertFunction(
       "air.dot" + type_overload_suffix(operand_type),
       llvm::FunctionType::get(
-        types._float, {operand_type, operand_type}, false
+        operand_type->getScalarType(), {operand_type, operand_type}, false
       ),
       att
     ));
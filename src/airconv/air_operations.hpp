@@ -214,6 +214,10 @@ AIRBuilderResult pull_vec4_from_addr(
   MTLAttributeFormat format, pvalue base_addr, pvalue byte_offset
 );
 
+AIRBuilderResult pull_vec4_from_addr_checked(
+  MTLAttributeFormat format, pvalue base_addr, pvalue byte_offset
+);
+
 inline auto pure(pvalue value) {
   return make_op([=](auto) { return value; });
 }
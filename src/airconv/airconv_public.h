@@ -109,6 +109,18 @@ struct MTL_SHADER_REFLECTION {
   uint32_t NumPatchConstantOutputScalar;
   uint32_t ThreadsPerPatch;
   uint32_t ArgumentTableQwords;
+  /** pixel shader only: input registers (v#) declared by dcl_input_ps */
+  uint32_t InputRegisterMask;
+  /**
+  pixel shader only: input registers that can be linked to a constant output
+  of the previous stage (not evaluated with eval_*)
+  */
+  uint32_t ConstantInputRegisterMask;
+  /**
+  vertex shader only: user output registers (o#) that are only written with
+  literals outside of control flow
+  */
+  uint32_t ConstantOutputRegisterMask;
 };
 
 struct MTL_SHADER_BITCODE {
@@ -171,6 +183,8 @@ enum SM50_SHADER_COMPILATION_ARGUMENT_TYPE {
   SM50_SHADER_IA_INPUT_LAYOUT = 4,
   SM50_SHADER_GS_PASS_THROUGH = 5,
   SM50_SHADER_PSO_GEOMETRY_SHADER = 6,
+  SM50_SHADER_LINKED_OUTPUT_MASK = 7,
+  SM50_SHADER_LINKED_CONSTANT_INPUT = 8,
 };
 
 struct SM50_SHADER_COMPILATION_ARGUMENT_DATA {
@@ -184,6 +198,28 @@ struct SM50_SHADER_COMPILATION_INPUT_SIGN_MASK_DATA {
   uint64_t sign_mask;
 };
 
+/**
+Output registers (o#) of a vertex or domain shader that the next stage reads.
+User outputs outside the mask are neither written nor interpolated.
+*/
+struct SM50_SHADER_LINKED_OUTPUT_MASK_DATA {
+  void *next;
+  enum SM50_SHADER_COMPILATION_ARGUMENT_TYPE type;
+  uint32_t output_reg_mask;
+};
+
+/**
+The vertex shader linked to a pixel shader. Inputs in both its
+ConstantOutputRegisterMask and the pixel shader's ConstantInputRegisterMask
+are initialized with the literals instead of being interpolated, the caller
+is responsible for excluding them from the vertex shader's linked output mask.
+*/
+struct SM50_SHADER_LINKED_CONSTANT_INPUT_DATA {
+  void *next;
+  enum SM50_SHADER_COMPILATION_ARGUMENT_TYPE type;
+  SM50Shader *producer;
+};
+
 struct SM50_STREAM_OUTPUT_ELEMENT {
   uint32_t reg_id;
   uint32_t component;
@@ -213,6 +249,15 @@ struct SM50_SHADER_PSO_PIXEL_SHADER_DATA {
   bool dual_source_blending;
   bool disable_depth_output;
   uint32_t unorm_output_reg_mask;
+  /**
+  evaluate float arithmetic whose operands are all min16float in half
+  */
+  bool min_precision_half;
+  /**
+  samplers (s#) known to have no LOD bias, the bias is not read from the
+  argument table
+  */
+  uint32_t zero_bias_sampler_mask;
 };
 
 struct SM50_IA_INPUT_ELEMENT {
@@ -238,6 +283,17 @@ struct SM50_SHADER_IA_INPUT_LAYOUT_DATA {
   uint32_t slot_mask;
   uint32_t num_elements;
   struct SM50_IA_INPUT_ELEMENT *elements;
+  /**
+  fetch through [[stage_in]] attributes (location = reg) instead of pulling
+  from the vertex buffer table. buffer index of slot N is N + 1, the caller
+  is responsible for a matching MTLVertexDescriptor
+  */
+  bool stage_in;
+  /**
+  every slot in slot_mask is known to be bound to a buffer, so vertex pulling
+  can skip the null binding check
+  */
+  bool slots_bound;
 };
 
 struct SM50_SHADER_GS_PASS_THROUGH_DATA {
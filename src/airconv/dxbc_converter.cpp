@@ -115,7 +115,8 @@ auto get_item_in_argbuf_binding_table(uint32_t argbuf_index, uint32_t index) {
 
 void setup_binding_table(
   const ShaderInfo *shader_info, io_binding_map &resource_map,
-  air::FunctionSignatureBuilder &func_signature, llvm::Module &module
+  air::FunctionSignatureBuilder &func_signature, llvm::Module &module,
+  uint32_t zero_bias_sampler_mask
 ) {
   uint32_t binding_table_index = ~0u;
   uint32_t cbuf_table_index = ~0u;
@@ -165,7 +166,10 @@ void setup_binding_table(
         // ignore index in SM 5.0
         return get_item_in_argbuf_binding_table(binding_table_index, index);
       },
-      [=, index = sampler.arg_metadata_index](pvalue) {
+      [=, index = sampler.arg_metadata_index,
+       zero_bias = bool(zero_bias_sampler_mask & (1 << sampler.range.lower_bound))](pvalue) -> IRValue {
+        if (zero_bias)
+          return make_irvalue([](context ctx) -> pvalue { return ctx.builder.getInt64(0); });
         // ignore index in SM 5.0
         return get_item_in_argbuf_binding_table(binding_table_index, index);
       }
@@ -308,26 +312,20 @@ void setup_temp_register(
   const ShaderInfo *shader_info, io_binding_map &resource_map,
   air::AirType &types, llvm::Module &module, llvm::IRBuilder<> &builder
 ) {
-  resource_map.temp.ptr_int4 = builder.CreateAlloca(
-    llvm::ArrayType::get(types._int4, shader_info->tempRegisterCount)
-  );
-  resource_map.temp.ptr_float4 = builder.CreateBitCast(
-    resource_map.temp.ptr_int4,
-    llvm::ArrayType::get(types._float4, shader_info->tempRegisterCount)
-      ->getPointerTo()
-  );
+  auto alloca_temp_components = [&](temp_register_file &file, uint32_t count) {
+    file.components.resize(count);
+    for (auto &reg : file.components) {
+      for (auto &component : reg) {
+        component = builder.CreateAlloca(types._int);
+      }
+    }
+  };
+  alloca_temp_components(resource_map.temp, shader_info->tempRegisterCount);
   for (auto &phase : shader_info->phases) {
     resource_map.phases.push_back({});
     auto &phase_temp = resource_map.phases.back();
 
-    phase_temp.temp.ptr_int4 = builder.CreateAlloca(
-      llvm::ArrayType::get(types._int4, phase.tempRegisterCount)
-    );
-    phase_temp.temp.ptr_float4 = builder.CreateBitCast(
-      phase_temp.temp.ptr_int4,
-      llvm::ArrayType::get(types._float4, phase.tempRegisterCount)
-        ->getPointerTo()
-    );
+    alloca_temp_components(phase_temp.temp, phase.tempRegisterCount);
 
     for (auto &[idx, info] : phase.indexableTempRegisterCounts) {
       auto &[numRegisters, mask] = info;
@@ -718,12 +716,17 @@ llvm::Error convert_dxbc_domain_shader(
   SM50_SHADER_COMPILATION_ARGUMENT_DATA *arg = pArgs;
   MTL_GEOMETRY_SHADER_PASS_THROUGH *gs_passthrough = nullptr;
   bool rasterization_disabled = false;
+  uint32_t linked_output_reg_mask = ~0u;
   // uint64_t debug_id = ~0u;
   while (arg) {
     switch (arg->type) {
     case SM50_SHADER_DEBUG_IDENTITY:
       // debug_id = ((SM50_SHADER_DEBUG_IDENTITY_DATA *)arg)->id;
       break;
+    case SM50_SHADER_LINKED_OUTPUT_MASK:
+      linked_output_reg_mask =
+        ((SM50_SHADER_LINKED_OUTPUT_MASK_DATA *)arg)->output_reg_mask;
+      break;
     case SM50_SHADER_GS_PASS_THROUGH:
       gs_passthrough = &((SM50_SHADER_GS_PASS_THROUGH_DATA *)arg)->Data;
       rasterization_disabled = ((SM50_SHADER_GS_PASS_THROUGH_DATA *)arg)->RasterizationDisabled;
@@ -749,6 +752,7 @@ llvm::Error convert_dxbc_domain_shader(
   {
     SignatureContext sig_ctx(prologue, epilogue, func_signature, resource_map);
     sig_ctx.skip_vertex_output = rasterization_disabled;
+    sig_ctx.linked_output_reg_mask = linked_output_reg_mask;
     for (auto &p : pShaderInternal->signature_handlers) {
       p(sig_ctx);
     }
@@ -1012,6 +1016,9 @@ llvm::Error convert_dxbc_pixel_shader(
   bool pso_dual_source_blending = false;
   bool pso_disable_depth_output = false;
   uint32_t pso_unorm_output_reg_mask = 0;
+  bool pso_min_precision_half = false;
+  uint32_t pso_zero_bias_sampler_mask = 0;
+  SM50ShaderInternal *linked_producer = nullptr;
   SM50_SHADER_COMPILATION_ARGUMENT_DATA *arg = pArgs;
   // uint64_t debug_id = ~0u;
   while (arg) {
@@ -1027,6 +1034,13 @@ llvm::Error convert_dxbc_pixel_shader(
         ((SM50_SHADER_PSO_PIXEL_SHADER_DATA *)arg)->disable_depth_output;
       pso_unorm_output_reg_mask =
         ((SM50_SHADER_PSO_PIXEL_SHADER_DATA *)arg)->unorm_output_reg_mask;
+      pso_min_precision_half =
+        ((SM50_SHADER_PSO_PIXEL_SHADER_DATA *)arg)->min_precision_half;
+      pso_zero_bias_sampler_mask =
+        ((SM50_SHADER_PSO_PIXEL_SHADER_DATA *)arg)->zero_bias_sampler_mask;
+      break;
+    case SM50_SHADER_LINKED_CONSTANT_INPUT:
+      linked_producer = (SM50ShaderInternal *)((SM50_SHADER_LINKED_CONSTANT_INPUT_DATA *)arg)->producer;
       break;
     default:
       break;
@@ -1052,6 +1066,11 @@ llvm::Error convert_dxbc_pixel_shader(
     sig_ctx.disable_depth_output = pso_disable_depth_output;
     sig_ctx.pull_mode_reg_mask = shader_info->pull_mode_reg_mask;
     sig_ctx.unorm_output_reg_mask = pso_unorm_output_reg_mask;
+    if (linked_producer) {
+      sig_ctx.linked_constant_reg_mask =
+        linked_producer->constant_output_reg_mask & ~shader_info->pull_mode_reg_mask;
+      sig_ctx.linked_constant_values = linked_producer->constant_output_values.data();
+    }
     for (auto &p : pShaderInternal->signature_handlers) {
       p(sig_ctx);
     }
@@ -1071,7 +1090,9 @@ llvm::Error convert_dxbc_pixel_shader(
     };
   }
 
-  setup_binding_table(shader_info, resource_map, func_signature, module);
+  setup_binding_table(
+    shader_info, resource_map, func_signature, module, pso_zero_bias_sampler_mask
+  );
   setup_tgsm(shader_info, resource_map, types, module);
 
   auto [function, function_metadata] =
@@ -1109,6 +1130,7 @@ llvm::Error convert_dxbc_pixel_shader(
     .resource = resource_map, .types = types,
     .pso_sample_mask = pso_sample_mask,
     .shader_type = pShaderInternal->shader_type,
+    .min_precision_half = pso_min_precision_half,
   };
 
   if (auto err = prologue.build(ctx).takeError()) {
@@ -1244,6 +1266,7 @@ llvm::Error convert_dxbc_vertex_shader(
   SM50_SHADER_IA_INPUT_LAYOUT_DATA *ia_layout = nullptr;
   MTL_GEOMETRY_SHADER_PASS_THROUGH *gs_passthrough = nullptr;
   bool rasterization_disabled = false;
+  uint32_t linked_output_reg_mask = ~0u;
   // uint64_t debug_id = ~0u;
   while (arg) {
     switch (arg->type) {
@@ -1251,6 +1274,10 @@ llvm::Error convert_dxbc_vertex_shader(
       sign_mask =
         ((SM50_SHADER_COMPILATION_INPUT_SIGN_MASK_DATA *)arg)->sign_mask;
       break;
+    case SM50_SHADER_LINKED_OUTPUT_MASK:
+      linked_output_reg_mask =
+        ((SM50_SHADER_LINKED_OUTPUT_MASK_DATA *)arg)->output_reg_mask;
+      break;
     case SM50_SHADER_EMULATE_VERTEX_STREAM_OUTPUT:
       if (shader_type != microsoft::D3D10_SB_VERTEX_SHADER)
         break;
@@ -1289,6 +1316,7 @@ llvm::Error convert_dxbc_vertex_shader(
     SignatureContext sig_ctx(prologue, epilogue, func_signature, resource_map);
     sig_ctx.ia_layout = ia_layout;
     sig_ctx.skip_vertex_output = rasterization_disabled;
+    sig_ctx.linked_output_reg_mask = linked_output_reg_mask;
     for (auto &p : pShaderInternal->signature_handlers) {
       p(sig_ctx);
     }
@@ -1855,6 +1883,84 @@ bool CheckGSBBIsPassThrough(dxmt::dxbc::BasicBlock *bb) {
   );
 }
 
+/**
+Finds user outputs that are only written by `mov` of a literal outside of
+control flow, like the constant color or texcoord scale of a fullscreen pass.
+The pixel shader can take them as constants instead of interpolants.
+*/
+uint32_t FindConstantOutputs(
+  CShaderToken *code,
+  std::array<std::array<uint32_t, 4>, 32> &values
+) {
+  using namespace microsoft;
+  D3D10ShaderBinary::CShaderCodeParser parser(code);
+  uint32_t declared_mask = 0;
+  uint32_t non_constant_mask = 0;
+  uint32_t written_components[32] = {};
+  uint32_t depth = 0;
+  bool in_subroutine = false;
+  while (!parser.EndOfShader()) {
+    D3D10ShaderBinary::CInstruction Inst;
+    parser.ParseInstruction(&Inst);
+    switch (Inst.m_OpCode) {
+    case D3D10_SB_OPCODE_DCL_OUTPUT:
+      declared_mask |= 1 << Inst.m_Operands[0].m_Index[0].m_RegIndex;
+      continue;
+    case D3D10_SB_OPCODE_DCL_OUTPUT_SGV:
+    case D3D10_SB_OPCODE_DCL_OUTPUT_SIV:
+      non_constant_mask |= 1 << Inst.m_Operands[0].m_Index[0].m_RegIndex;
+      continue;
+    case D3D10_SB_OPCODE_DCL_INDEX_RANGE:
+      if (Inst.m_Operands[0].m_Type == D3D10_SB_OPERAND_TYPE_OUTPUT)
+        return 0;
+      continue;
+    case D3D10_SB_OPCODE_IF:
+    case D3D10_SB_OPCODE_LOOP:
+    case D3D10_SB_OPCODE_SWITCH:
+      depth++;
+      continue;
+    case D3D10_SB_OPCODE_ENDIF:
+    case D3D10_SB_OPCODE_ENDLOOP:
+    case D3D10_SB_OPCODE_ENDSWITCH:
+      depth--;
+      continue;
+    case D3D10_SB_OPCODE_LABEL:
+      in_subroutine = true;
+      continue;
+    default:
+      break;
+    }
+    for (unsigned i = 0; i < Inst.m_NumOperands; i++) {
+      auto &O = Inst.m_Operands[i];
+      if (O.m_Type != D3D10_SB_OPERAND_TYPE_OUTPUT)
+        continue;
+      if (O.m_IndexType[0] != D3D10_SB_OPERAND_INDEX_IMMEDIATE32)
+        return 0;
+      auto reg = O.m_Index[0].m_RegIndex;
+      auto mask = O.m_WriteMask >> 4;
+      auto &src = Inst.m_Operands[1];
+      bool literal = Inst.m_OpCode == D3D10_SB_OPCODE_MOV && i == 0 && !Inst.m_bSaturate && !depth &&
+                     !in_subroutine && src.m_Type == D3D10_SB_OPERAND_TYPE_IMMEDIATE32 &&
+                     src.m_Modifier == D3D10_SB_OPERAND_MODIFIER_NONE;
+      if (!literal || (written_components[reg] & mask)) {
+        non_constant_mask |= 1 << reg;
+        continue;
+      }
+      for (unsigned c = 0; c < 4; c++) {
+        if (mask & (1 << c))
+          values[reg][c] = src.m_NumComponents == D3D10_SB_OPERAND_1_COMPONENT ? src.m_Value[0] : src.m_Value[c];
+      }
+      written_components[reg] |= mask;
+    }
+  }
+  uint32_t written_mask = 0;
+  for (unsigned reg = 0; reg < 32; reg++) {
+    if (written_components[reg])
+      written_mask |= 1 << reg;
+  }
+  return declared_mask & written_mask & ~non_constant_mask;
+}
+
 bool CheckGSSignatureIsPassThrough(
   microsoft::CSignatureParser &input, microsoft::CSignatureParser5 &output,
   MTL_GEOMETRY_SHADER_PASS_THROUGH &data
@@ -2867,6 +2973,11 @@ int SM50Initialize(
     sm50_shader->max_output_register = inputParser.GetNumParameters();
   }
 
+  if (sm50_shader->shader_type == microsoft::D3D10_SB_VERTEX_SHADER) {
+    sm50_shader->constant_output_reg_mask =
+      FindConstantOutputs(ShaderCode, sm50_shader->constant_output_values);
+  }
+
   if (pRefl) {
     pRefl->ConstanttBufferTableBindIndex =
       sm50_shader->args_reflection_cbuffer.size() > 0 ? 29 : ~0u;
@@ -2912,6 +3023,9 @@ int SM50Initialize(
     pRefl->ThreadsPerPatch =
       next_pow2(sm50_shader->hull_maximum_threads_per_patch);
     pRefl->ArgumentTableQwords = binding_table.Size();
+    pRefl->InputRegisterMask = sm50_shader->input_reg_mask;
+    pRefl->ConstantInputRegisterMask = sm50_shader->input_reg_mask & ~shader_info->pull_mode_reg_mask;
+    pRefl->ConstantOutputRegisterMask = sm50_shader->constant_output_reg_mask;
   }
 
   *ppShader = (SM50Shader *)sm50_shader;
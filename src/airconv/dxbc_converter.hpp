@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <optional>
@@ -119,6 +120,12 @@ struct register_file {
   llvm::Value *ptr_float4 = nullptr;
 };
 
+// one i32 slot per component of each r#, float access bitcasts the value
+// so that mem2reg can promote every slot without SROA untangling aliases
+struct temp_register_file {
+  std::vector<std::array<llvm::AllocaInst *, 4>> components{};
+};
+
 struct indexable_register_file {
   llvm::Value *ptr_int_vec = nullptr;
   llvm::Value *ptr_float_vec = nullptr;
@@ -126,7 +133,7 @@ struct indexable_register_file {
 };
 
 struct phase_temp {
-  register_file temp{};
+  temp_register_file temp{};
   std::unordered_map<uint32_t, indexable_register_file> indexable_temp_map{};
 };
 
@@ -168,7 +175,7 @@ struct io_binding_map {
 
   register_file input{};
   register_file output{};
-  register_file temp{};
+  temp_register_file temp{};
   std::unordered_map<uint32_t, indexable_register_file> indexable_temp_map{};
   std::vector<phase_temp> phases;
   register_file patch_constant_output{};
@@ -226,6 +233,7 @@ struct context {
   air::AirType &types; // hmmm
   uint32_t pso_sample_mask;
   microsoft::D3D10_SB_TOKENIZED_PROGRAM_TYPE shader_type;
+  bool min_precision_half = false;
 };
 
 template <typename S> IRValue make_irvalue(S &&fs) {
@@ -262,6 +270,10 @@ IREffect init_input_reg_with_interpolation(
   air::Interpolation interpolation, uint32_t sampleidx_at
 );
 
+IREffect init_input_reg_constant(
+  uint32_t to_reg, uint32_t mask, std::array<uint32_t, 4> value
+);
+
 std::function<IRValue(pvalue)>
 pop_output_reg(uint32_t from_reg, uint32_t mask, uint32_t to_element);
 
@@ -276,7 +288,7 @@ std::function<IRValue(pvalue)> pop_output_tess_factor(
 
 IREffect pull_vertex_input(
   air::FunctionSignatureBuilder &func_signature, uint32_t to_reg, uint32_t mask,
-  SM50_IA_INPUT_ELEMENT element_info, uint32_t slot_mask
+  SM50_IA_INPUT_ELEMENT element_info, uint32_t slot_mask, bool slots_bound
 );
 
 IREffect pop_mesh_output_render_taget_array_index(uint32_t from_reg, uint32_t mask, pvalue primitive_id);
@@ -329,13 +341,17 @@ struct SignatureContext {
   bool skip_vertex_output;
   uint32_t pull_mode_reg_mask;
   uint32_t unorm_output_reg_mask;
+  uint32_t linked_output_reg_mask;
+  uint32_t linked_constant_reg_mask;
+  const std::array<uint32_t, 4> *linked_constant_values;
 
   SignatureContext(
     IREffect &prologue, IRValue &epilogue, air::FunctionSignatureBuilder &func_signature, io_binding_map &resource
   )
       : prologue(prologue), epilogue(epilogue), func_signature(func_signature), resource(resource), ia_layout(nullptr),
         dual_source_blending(false), disable_depth_output(false), skip_vertex_output(false), pull_mode_reg_mask(0),
-        unorm_output_reg_mask(0){};
+        unorm_output_reg_mask(0), linked_output_reg_mask(~0u), linked_constant_reg_mask(0),
+        linked_constant_values(nullptr){};
 };
 
 struct GSOutputContext {
@@ -354,6 +370,9 @@ public:
   uint32_t max_input_register = 0;
   uint32_t max_output_register = 0;
   uint32_t max_patch_constant_output_register = 0;
+  uint32_t input_reg_mask = 0;
+  uint32_t constant_output_reg_mask = 0;
+  std::array<std::array<uint32_t, 4>, 32> constant_output_values = {};
   std::vector<MTL_SM50_SHADER_ARGUMENT> args_reflection_cbuffer;
   std::vector<MTL_SM50_SHADER_ARGUMENT> args_reflection;
   uint32_t threadgroup_size[3] = {0};
@@ -375,7 +394,8 @@ public:
 
 void setup_binding_table(
   const ShaderInfo *shader_info, io_binding_map &resource_map,
-  air::FunctionSignatureBuilder &func_signature, llvm::Module &module
+  air::FunctionSignatureBuilder &func_signature, llvm::Module &module,
+  uint32_t zero_bias_sampler_mask = 0
 );
 
 void setup_tgsm(
@@ -4,6 +4,7 @@
 #include "airconv_error.hpp"
 #include "airconv_public.h"
 #include "dxbc_converter.hpp"
+#include "dxbc_icb_load.hpp"
 #include "ftl.hpp"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
@@ -22,6 +23,7 @@
 #include "llvm/IR/Type.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
+#include <bit>
 #include <stack>
 
 char dxmt::UnsupportedFeature::ID;
@@ -91,6 +93,36 @@ auto truncate_vec(uint8_t elements) {
   };
 };
 
+/**
+Float operands of a min-precision instruction are narrowed to half, so the
+operation itself runs at 16 bits. Registers stay 32-bit: the result is widened
+back by `widen_half`, and fpext/fptrunc pairs between two min-precision
+instructions fold away once temps are promoted.
+*/
+auto narrow_min_precision(InstructionCommon common) {
+  return [=](pvalue value) {
+    return make_irvalue([=](struct context ctx) -> pvalue {
+      if (!common.min_precision || !ctx.min_precision_half)
+        return value;
+      llvm::Type *half_type = ctx.types._half;
+      if (auto vec_type = llvm::dyn_cast<llvm::FixedVectorType>(value->getType()))
+        half_type = llvm::FixedVectorType::get(half_type, vec_type->getNumElements());
+      return ctx.builder.CreateFPTrunc(value, half_type);
+    });
+  };
+};
+
+auto widen_half(pvalue value) {
+  return make_irvalue([=](struct context ctx) -> pvalue {
+    if (!value->getType()->getScalarType()->isHalfTy())
+      return value;
+    llvm::Type *float_type = ctx.types._float;
+    if (auto vec_type = llvm::dyn_cast<llvm::FixedVectorType>(value->getType()))
+      float_type = llvm::FixedVectorType::get(float_type, vec_type->getNumElements());
+    return ctx.builder.CreateFPExt(value, float_type);
+  });
+};
+
 auto read_int(pvalue vec4, Swizzle swizzle) {
   return bitcast_int4(vec4) >>= [=](auto bitcasted) {
     return make_irvalue([=](context s) {
@@ -537,6 +569,43 @@ auto store_at_vec_array_masked(
   });
 };
 
+IRValue load_temp_register(
+  const temp_register_file &file, uint32_t regid, bool as_float
+) {
+  assert(regid < file.components.size());
+  auto components = file.components[regid];
+  return make_irvalue([=](context ctx) -> pvalue {
+    pvalue vec4 = llvm::UndefValue::get(ctx.types._int4);
+    for (unsigned i = 0; i < 4; i++) {
+      vec4 = ctx.builder.CreateInsertElement(
+        vec4, ctx.builder.CreateLoad(ctx.types._int, components[i]), uint64_t(i)
+      );
+    }
+    return as_float ? ctx.builder.CreateBitCast(vec4, ctx.types._float4) : vec4;
+  });
+};
+
+IREffect store_temp_register_masked(
+  const temp_register_file &file, uint32_t regid, pvalue maybe_vec4,
+  uint32_t mask
+) {
+  assert(regid < file.components.size());
+  auto components = file.components[regid];
+  return extend_to_vec4(maybe_vec4) >>= [=](pvalue vec4) {
+    return make_effect([=](context ctx) {
+      auto int4 = ctx.builder.CreateBitCast(vec4, ctx.types._int4);
+      for (unsigned i = 0; i < 4; i++) {
+        if ((mask & (1 << i)) == 0)
+          continue;
+        ctx.builder.CreateStore(
+          ctx.builder.CreateExtractElement(int4, i), components[i]
+        );
+      }
+      return std::monostate();
+    });
+  };
+};
+
 IREffect init_input_reg(
   uint32_t with_fnarg_at, uint32_t to_reg, uint32_t mask,
   bool fix_w_component
@@ -622,6 +691,17 @@ IREffect init_input_reg_with_interpolation(
   });
 }
 
+IREffect init_input_reg_constant(
+  uint32_t to_reg, uint32_t mask, std::array<uint32_t, 4> value
+) {
+  return make_effect_bind([=](context ctx) {
+    return store_at_vec4_array_masked(
+      ctx.resource.input.ptr_int4, ctx.builder.getInt32(to_reg),
+      llvm::ConstantDataVector::get(ctx.llvm, value), mask
+    );
+  });
+}
+
 std::function<IRValue(pvalue)>
 pop_output_reg(uint32_t from_reg, uint32_t mask, uint32_t to_element) {
   return [=](pvalue ret) {
@@ -757,7 +837,7 @@ pop_mesh_output_vertex_data(
 
 IREffect pull_vertex_input(
   air::FunctionSignatureBuilder &func_signature, uint32_t to_reg, uint32_t mask,
-  SM50_IA_INPUT_ELEMENT element_info, uint32_t slot_mask
+  SM50_IA_INPUT_ELEMENT element_info, uint32_t slot_mask, bool slots_bound
 ) {
   auto vbuf_table = func_signature.DefineInput(air::ArgumentBindingBuffer{
     .buffer_size = {},
@@ -815,8 +895,11 @@ IREffect pull_vertex_input(
       builder.CreateMul(stride, index),
       builder.getInt32(element_info.aligned_byte_offset)
     );
-    auto vec4 = co_yield air::pull_vec4_from_addr(
-      (air::MTLAttributeFormat)element_info.format, base_addr, byte_offset
+    auto format = (air::MTLAttributeFormat)element_info.format;
+    // a bound slot never has a null address
+    auto vec4 = co_yield (
+      slots_bound ? air::pull_vec4_from_addr_checked(format, base_addr, byte_offset)
+                  : air::pull_vec4_from_addr(format, base_addr, byte_offset)
     );
     if (vec4->getType() == types._float4) {
       co_yield store_at_vec4_array_masked(
@@ -1066,18 +1149,14 @@ auto load_operand_index(OperandIndex idx) {
         );
       },
       [&](IndexByTempComponent ot) {
-        return make_irvalue([=](context ctx) -> llvm::Expected<pvalue> {
-          pvalue reg = ctx.resource.temp.ptr_int4;
-          if (ot.phase != ~0u) {
-            reg = ctx.resource.phases[ot.phase].temp.ptr_int4;
-          }
-          auto temp =
-            load_from_array_at(reg, ctx.builder.getInt32(ot.regid)).build(ctx);
-          if (auto err = temp.takeError()) {
-            return std::move(err);
-          }
+        return make_irvalue([=](context ctx) {
+          auto &file = ot.phase != ~0u ? ctx.resource.phases[ot.phase].temp
+                                       : ctx.resource.temp;
+          assert(ot.regid < file.components.size());
           return ctx.builder.CreateAdd(
-            ctx.builder.CreateExtractElement(temp.get(), ot.component),
+            ctx.builder.CreateLoad(
+              ctx.types._int, file.components[ot.regid][ot.component]
+            ),
             ctx.builder.getInt32(ot.offset)
           );
         });
@@ -1100,10 +1179,79 @@ template <typename Operand, bool ReadFloat> IRValue load_src(Operand) {
   return throwUnsupported<pvalue>(s);
 };
 
+/* loads only the components in `component_mask`, the others are undef */
+template <bool ReadFloat>
+IRValue
+load_constant_buffer(SrcOperandConstantBuffer cb, uint32_t component_mask) {
+  auto ctx = co_yield get_context();
+  auto cb_handle = co_yield ctx.resource.cb_range_map[cb.rangeid](nullptr);
+  assert(cb_handle);
+  auto regindex = co_yield load_operand_index(cb.regindex);
+  if (component_mask == 0)
+    component_mask = 0b1111;
+  unsigned first = std::countr_zero(component_mask);
+  unsigned count = std::bit_width(component_mask) - first;
+  llvm::LoadInst *load;
+  pvalue vec;
+  if (count == 4) {
+    auto ptr = ctx.builder.CreateGEP(ctx.types._int4, cb_handle, {regindex});
+    vec = load = ctx.builder.CreateLoad(ctx.types._int4, ptr);
+  } else {
+    auto ptr = ctx.builder.CreateGEP(
+      ctx.types._int4, cb_handle, {regindex, ctx.builder.getInt32(first)}
+    );
+    // a register is 16-byte aligned
+    auto align = llvm::Align(first == 0 ? 16 : first == 2 ? 8 : 4);
+    if (count == 1) {
+      load = ctx.builder.CreateAlignedLoad(ctx.types._int, ptr, align);
+      vec = ctx.builder.CreateInsertElement(
+        llvm::UndefValue::get(ctx.types._int4), load, uint64_t(first)
+      );
+    } else {
+      auto vec_type = llvm::FixedVectorType::get(ctx.types._int, count);
+      load = ctx.builder.CreateAlignedLoad(
+        vec_type,
+        ctx.builder.CreateBitCast(
+          ptr, vec_type->getPointerTo(ptr->getType()->getPointerAddressSpace())
+        ),
+        align
+      );
+      int shuffle[4];
+      for (unsigned i = 0; i < 4; i++) {
+        shuffle[i] = (i >= first && i < first + count) ? int(i - first) : -1;
+      }
+      vec = ctx.builder.CreateShuffleVector(load, shuffle);
+    }
+  }
+  // constant buffers can't be written by the shader, so the loads can be
+  // freely hoisted and merged across UAV and TGSM stores
+  load->setMetadata(
+    llvm::LLVMContext::MD_invariant_load, llvm::MDNode::get(ctx.llvm, {})
+  );
+  if (ReadFloat)
+    vec = ctx.builder.CreateBitCast(vec, ctx.types._float4);
+  co_return vec;
+};
+
 template <bool ReadFloat>
 IRValue load_src_op(SrcOperand src, uint32_t mask = 0b1111) {
   return std::visit(
-           [](auto src) { return load_src<decltype(src), ReadFloat>(src); }, src
+           patterns{
+             [mask](SrcOperandConstantBuffer cb) {
+               // narrow the load to the components the swizzle reads
+               uint8_t swizzle[4] = {
+                 cb._.swizzle.x, cb._.swizzle.y, cb._.swizzle.z, cb._.swizzle.w
+               };
+               uint32_t component_mask = 0;
+               for (unsigned i = 0; i < 4; i++) {
+                 if (mask & (1 << i))
+                   component_mask |= 1 << swizzle[i];
+               }
+               return load_constant_buffer<ReadFloat>(cb, component_mask);
+             },
+             [](auto src) { return load_src<decltype(src), ReadFloat>(src); }
+           },
+           src
          ) >>= [mask, src](auto vec) {
     auto modifier = get_modifier(src);
     if (ReadFloat) {
@@ -1114,51 +1262,48 @@ IRValue load_src_op(SrcOperand src, uint32_t mask = 0b1111) {
   };
 };
 
-template <>
-IRValue load_src<SrcOperandConstantBuffer, false>(SrcOperandConstantBuffer cb) {
-  auto ctx = co_yield get_context();
-  auto cb_handle = co_yield ctx.resource.cb_range_map[cb.rangeid](nullptr);
-  assert(cb_handle);
-  auto ptr = ctx.builder.CreateGEP(
-    ctx.types._int4, cb_handle, {co_yield load_operand_index(cb.regindex)}
-  );
-  co_return ctx.builder.CreateLoad(ctx.types._int4, ptr);
-};
-
-template <>
-IRValue load_src<SrcOperandConstantBuffer, true>(SrcOperandConstantBuffer cb) {
+IRValue load_immediate_constant_buffer(OperandIndex regindex, bool read_float) {
   auto ctx = co_yield get_context();
-  auto cb_handle = co_yield ctx.resource.cb_range_map[cb.rangeid](nullptr);
-  assert(cb_handle);
-  auto ptr = ctx.builder.CreateGEP(
-    ctx.types._int4, cb_handle, {co_yield load_operand_index(cb.regindex)}
-  );
-  auto vec = ctx.builder.CreateBitCast(
-    ctx.builder.CreateLoad(ctx.types._int4, ptr), ctx.types._float4
-  );
-  co_return vec;
+  auto icb_data = ctx.resource.icb->getInitializer();
+  uint32_t icb_size = llvm::cast<llvm::ArrayType>(icb_data->getType())->getNumElements();
+  auto as_read_type = [&](pvalue vec) {
+    return read_float ? ctx.builder.CreateBitCast(vec, ctx.types._float4) : vec;
+  };
+  auto constant_index = std::get_if<uint32_t>(&regindex);
+  switch (GetICBLoad(constant_index != nullptr, constant_index ? *constant_index : 0, icb_size)) {
+  case ICBLoad::Element:
+    co_return as_read_type(icb_data->getAggregateElement(*constant_index));
+  case ICBLoad::Zero:
+    co_return as_read_type(llvm::ConstantAggregateZero::get(ctx.types._int4));
+  case ICBLoad::Memory:
+    co_return co_yield load_from_array_at(
+      read_float ? ctx.resource.icb_float : ctx.resource.icb, co_yield load_operand_index(regindex)
+    );
+  case ICBLoad::SelectChain:
+    break;
+  }
+  auto index = co_yield load_operand_index(regindex);
+  pvalue vec = llvm::ConstantAggregateZero::get(ctx.types._int4);
+  for (uint32_t i = icb_size; i-- > 0;) {
+    vec = ctx.builder.CreateSelect(
+      ctx.builder.CreateICmpEQ(index, ctx.builder.getInt32(i)), icb_data->getAggregateElement(i), vec
+    );
+  }
+  co_return as_read_type(vec);
 };
 
 template <>
 IRValue load_src<SrcOperandImmediateConstantBuffer, false>(
   SrcOperandImmediateConstantBuffer cb
 ) {
-  auto ctx = co_yield get_context();
-  auto vec = co_yield load_from_array_at(
-    ctx.resource.icb, co_yield load_operand_index(cb.regindex)
-  );
-  co_return vec;
+  return load_immediate_constant_buffer(cb.regindex, false);
 };
 
 template <>
 IRValue load_src<SrcOperandImmediateConstantBuffer, true>(
   SrcOperandImmediateConstantBuffer cb
 ) {
-  auto ctx = co_yield get_context();
-  auto vec = co_yield load_from_array_at(
-    ctx.resource.icb_float, co_yield load_operand_index(cb.regindex)
-  );
-  co_return vec;
+  return load_immediate_constant_buffer(cb.regindex, true);
 };
 
 template <>
@@ -1263,28 +1408,22 @@ template <> IRValue load_src<SrcOperandTemp, true>(SrcOperandTemp temp) {
   auto ctx = co_yield get_context();
   if (temp.phase != ~0u) {
     assert(temp.phase < ctx.resource.phases.size());
-    co_return co_yield load_from_array_at(
-      ctx.resource.phases[temp.phase].temp.ptr_float4,
-      ctx.builder.getInt32(temp.regid)
+    co_return co_yield load_temp_register(
+      ctx.resource.phases[temp.phase].temp, temp.regid, true
     );
   }
-  co_return co_yield load_from_array_at(
-    ctx.resource.temp.ptr_float4, ctx.builder.getInt32(temp.regid)
-  );
+  co_return co_yield load_temp_register(ctx.resource.temp, temp.regid, true);
 };
 
 template <> IRValue load_src<SrcOperandTemp, false>(SrcOperandTemp temp) {
-  auto ctx = co_yield get_context();  
+  auto ctx = co_yield get_context();
   if (temp.phase != ~0u) {
     assert(temp.phase < ctx.resource.phases.size());
-    co_return co_yield load_from_array_at(
-      ctx.resource.phases[temp.phase].temp.ptr_int4,
-      ctx.builder.getInt32(temp.regid)
+    co_return co_yield load_temp_register(
+      ctx.resource.phases[temp.phase].temp, temp.regid, false
     );
   }
-  co_return co_yield load_from_array_at(
-    ctx.resource.temp.ptr_int4, ctx.builder.getInt32(temp.regid)
-  );
+  co_return co_yield load_temp_register(ctx.resource.temp, temp.regid, false);
 };
 
 template <>
@@ -1616,14 +1755,13 @@ store_dst<DstOperandTemp, false>(DstOperandTemp temp, IRValue &&value) {
     [value = std::move(value), temp](auto ctx) mutable -> IREffect {
       if (temp.phase != ~0u) {
         assert(temp.phase < ctx.resource.phases.size());
-        co_return co_yield store_at_vec4_array_masked(
-          ctx.resource.phases[temp.phase].temp.ptr_int4,
-          co_yield get_int(temp.regid), co_yield std::move(value), temp._.mask
+        co_return co_yield store_temp_register_masked(
+          ctx.resource.phases[temp.phase].temp, temp.regid,
+          co_yield std::move(value), temp._.mask
         );
       }
-      co_return co_yield store_at_vec4_array_masked(
-        ctx.resource.temp.ptr_int4, co_yield get_int(temp.regid),
-        co_yield std::move(value), temp._.mask
+      co_return co_yield store_temp_register_masked(
+        ctx.resource.temp, temp.regid, co_yield std::move(value), temp._.mask
       );
     }
   );
@@ -1636,14 +1774,13 @@ IREffect store_dst<DstOperandTemp, true>(DstOperandTemp temp, IRValue &&value) {
     [value = std::move(value), temp](auto ctx) mutable -> IREffect {
       if (temp.phase != ~0u) {
         assert(temp.phase < ctx.resource.phases.size());
-        co_return co_yield store_at_vec4_array_masked(
-          ctx.resource.phases[temp.phase].temp.ptr_float4,
-          co_yield get_int(temp.regid), co_yield std::move(value), temp._.mask
+        co_return co_yield store_temp_register_masked(
+          ctx.resource.phases[temp.phase].temp, temp.regid,
+          co_yield std::move(value), temp._.mask
         );
       }
-      co_return co_yield store_at_vec4_array_masked(
-        ctx.resource.temp.ptr_float4, co_yield get_int(temp.regid),
-        co_yield std::move(value), temp._.mask
+      co_return co_yield store_temp_register_masked(
+        ctx.resource.temp, temp.regid, co_yield std::move(value), temp._.mask
       );
     }
   );
@@ -3600,35 +3737,46 @@ llvm::Expected<llvm::BasicBlock *> convert_basicblocks(
             switch (dp.dimension) {
             case 4:
               effect << lift(
-                load_src_op<true>(dp.src0), load_src_op<true>(dp.src1),
+                load_src_op<true>(dp.src0) >>= narrow_min_precision(dp._),
+                load_src_op<true>(dp.src1) >>= narrow_min_precision(dp._),
                 [=](auto a, auto b) {
                   return store_dst_op<true>(
-                    dp.dst, air::call_dot_product(4, a, b) >>=
-                            air::saturate(dp._.saturate)
+                    dp.dst, IRValue(
+                              air::call_dot_product(4, a, b) >>=
+                              air::saturate(dp._.saturate)
+                            ) >>= widen_half
                   );
                 }
               );
               break;
             case 3:
               effect << lift(
-                load_src_op<true>(dp.src0) >>= truncate_vec(3),
-                load_src_op<true>(dp.src1) >>= truncate_vec(3),
+                (load_src_op<true>(dp.src0) >>= truncate_vec(3)) >>=
+                narrow_min_precision(dp._),
+                (load_src_op<true>(dp.src1) >>= truncate_vec(3)) >>=
+                narrow_min_precision(dp._),
                 [=](auto a, auto b) {
                   return store_dst_op<true>(
-                    dp.dst, air::call_dot_product(3, a, b) >>=
-                            air::saturate(dp._.saturate)
+                    dp.dst, IRValue(
+                              air::call_dot_product(3, a, b) >>=
+                              air::saturate(dp._.saturate)
+                            ) >>= widen_half
                   );
                 }
               );
               break;
             case 2:
               effect << lift(
-                load_src_op<true>(dp.src0) >>= truncate_vec(2),
-                load_src_op<true>(dp.src1) >>= truncate_vec(2),
+                (load_src_op<true>(dp.src0) >>= truncate_vec(2)) >>=
+                narrow_min_precision(dp._),
+                (load_src_op<true>(dp.src1) >>= truncate_vec(2)) >>=
+                narrow_min_precision(dp._),
                 [=](auto a, auto b) {
                   return store_dst_op<true>(
-                    dp.dst, air::call_dot_product(2, a, b) >>=
-                            air::saturate(dp._.saturate)
+                    dp.dst, IRValue(
+                              air::call_dot_product(2, a, b) >>=
+                              air::saturate(dp._.saturate)
+                            ) >>= widen_half
                   );
                 }
               );
@@ -3640,13 +3788,15 @@ llvm::Expected<llvm::BasicBlock *> convert_basicblocks(
           [&effect](InstFloatMAD mad) {
             auto mask = get_dst_mask(mad.dst);
             effect << lift(
-              load_src_op<true>(mad.src0, mask),
-              load_src_op<true>(mad.src1, mask),
-              load_src_op<true>(mad.src2, mask),
+              load_src_op<true>(mad.src0, mask) >>= narrow_min_precision(mad._),
+              load_src_op<true>(mad.src1, mask) >>= narrow_min_precision(mad._),
+              load_src_op<true>(mad.src2, mask) >>= narrow_min_precision(mad._),
               [=](auto a, auto b, auto c) {
                 return store_dst_op_masked<true>(
-                  mad.dst,
-                  air::call_float_mad(a, b, c) >>= air::saturate(mad._.saturate)
+                  mad.dst, IRValue(
+                             air::call_float_mad(a, b, c) >>=
+                             air::saturate(mad._.saturate)
+                           ) >>= widen_half
                 );
               }
             );
@@ -3686,19 +3836,9 @@ llvm::Expected<llvm::BasicBlock *> convert_basicblocks(
             case FloatUnaryOp::Rcp: {
               fn = [=](pvalue a) {
                 return make_irvalue([=](struct context ctx) {
-                  if (!llvm::isa<llvm::FixedVectorType>(a->getType())) {
-                    // it's a scalar
-                    return ctx.builder.CreateFDiv(
-                      llvm::ConstantFP::get(ctx.llvm, llvm::APFloat{1.0f}), a
-                    );
-                  }
+                  // splatted if a is a vector, float or half alike
                   return ctx.builder.CreateFDiv(
-                    ctx.builder.CreateVectorSplat(
-                      cast<llvm::FixedVectorType>(a->getType())
-                        ->getNumElements(),
-                      llvm::ConstantFP::get(ctx.llvm, llvm::APFloat{1.0f})
-                    ),
-                    a
+                    llvm::ConstantFP::get(a->getType(), 1.0), a
                   );
                 });
               };
@@ -3749,8 +3889,9 @@ llvm::Expected<llvm::BasicBlock *> convert_basicblocks(
             }
             auto mask = get_dst_mask(unary.dst);
             effect << store_dst_op_masked<true>(
-              unary.dst, (load_src_op<true>(unary.src, mask) >>= fn) >>=
-                         saturate(unary._.saturate)
+              unary.dst, (((load_src_op<true>(unary.src, mask) >>=
+                            narrow_min_precision(unary._)) >>= fn) >>=
+                          saturate(unary._.saturate)) >>= widen_half
             );
           },
           [&effect](InstFloatBinaryOp bin) {
@@ -3795,10 +3936,13 @@ llvm::Expected<llvm::BasicBlock *> convert_basicblocks(
             }
             auto mask = get_dst_mask(bin.dst);
             effect << store_dst_op_masked<true>(
-              bin.dst, lift(
-                         load_src_op<true>(bin.src0, mask),
-                         load_src_op<true>(bin.src1, mask), fn
-                       ) >>= saturate(bin._.saturate)
+              bin.dst, (lift(
+                          load_src_op<true>(bin.src0, mask) >>=
+                          narrow_min_precision(bin._),
+                          load_src_op<true>(bin.src1, mask) >>=
+                          narrow_min_precision(bin._),
+                          fn
+                        ) >>= saturate(bin._.saturate)) >>= widen_half
             );
           },
           [&effect](InstSinCos sincos) {
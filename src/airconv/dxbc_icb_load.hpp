@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dxmt::dxbc {
+
+/**
+Immediate constant buffers are mostly tiny (Poisson kernels and the like), so
+they are read without touching memory where possible: a constant index folds
+to the element itself, and a dynamic index into a small buffer becomes a select
+chain that yields zero when out of range.
+*/
+constexpr uint32_t kMaxSelectChainICBSize = 16;
+
+enum class ICBLoad {
+  /* the element at the constant index */
+  Element,
+  /* a constant index out of range reads zero */
+  Zero,
+  /* compare the dynamic index against every element, zero if none matches */
+  SelectChain,
+  /* load from the buffer in memory */
+  Memory,
+};
+
+constexpr ICBLoad
+GetICBLoad(bool constant_index, uint32_t index, uint32_t icb_size) {
+  if (constant_index)
+    return index < icb_size ? ICBLoad::Element : ICBLoad::Zero;
+  return icb_size > kMaxSelectChainICBSize ? ICBLoad::Memory : ICBLoad::SelectChain;
+}
+
+} // namespace dxmt::dxbc
@@ -539,7 +539,18 @@ std::variant<SrcOperandResource, SrcOperandUAV> readSrcResourceOrUAV(
 auto readInstructionCommon(
   const microsoft::D3D10ShaderBinary::CInstruction &Inst
 ) -> InstructionCommon {
-  return InstructionCommon{.saturate = Inst.m_bSaturate != 0};
+  bool min_precision = Inst.m_NumOperands != 0;
+  for (unsigned i = 0; i < Inst.m_NumOperands; i++) {
+    auto &O = Inst.m_Operands[i];
+    if (O.m_Type == microsoft::D3D10_SB_OPERAND_TYPE_IMMEDIATE32)
+      continue;
+    if (O.m_MinPrecision != microsoft::D3D11_SB_OPERAND_MIN_PRECISION_FLOAT_16 &&
+        O.m_MinPrecision != microsoft::D3D11_SB_OPERAND_MIN_PRECISION_FLOAT_2_8)
+      min_precision = false;
+  }
+  return InstructionCommon{
+    .saturate = Inst.m_bSaturate != 0, .min_precision = min_precision
+  };
 };
 
 Instruction readInstruction(
@@ -202,6 +202,8 @@ struct DstOperandOutputCoverageMask {
 #pragma region instructions
 struct InstructionCommon {
   bool saturate;
+  // every non-immediate operand is annotated as min16float
+  bool min_precision;
 };
 
 struct DclConstantBuffer {};
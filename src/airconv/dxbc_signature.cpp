@@ -31,6 +31,37 @@ to_air_interpolation(microsoft::D3D10_SB_INTERPOLATION_MODE mode) {
   }
 }
 
+inline InputAttributeComponentType
+to_input_attribute_component_type(uint32_t format) {
+  switch ((MTLAttributeFormat)format) {
+  case MTLAttributeFormat::Char:
+  case MTLAttributeFormat::Char2:
+  case MTLAttributeFormat::Char4:
+  case MTLAttributeFormat::Short:
+  case MTLAttributeFormat::Short2:
+  case MTLAttributeFormat::Short4:
+  case MTLAttributeFormat::Int:
+  case MTLAttributeFormat::Int2:
+  case MTLAttributeFormat::Int3:
+  case MTLAttributeFormat::Int4:
+    return InputAttributeComponentType::Int;
+  case MTLAttributeFormat::UChar:
+  case MTLAttributeFormat::UChar2:
+  case MTLAttributeFormat::UChar4:
+  case MTLAttributeFormat::UShort:
+  case MTLAttributeFormat::UShort2:
+  case MTLAttributeFormat::UShort4:
+  case MTLAttributeFormat::UInt:
+  case MTLAttributeFormat::UInt2:
+  case MTLAttributeFormat::UInt3:
+  case MTLAttributeFormat::UInt4:
+    return InputAttributeComponentType::Uint;
+  default:
+    // normalized, half and float formats
+    return InputAttributeComponentType::Float;
+  }
+}
+
 void handle_signature_vs(
   CSignatureParser &inputParser, const CSignatureParser &outputParser,
   D3D10ShaderBinary::CInstruction &Inst, SM50ShaderInternal *sm50_shader,
@@ -116,12 +147,29 @@ void handle_signature_vs(
       signature_handlers.push_back(
         [=, type = (InputAttributeComponentType)sig.componentType(),
          name = sig.fullSemanticString()](SignatureContext &ctx) {
-          if (ctx.ia_layout) {
+          if (ctx.ia_layout && ctx.ia_layout->stage_in) {
+            for (unsigned i = 0; i < ctx.ia_layout->num_elements; i++) {
+              if (ctx.ia_layout->elements[i].reg == reg) {
+                // the attribute type must agree with the vertex format, not
+                // the signature
+                auto assigned_index =
+                  ctx.func_signature.DefineInput(InputVertexStageIn{
+                    .attribute = reg,
+                    .type = to_input_attribute_component_type(
+                      ctx.ia_layout->elements[i].format
+                    ),
+                    .name = name
+                  });
+                ctx.prologue << init_input_reg(assigned_index, reg, mask);
+                break;
+              }
+            }
+          } else if (ctx.ia_layout) {
             for (unsigned i = 0; i < ctx.ia_layout->num_elements; i++) {
               if (ctx.ia_layout->elements[i].reg == reg) {
                 ctx.prologue << pull_vertex_input(
                   ctx.func_signature, reg, mask, ctx.ia_layout->elements[i],
-                  ctx.ia_layout->slot_mask
+                  ctx.ia_layout->slot_mask, ctx.ia_layout->slots_bound
                 );
                 break;
               }
@@ -218,11 +266,15 @@ void handle_signature_vs(
       auto sig = findOutputElement([=](Signature sig) {
         return (sig.reg() == reg) && ((sig.mask() & mask) != 0);
       });
-      uint32_t assigned_index = func_signature.DefineOutput(OutputVertex{
-        .user = sig.fullSemanticString(),
-        .type = to_msl_type(sig.componentType()),
-      });
-      signature_handlers.push_back([=](SignatureContext &ctx) {
+      signature_handlers.push_back([=, type = sig.componentType(), name = sig.fullSemanticString()]
+      (SignatureContext &ctx) {
+        // not read by the next stage: the value and its interpolant are dropped
+        if (!(ctx.linked_output_reg_mask & (1 << reg)))
+          return;
+        auto assigned_index = ctx.func_signature.DefineOutput(OutputVertex{
+          .user = name,
+          .type = to_msl_type(type),
+        });
         if (ctx.skip_vertex_output)
           return;
         ctx.epilogue >> pop_output_reg(reg, mask, assigned_index);
@@ -395,6 +447,11 @@ void handle_signature_ps(
     });
     signature_handlers.push_back([=, type = sig.componentType(), name = sig.fullSemanticString()]
     (SignatureContext &ctx) {
+      // a literal interpolates to itself, so the varying is not needed at all
+      if (ctx.linked_constant_reg_mask & (1 << reg)) {
+        ctx.prologue << init_input_reg_constant(reg, mask, ctx.linked_constant_values[reg]);
+        return;
+      }
       bool pull_mode = bool(ctx.pull_mode_reg_mask & (1 << reg)) && interpolation != air::Interpolation::flat;
       auto assigned_index = ctx.func_signature.DefineInput(InputFragmentStageIn{
         .user = name, .type = to_msl_type(type), .interpolation = interpolation, .pull_mode = pull_mode
@@ -425,6 +482,7 @@ void handle_signature_ps(
         ctx.prologue << init_input_reg(assigned_index, reg, mask);
       }
     });
+    sm50_shader->input_reg_mask |= (1 << reg);
     max_input_register = std::max(reg + 1, max_input_register);
     break;
   }
@@ -894,11 +952,14 @@ void handle_signature_ds(
       auto sig = findOutputElement([=](Signature sig) {
         return (sig.reg() == reg) && ((sig.mask() & mask) != 0);
       });
-      uint32_t assigned_index = func_signature.DefineOutput(OutputVertex{
-        .user = sig.fullSemanticString(),
-        .type = to_msl_type(sig.componentType()),
-      });
-      signature_handlers.push_back([=](SignatureContext &ctx) {
+      signature_handlers.push_back([=, type = sig.componentType(), name = sig.fullSemanticString()]
+      (SignatureContext &ctx) {
+        if (!(ctx.linked_output_reg_mask & (1 << reg)))
+          return;
+        auto assigned_index = ctx.func_signature.DefineOutput(OutputVertex{
+          .user = name,
+          .type = to_msl_type(type),
+        });
         ctx.epilogue >> pop_output_reg(reg, mask, assigned_index);
       });
       max_output_register = std::max(reg + 1, max_output_register);
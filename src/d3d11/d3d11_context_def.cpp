@@ -33,6 +33,20 @@ DeferredContextBase::EmitOP(cmd &&fn) {
   ctx_state.current_cmdlist->Emit(std::forward<cmd>(fn));
 }
 
+template <>
+template <typename Record>
+Record *
+DeferredContextBase::EmitRecordST(uint32_t extra) {
+  return ctx_state.current_cmdlist->EmitRecord<Record>(extra);
+}
+
+template <>
+template <typename Record>
+Record *
+DeferredContextBase::EmitRecordOP(uint32_t extra) {
+  return ctx_state.current_cmdlist->EmitRecord<Record>(extra);
+}
+
 template <>
 template <typename T>
 moveonly_list<T>
@@ -56,6 +70,26 @@ void DeferredContextBase::UseCopySource(Rc<StagingResource> &staging) {
   ctx_state.current_cmdlist->read_staging_resources.push_back(staging);
 }
 
+template <>
+bool
+DeferredContextBase::ShouldCommitEarly() {
+  return false;
+}
+
+template <>
+bool
+DeferredContextBase::AliasBuffer(ID3D11Buffer *pDstResource, ID3D11Buffer *pSrcResource) {
+  // the alias would only take effect once the command list is executed, which
+  // makes it impossible to track whether immediate names are shared
+  return false;
+}
+
+template <>
+void
+DeferredContextBase::SignalPendingEvent() {
+  // nop
+}
+
 class MTLD3D11DeferredContext : public DeferredContextBase {
 public:
   MTLD3D11DeferredContext(MTLD3D11Device *pDevice, UINT ContextFlags) :
@@ -313,6 +347,8 @@ public:
 
     ctx_state.current_cmdlist->promote_flush = promote_flush;
     promote_flush = false;
+    ctx_state.current_cmdlist->pipeline_statistics = pipeline_statistics;
+    pipeline_statistics = {};
 
     for (const auto &[_, building_query] : ctx_state.building_visibility_queries) {
       End(building_query.first.ptr());
@@ -10,8 +10,30 @@ namespace dxmt {
 struct ContextInternalState {
   CommandQueue &cmd_queue;
   bool has_dirty_op_since_last_event = false;
+  bool adaptive_commit = true;
+  /**
+  queries have been ended but not committed yet, a flush is needed when
+  polling their results
+  */
+  bool has_uncommitted_query = false;
+  /**
+  event (query) to be signaled when current pass ends, 0 if none
+  */
+  uint64_t pending_event_seq_id = 0;
 };
 
+/**
+Adaptive commit: when a pass ends, the chunk recorded so far may be committed
+early instead of waiting for flush/present.
+- GPU is idle: commit once there are a few commands to work on
+- otherwise: commit if enough commands or work have been accumulated, as long
+  as there are not too many chunks in flight already
+*/
+constexpr uint32_t kAdaptiveCommitMinCommandCount = 32;
+constexpr uint32_t kAdaptiveCommitCommandThreshold = 1024;
+constexpr uint64_t kAdaptiveCommitWorkThreshold = 1 << 20;
+constexpr uint64_t kAdaptiveCommitMaxInflightChunk = kCommandChunkCount / 4;
+
 
 template<typename Object> Rc<Object> forward_rc(Rc<Object>& obj) {
   return std::move(obj);
@@ -34,6 +56,25 @@ ImmediateContextBase::EmitOP(cmd &&fn) {
   CommandChunk *chk = ctx_state.cmd_queue.CurrentChunk();
   chk->emitcc(std::forward<cmd>(fn));
   ctx_state.has_dirty_op_since_last_event = true;
+  pending_command_count++;
+}
+
+template <>
+template <typename Record>
+Record *
+ImmediateContextBase::EmitRecordST(uint32_t extra) {
+  CommandChunk *chk = ctx_state.cmd_queue.CurrentChunk();
+  return chk->emitrecord<Record>(extra);
+}
+
+template <>
+template <typename Record>
+Record *
+ImmediateContextBase::EmitRecordOP(uint32_t extra) {
+  CommandChunk *chk = ctx_state.cmd_queue.CurrentChunk();
+  ctx_state.has_dirty_op_since_last_event = true;
+  pending_command_count++;
+  return chk->emitrecord<Record>(extra);
 }
 
 template <>
@@ -62,6 +103,75 @@ ImmediateContextBase::UseCopySource(Rc<StagingResource> &staging) {
   staging->useCopySource(ctx_state.cmd_queue.CurrentSeqId());
 }
 
+template <>
+bool
+ImmediateContextBase::ShouldCommitEarly() {
+  if (!ctx_state.adaptive_commit || pending_command_count < kAdaptiveCommitMinCommandCount)
+    return false;
+  auto inflight = ctx_state.cmd_queue.InflightChunkCount();
+  if (inflight != 0) {
+    if (inflight >= kAdaptiveCommitMaxInflightChunk)
+      return false;
+    if (pending_command_count < kAdaptiveCommitCommandThreshold &&
+        pending_work_estimate < kAdaptiveCommitWorkThreshold)
+      return false;
+  }
+  ctx_state.cmd_queue.CurrentFrameStatistics().adaptive_commit_count++;
+  return true;
+}
+
+template <>
+bool
+ImmediateContextBase::AliasBuffer(ID3D11Buffer *pDstResource, ID3D11Buffer *pSrcResource) {
+  D3D11_BUFFER_DESC dst_desc;
+  D3D11_BUFFER_DESC src_desc;
+  pDstResource->GetDesc(&dst_desc);
+  pSrcResource->GetDesc(&src_desc);
+  // views are cached per allocation, they can't be shared between buffers
+  constexpr UINT view_bind_flags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_STREAM_OUTPUT;
+  if ((dst_desc.BindFlags | src_desc.BindFlags) & view_bind_flags)
+    return false;
+  if (dst_desc.ByteWidth != src_desc.ByteWidth)
+    return false;
+  // an immutable allocation is untracked, it can't be shared with a buffer that is written later
+  if (dst_desc.Usage != D3D11_USAGE_DEFAULT || src_desc.Usage != D3D11_USAGE_DEFAULT)
+    return false;
+  UINT buffer_length = 0, bind_flag = 0;
+  auto dst_dynamic = GetDynamicBuffer(pDstResource, &buffer_length, &bind_flag);
+  auto src_dynamic = GetDynamicBuffer(pSrcResource, &buffer_length, &bind_flag);
+  if (!dst_dynamic || !src_dynamic)
+    return false;
+  // neither immediate name can be written in place until renamed
+  dst_dynamic->aliased = true;
+  src_dynamic->aliased = true;
+
+  if (dst_desc.BindFlags & D3D11_BIND_VERTEX_BUFFER) {
+    state_.InputAssembler.VertexBuffers.set_dirty();
+  }
+  if (dst_desc.BindFlags & D3D11_BIND_CONSTANT_BUFFER) {
+    for (auto &stage : state_.ShaderStages) {
+      stage.ConstantBuffers.set_dirty();
+    }
+  }
+  // a later write copies the shared allocation in a blit encoder before the current one, which must
+  // not have written it yet
+  InvalidateCurrentPass();
+  EmitST([dst = Rc(dst_dynamic->buffer), src = Rc(src_dynamic->buffer),
+          replaced = Rc<BufferAllocation>()](ArgumentEncodingContext &enc) mutable {
+    replaced = enc.aliasBuffer(dst, src);
+  });
+  return true;
+}
+
+template <>
+void
+ImmediateContextBase::SignalPendingEvent() {
+  if (!ctx_state.pending_event_seq_id)
+    return;
+  EmitST([event_id = ctx_state.pending_event_seq_id](ArgumentEncodingContext &enc) { enc.signalEvent(event_id); });
+  ctx_state.pending_event_seq_id = 0;
+}
+
 class MTLD3D11ImmediateContext : public ImmediateContextBase {
 public:
   MTLD3D11ImmediateContext(MTLD3D11Device *pDevice, CommandQueue &cmd_queue) :
@@ -69,6 +179,7 @@ public:
       cmd_queue(cmd_queue),
       ctx_state({cmd_queue}) {
         ignore_map_flag_no_wait_ = Config::getInstance().getOption<bool>("d3d11.ignoreMapFlagNoWait", false);
+        ctx_state.adaptive_commit = Config::getInstance().getOption<bool>("d3d11.adaptiveCommit", true);
       }
 
   ULONG STDMETHODCALLTYPE
@@ -97,8 +208,6 @@ public:
       return E_INVALIDARG;
     UINT buffer_length = 0, &row_pitch = buffer_length;
     UINT bind_flag = 0, &depth_pitch = bind_flag;
-    auto current_seq_id = cmd_queue.CurrentSeqId();
-    auto coherent_seq_id = cmd_queue.CoherentSeqId();
     if (auto dynamic = GetDynamicBuffer(pResource, &buffer_length, &bind_flag)) {
       switch (MapType) {
       case D3D11_MAP_READ:
@@ -106,25 +215,7 @@ public:
       case D3D11_MAP_READ_WRITE:
         return E_INVALIDARG;
       case D3D11_MAP_WRITE_DISCARD: {
-        if (bind_flag & D3D11_BIND_VERTEX_BUFFER) {
-          state_.InputAssembler.VertexBuffers.set_dirty();
-        }
-        if (bind_flag & D3D11_BIND_CONSTANT_BUFFER) {
-          for (auto &stage : state_.ShaderStages) {
-            stage.ConstantBuffers.set_dirty();
-          }
-        }
-        if (bind_flag & D3D11_BIND_SHADER_RESOURCE) {
-          for (auto &stage : state_.ShaderStages) {
-            stage.SRVs.set_dirty();
-          }
-        }
-
-        dynamic->updateImmediateName(current_seq_id, dynamic->allocate(coherent_seq_id), false);
-        EmitST([allocation = dynamic->immediateName(),
-              buffer = Rc(dynamic->buffer)](ArgumentEncodingContext &enc) mutable {
-          auto _ = buffer->rename(forward_rc(allocation));
-        });
+        RenameDynamicBuffer(dynamic, bind_flag);
 
         pMappedResource->pData = dynamic->mappedMemory();
         pMappedResource->RowPitch = buffer_length;
@@ -147,15 +238,7 @@ public:
       case D3D11_MAP_READ_WRITE:
         return E_INVALIDARG;
       case D3D11_MAP_WRITE_DISCARD: {
-        for (auto &stage : state_.ShaderStages) {
-          stage.SRVs.set_dirty();
-        }
-
-        dynamic->updateImmediateName(current_seq_id, dynamic->allocate(coherent_seq_id), false);
-        EmitST([allocation = dynamic->immediateName(),
-              texture = Rc(dynamic->texture)](ArgumentEncodingContext &enc) mutable {
-          auto _ = texture->rename(forward_rc(allocation));
-        });
+        RenameDynamicTexture(dynamic);
 
         pMappedResource->pData = dynamic->mappedMemory();
         pMappedResource->RowPitch = row_pitch;
@@ -178,6 +261,8 @@ public:
       if (ignore_map_flag_no_wait_)
         MapFlags &= ~D3D11_MAP_FLAG_DO_NOT_WAIT;
 
+      auto current_seq_id = cmd_queue.CurrentSeqId();
+      auto coherent_seq_id = cmd_queue.CoherentSeqId();
       while (true) {
         auto result = staging->tryMap(coherent_seq_id, MapType & D3D11_MAP_READ, MapType & D3D11_MAP_WRITE);
         if (result == StagingMapResult::Mapped)
@@ -186,29 +271,39 @@ public:
           // when write to a buffer that is gpu-readonly
           Obj<MTL::Buffer> new_name = staging->allocate(coherent_seq_id);
           EmitST([staging, new_name](ArgumentEncodingContext &enc) mutable { staging->current = std::move(new_name); });
-          // can't guarantee a full overwrite
-          std::memcpy(new_name->contents(), staging->mappedMemory(), new_name->length());
+          // can't guarantee a full overwrite, unless previous content has been discarded
+          if (!staging->discarded)
+            std::memcpy(new_name->contents(), staging->mappedMemory(), new_name->length());
           staging->updateImmediateName(current_seq_id, std::move(new_name));
           result = StagingMapResult::Mappable;
         }
         if (result == StagingMapResult::Mappable) {
           TRACE("staging map ready");
+          staging->discarded = false;
           pMappedResource->pData = staging->mappedMemory();
           pMappedResource->RowPitch = staging->bytesPerRow;
           pMappedResource->DepthPitch = staging->bytesPerImage;
           return S_OK;
         }
+        /**
+        The result is the distance to the chunk that last accessed the staging
+        resource. Only if it's the chunk being recorded, it has to be committed
+        now, otherwise there is no reason to cut the current chunk short. This
+        is also done before a DO_NOT_WAIT poll returns, or the poll can't make
+        any progress until the next flush.
+         */
+        uint64_t wait_seq_id = coherent_seq_id + uint64_t(result);
+        if (wait_seq_id >= current_seq_id) {
+          Flush();
+          current_seq_id = cmd_queue.CurrentSeqId();
+        }
         if (MapFlags & D3D11_MAP_FLAG_DO_NOT_WAIT) {
           return DXGI_ERROR_WAS_STILL_DRAWING;
         }
-        // even it's in a while loop
-        // only the first flush will have effect
-        // and the following calls are essentially no-op
-        Flush();
         TRACE("staging map block");
         auto& statistics = cmd_queue.CurrentFrameStatistics();
         auto t0 = clock::now();
-        cmd_queue.WaitCPUFence(coherent_seq_id + uint64_t(result));
+        cmd_queue.WaitCPUFence(wait_seq_id);
         auto t1 = clock::now();
         statistics.sync_count++;
         statistics.sync_interval += (t1 - t0);
@@ -222,6 +317,101 @@ public:
     return E_INVALIDARG;
   }
 
+  void
+  RenameDynamicBuffer(Rc<DynamicBuffer> &dynamic, UINT bind_flag) {
+    if (bind_flag & D3D11_BIND_VERTEX_BUFFER) {
+      state_.InputAssembler.VertexBuffers.set_dirty();
+    }
+    if (bind_flag & D3D11_BIND_CONSTANT_BUFFER) {
+      for (auto &stage : state_.ShaderStages) {
+        stage.ConstantBuffers.set_dirty();
+      }
+    }
+    if (bind_flag & D3D11_BIND_SHADER_RESOURCE) {
+      for (auto &stage : state_.ShaderStages) {
+        stage.SRVs.set_dirty();
+      }
+    }
+
+    dynamic->updateImmediateName(
+        cmd_queue.CurrentSeqId(), dynamic->allocate(cmd_queue.CoherentSeqId()), false
+    );
+    EmitST([allocation = dynamic->immediateName(),
+          buffer = Rc(dynamic->buffer)](ArgumentEncodingContext &enc) mutable {
+      auto _ = buffer->rename(forward_rc(allocation));
+    });
+  }
+
+  void
+  RenameDynamicTexture(Rc<DynamicTexture> &dynamic) {
+    for (auto &stage : state_.ShaderStages) {
+      stage.SRVs.set_dirty();
+    }
+
+    dynamic->updateImmediateName(
+        cmd_queue.CurrentSeqId(), dynamic->allocate(cmd_queue.CoherentSeqId()), false
+    );
+    EmitST([allocation = dynamic->immediateName(),
+          texture = Rc(dynamic->texture)](ArgumentEncodingContext &enc) mutable {
+      auto _ = texture->rename(forward_rc(allocation));
+    });
+  }
+
+  void
+  DiscardResource(ID3D11Resource *pResource) override {
+    if (unlikely(!pResource))
+      return;
+    UINT buffer_length = 0, &row_pitch = buffer_length;
+    UINT bind_flag = 0, &depth_pitch = bind_flag;
+    /**
+    A discarded dynamic resource is renamed right away, so the following
+    WRITE_NO_OVERWRITE maps never write into memory that GPU may be reading.
+     */
+    if (auto dynamic = GetDynamicBuffer(pResource, &buffer_length, &bind_flag)) {
+      return RenameDynamicBuffer(dynamic, bind_flag);
+    }
+    if (auto dynamic = GetDynamicTexture(pResource, &row_pitch, &depth_pitch)) {
+      return RenameDynamicTexture(dynamic);
+    }
+    /**
+    A discarded staging resource can be renamed (without copying previous
+    content) instead of waiting for GPU on next write map.
+     */
+    if (auto staging = GetStagingResource(pResource, 0)) {
+      UINT subresource_count = 1;
+      D3D11_RESOURCE_DIMENSION dimension;
+      pResource->GetType(&dimension);
+      switch (dimension) {
+      case D3D11_RESOURCE_DIMENSION_TEXTURE1D: {
+        D3D11_TEXTURE1D_DESC desc;
+        static_cast<ID3D11Texture1D *>(pResource)->GetDesc(&desc);
+        subresource_count = desc.MipLevels * desc.ArraySize;
+        break;
+      }
+      case D3D11_RESOURCE_DIMENSION_TEXTURE2D: {
+        D3D11_TEXTURE2D_DESC desc;
+        static_cast<ID3D11Texture2D *>(pResource)->GetDesc(&desc);
+        subresource_count = desc.MipLevels * desc.ArraySize;
+        break;
+      }
+      case D3D11_RESOURCE_DIMENSION_TEXTURE3D: {
+        D3D11_TEXTURE3D_DESC desc;
+        static_cast<ID3D11Texture3D *>(pResource)->GetDesc(&desc);
+        subresource_count = desc.MipLevels;
+        break;
+      }
+      default:
+        break;
+      }
+      staging->discarded = true;
+      for (UINT i = 1; i < subresource_count; i++) {
+        GetStagingResource(pResource, i)->discarded = true;
+      }
+      return;
+    }
+    ImmediateContextBase::DiscardResource(pResource);
+  }
+
   void
   Unmap(ID3D11Resource *pResource, UINT Subresource) override {
     if (unlikely(!pResource))
@@ -239,6 +429,8 @@ public:
     ((ID3D11Query *)pAsync)->GetDesc(&desc);
     switch (desc.Query) {
     case D3D11_QUERY_TIMESTAMP_DISJOINT:
+      static_cast<MTLD3D11TimestampDisjointQuery *>(pAsync)->Begin(cmd_queue.GetCurrentEventSeqId());
+      break;
     case D3D11_QUERY_TIMESTAMP:
     case D3D11_QUERY_EVENT:
       break;
@@ -252,7 +444,7 @@ public:
       break;
     }
     case D3D11_QUERY_PIPELINE_STATISTICS: {
-      // ignore
+      static_cast<MTLD3D11PipelineStatisticsQuery *>(pAsync)->Begin(pipeline_statistics);
       break;
     }
     default:
@@ -267,17 +459,39 @@ public:
     D3D11_QUERY_DESC desc;
     ((ID3D11Query *)pAsync)->GetDesc(&desc);
     switch (desc.Query) {
-    case D3D11_QUERY_TIMESTAMP:
+    case D3D11_QUERY_TIMESTAMP: {
+      // resolved from GPU timings of the chunk, see TimestampReadback
+      auto query = static_cast<MTLD3D11TimestampQuery *>(pAsync);
+      if (pending_command_count == 0) {
+        cmd_queue.CurrentChunk()->timestamp_readback.record(query->Write(), true);
+        ctx_state.has_uncommitted_query = true;
+        break;
+      }
+      // later commands must not delay the end time of the chunk, so it's
+      // committed before the next pass starts. Anything that doesn't start a
+      // pass (e.g. another timestamp) still lands in the same chunk.
+      cmd_queue.CurrentChunk()->timestamp_readback.record(query->Write(), false);
+      InvalidateCurrentPass(true);
+      promote_flush = true;
+      break;
+    }
+    case D3D11_QUERY_PIPELINE_STATISTICS:
+      // counted on CPU, but the result is available only after GPU has done the work
+      static_cast<MTLD3D11PipelineStatisticsQuery *>(pAsync)->End(pipeline_statistics);
+      [[fallthrough]];
     case D3D11_QUERY_TIMESTAMP_DISJOINT:
     case D3D11_QUERY_EVENT: {
       if (ctx_state.has_dirty_op_since_last_event) {
         auto event_id = cmd_queue.GetNextEventSeqId();
         static_cast<MTLD3D11EventQuery *>(pAsync)->Issue(event_id);
-        InvalidateCurrentPass(true);
-        EmitOP([event_id](ArgumentEncodingContext &enc) mutable {
-          enc.signalEvent(event_id);
-        });
-        promote_flush = true;
+        if (cmdbuf_state == CommandBufferState::Idle) {
+          EmitST([event_id](ArgumentEncodingContext &enc) { enc.signalEvent(event_id); });
+        } else {
+          // signal when the pass ends, either naturally or by a flush on GetData()
+          ctx_state.pending_event_seq_id = event_id;
+          cmd_queue.CurrentFrameStatistics().query_pass_saved++;
+        }
+        ctx_state.has_uncommitted_query = true;
         ctx_state.has_dirty_op_since_last_event = false;
       } else {
         static_cast<MTLD3D11EventQuery *>(pAsync)->Issue(cmd_queue.GetCurrentEventSeqId());
@@ -291,11 +505,8 @@ public:
         EmitST([qeury_ = query->__query()](ArgumentEncodingContext &enc) mutable {
           enc.endVisibilityResultQuery(std::move(qeury_));
         });
-      promote_flush = true;
-      break;
-    }
-    case D3D11_QUERY_PIPELINE_STATISTICS: {
-      // ignore
+      // the pass keeps running, commit is deferred until GetData() polls it
+      ctx_state.has_uncommitted_query = true;
       break;
     }
     default:
@@ -337,23 +548,33 @@ public:
       break;
     }
     case D3D11_QUERY_TIMESTAMP: {
-      hr = static_cast<MTLD3D11EventQuery *>(pAsync)->CheckEventState(cmd_queue.SignaledEventSeqId()) ? S_OK: S_FALSE;
-      if (pData)
-        *static_cast<UINT64 *>(pData) = 0;
+      uint64_t null_data;
+      uint64_t *data_ptr = pData ? (uint64_t *)pData : &null_data;
+      hr = static_cast<MTLD3D11TimestampQuery *>(pAsync)->GetValue(data_ptr) ? S_OK : S_FALSE;
       break;
     }
     case D3D11_QUERY_TIMESTAMP_DISJOINT: {
-      hr = static_cast<MTLD3D11EventQuery *>(pAsync)->CheckEventState(cmd_queue.SignaledEventSeqId()) ? S_OK: S_FALSE;
-      if (pData) {
-        (*static_cast<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT *>(pData)) = {1'000'000'000, FALSE};
+      auto query = static_cast<MTLD3D11TimestampDisjointQuery *>(pAsync);
+      hr = query->CheckEventState(cmd_queue.SignaledEventSeqId()) ? S_OK: S_FALSE;
+      if (pData && hr == S_OK) {
+        (*static_cast<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT *>(pData)) = {
+            kTimestampFrequency, query->IsDisjoint(cmd_queue.DisjointEventSeqId())
+        };
       }
       break;
     }
     case D3D11_QUERY_PIPELINE_STATISTICS: {
-      if (pData) {
-        (*static_cast<D3D11_QUERY_DATA_PIPELINE_STATISTICS *>(pData)) = {};
+      auto query = static_cast<MTLD3D11PipelineStatisticsQuery *>(pAsync);
+      hr = query->CheckEventState(cmd_queue.SignaledEventSeqId()) ? S_OK : S_FALSE;
+      if (pData && hr == S_OK) {
+        (*static_cast<D3D11_QUERY_DATA_PIPELINE_STATISTICS *>(pData)) = query->Result();
+        // the result misses indirect work, see PipelineStatisticsCounter
+        if (query->UncountedIndirectCalls())
+          cmd_queue.CurrentFrameStatistics().compatibility_flags.set(
+              FeatureCompatibility::UnsupportedIndirectPipelineStatistics
+          );
       }
-      return S_OK;
+      break;
     }
     default:
       ERR("Unknown query type ", desc.Query);
@@ -368,7 +589,7 @@ public:
 
   void
   Flush() override {
-    if (!ctx_state.has_dirty_op_since_last_event && !promote_flush) {
+    if (!ctx_state.has_dirty_op_since_last_event && !promote_flush && !ctx_state.has_uncommitted_query) {
       return;
     }
     promote_flush = true;
@@ -381,12 +602,16 @@ public:
 
   void
   ExecuteCommandList(ID3D11CommandList *pCommandList, BOOL RestoreContextState) override {
+    // a commit promoted earlier (e.g. by a timestamp) happens before the command list
+    if (promote_flush)
+      InvalidateCurrentPass();
     ResetEncodingContextState();
 
     Com<MTLD3D11CommandList> cmdlist = static_cast<MTLD3D11CommandList *>(pCommandList);
     auto seq_id = ctx_state.cmd_queue.CurrentSeqId();
 
     promote_flush = cmdlist->promote_flush;
+    pipeline_statistics.merge(cmdlist->pipeline_statistics);
 
     auto query_list = AllocateCommandData<Rc<VisibilityResultQuery>>(cmdlist->visibility_query_count);
     for (const auto &[query, index] : cmdlist->issued_visibility_query) {
@@ -394,10 +619,6 @@ public:
       query->DoDeferredQuery(query_list[index]);
     }
 
-    for (const auto &query : cmdlist->issued_event_query) {
-      End(query.ptr());
-    }
-
     for (const auto &staging : cmdlist->read_staging_resources) {
       staging->useCopySource(seq_id);
     }
@@ -418,6 +639,9 @@ public:
       used_dynamic.texture->updateImmediateName(seq_id, Rc(used_dynamic.allocation), true);
     }
 
+    // the command list is kept alive by the recorded command
+    auto &issued_event_query = cmdlist->issued_event_query;
+
     EmitOP([cmdlist = std::move(cmdlist), query_list = std::move(query_list)](ArgumentEncodingContext &enc) {
       // Finished command list should clean up the encoding context
       enc.pushDeferredVisibilityQuerys(query_list.data());
@@ -425,6 +649,11 @@ public:
       enc.popDeferredVisibilityQuerys();
     });
 
+    // event and timestamp queries are ended after the commands they follow
+    for (const auto &query : issued_event_query) {
+      End(query.ptr());
+    }
+
     if (RestoreContextState)
       RestoreEncodingContextState();
     else
@@ -453,8 +682,16 @@ public:
   Commit() override {
     promote_flush = false;
     D3D11_ASSERT(cmdbuf_state == CommandBufferState::Idle);
+    auto &statistics = ctx_state.cmd_queue.CurrentFrameStatistics();
+    statistics.chunk_command_count += pending_command_count;
+    statistics.max_chunk_command_count = std::max(statistics.max_chunk_command_count, pending_command_count);
     ctx_state.cmd_queue.CommitCurrentChunk();
     ctx_state.has_dirty_op_since_last_event = false;
+    // signaled at the end of chunk anyway
+    ctx_state.has_uncommitted_query = false;
+    ctx_state.pending_event_seq_id = 0;
+    pending_command_count = 0;
+    pending_work_estimate = 0;
   };
 
 private:
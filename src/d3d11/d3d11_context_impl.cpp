@@ -6,6 +6,7 @@ and should be not used as a compilation unit
 since it is for internal use only
 (and I don't want to deal with several thousands line of code)
 */
+#include "config/config.hpp"
 #include "d3d11_annotation.hpp"
 #include "d3d11_context.hpp"
 #include "d3d11_device_child.hpp"
@@ -16,6 +17,9 @@ since it is for internal use only
 #include "d3d11_device.hpp"
 #include "d3d11_pipeline.hpp"
 #include "d3d11_query.hpp"
+#include "d3d11_render_pass_usage.hpp"
+#include "d3d11_sampler_specialization.hpp"
+#include "d3d11_vertex_stage_in.hpp"
 #include "dxmt_buffer.hpp"
 #include "dxmt_context.hpp"
 #include "dxmt_format.hpp"
@@ -23,6 +27,8 @@ since it is for internal use only
 #include "mtld11_resource.hpp"
 #include "util_flags.hpp"
 #include "util_math.hpp"
+#include "util_memory.hpp"
+#include <algorithm>
 
 namespace dxmt {
 
@@ -832,16 +838,44 @@ public:
       if (desc.ViewDimension == D3D11_SRV_DIMENSION_BUFFER || desc.ViewDimension == D3D11_SRV_DIMENSION_BUFFEREX) {
         return;
       }
-      SwitchToBlitEncoder(CommandBufferState::BlitEncoderActive);
-      EmitOP([tex = srv->texture(), viewId = srv->viewId()](ArgumentEncodingContext &enc) {
-        auto texture = enc.access(tex, viewId, DXMT_ENCODER_RESOURCE_ACESS_READ | DXMT_ENCODER_RESOURCE_ACESS_WRITE);
-        if (texture->mipmapLevelCount() > 1) {
-          enc.encodeBlitCommand([texture](BlitCommandContext &ctx) { ctx.encoder->generateMipmaps(texture); });
-        }
+      auto texture = srv->texture();
+      if (!CanGenerateMipsInCurrentPass(texture.ptr()))
+        SwitchToBlitEncoder(CommandBufferState::BlitEncoderActive);
+      EmitOP([tex = std::move(texture), viewId = srv->viewId()](ArgumentEncodingContext &enc) {
+        enc.generateMipmaps(tex, viewId);
       });
     }
   }
 
+  /**
+  Mipmaps are generated in the current pass if it's a (non-readback) blit pass,
+  or a render pass that neither writes nor has sampled the texture so far,
+  where the blit is hoisted before the render pass. So interleaved uploads,
+  mipmapping and draws don't end up in one encoder per call.
+  */
+  bool
+  CanGenerateMipsInCurrentPass(Texture *texture) {
+    switch (cmdbuf_state) {
+    case CommandBufferState::BlitEncoderActive:
+    case CommandBufferState::UpdateBlitEncoderActive:
+      return true;
+    case CommandBufferState::RenderEncoderActive:
+    case CommandBufferState::RenderPipelineReady:
+    case CommandBufferState::TessellationRenderPipelineReady:
+    case CommandBufferState::GeometryRenderPipelineReady: {
+      bool attached = state_.OutputMerger.DSV && state_.OutputMerger.DSV->__texture().ptr() == texture;
+      for (unsigned i = 0; i < state_.OutputMerger.NumRTVs; i++) {
+        auto &rtv = state_.OutputMerger.RTVs[i];
+        if (rtv && rtv->__texture().ptr() == texture)
+          attached = true;
+      }
+      return render_pass_usage.canHoistBlit(texture, attached);
+    }
+    default:
+      return false;
+    }
+  }
+
   void
   ResolveSubresource(
       ID3D11Resource *pDstResource, UINT DstSubresource, ID3D11Resource *pSrcResource, UINT SrcSubresource,
@@ -890,6 +924,8 @@ public:
     case D3D11_RESOURCE_DIMENSION_BUFFER: {
       if (Src.Dimension != D3D11_RESOURCE_DIMENSION_BUFFER)
         return;
+      if (AliasBuffer((ID3D11Buffer *)pDstResource, (ID3D11Buffer *)pSrcResource))
+        break;
       CopyBuffer((ID3D11Buffer *)pDstResource, 0, 0, 0, 0, (ID3D11Buffer *)pSrcResource, 0, nullptr);
       break;
     }
@@ -1016,7 +1052,7 @@ public:
           Unmap(pDstResource, 0);
           return;
         }
-        if (CopyFlags & D3D11_COPY_NO_OVERWRITE) {
+        if ((CopyFlags & D3D11_COPY_NO_OVERWRITE) && !dynamic->aliased) {
           Map(pDstResource, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
           std::memcpy(reinterpret_cast<char *>(mapped.pData) + copy_offset, pSrcData, copy_len);
           Unmap(pDstResource, 0);
@@ -1051,12 +1087,14 @@ public:
   void
   DiscardResource(ID3D11Resource *pResource) override {
     /*
-    All the Discard* API is not implemented and that's probably fine (as it's
-    more like a hint of optimization, and Metal manages resources on its own)
-    FIXME: for render targets we can use this information: LoadActionDontCare
-    FIXME: A Map with D3D11_MAP_WRITE type could become D3D11_MAP_WRITE_DISCARD?
+    Discard is a hint: render targets and depth stencil buffers are turned into
+    StoreActionDontCare/LoadActionDontCare where possible.
+    (immediate context also renames discarded dynamic/staging resources)
     */
-    ERR_ONCE("Not implemented");
+    if (!pResource)
+      return;
+    if (auto texture = GetTexture(pResource))
+      DiscardTexture(std::move(texture), ArgumentEncodingContext::kDiscardAllViews);
   }
 
   void
@@ -1066,7 +1104,48 @@ public:
 
   void
   DiscardView1(ID3D11View *pResourceView, const D3D11_RECT *pRects, UINT NumRects) override {
-    ERR_ONCE("Not implemented");
+    if (!pResourceView)
+      return;
+    // partial discard can't be expressed as load/store action
+    if (NumRects)
+      return;
+    if (auto expected = com_cast<ID3D11RenderTargetView>(pResourceView)) {
+      auto rtv = static_cast<IMTLD3D11RenderTargetView *>(expected.ptr());
+      return DiscardTexture(rtv->__texture(), rtv->__viewId());
+    }
+    if (auto expected = com_cast<ID3D11DepthStencilView>(pResourceView)) {
+      auto dsv = static_cast<IMTLD3D11DepthStencilView *>(expected.ptr());
+      return DiscardTexture(dsv->__texture(), dsv->__viewId());
+    }
+    // SRV/UAV may cover only a part of a subresource range of an attachment, ignored
+  }
+
+  void
+  DiscardTexture(Rc<Texture> &&texture, unsigned viewId) {
+    /**
+    The current render pass has to end so its store action can be changed
+     */
+    switch (cmdbuf_state) {
+    case CommandBufferState::RenderEncoderActive:
+    case CommandBufferState::RenderPipelineReady:
+    case CommandBufferState::TessellationRenderPipelineReady:
+    case CommandBufferState::GeometryRenderPipelineReady: {
+      bool attached = state_.OutputMerger.DSV && state_.OutputMerger.DSV->__texture().ptr() == texture.ptr();
+      for (unsigned i = 0; i < state_.OutputMerger.NumRTVs; i++) {
+        auto &rtv = state_.OutputMerger.RTVs[i];
+        if (rtv && rtv->__texture().ptr() == texture.ptr())
+          attached = true;
+      }
+      if (attached)
+        InvalidateCurrentPass();
+      break;
+    }
+    default:
+      break;
+    }
+    EmitST([texture = std::move(texture), viewId](ArgumentEncodingContext &enc) mutable {
+      enc.discardTexture(forward_rc(texture), viewId);
+    });
   }
 #pragma endregion
 
@@ -1081,18 +1160,20 @@ public:
     DrawCallStatus status = PreDraw<false>();
     if (status == DrawCallStatus::Invalid)
       return;
+    CountDraw(VertexCount, 1);
     if (status == DrawCallStatus::Geometry) {
       return GeometryDraw(VertexCount, 1, StartVertexLocation, 0);
     }
     if (ControlPointCount) {
       return TessellationDraw(ControlPointCount, VertexCount, 1, StartVertexLocation, 0);
     }
-    EmitOP([Primitive, StartVertexLocation, VertexCount](ArgumentEncodingContext& enc) {
-      enc.bumpVisibilityResultOffset();
-      enc.encodeRenderCommand([&](RenderCommandContext& ctx) {
-        ctx.encoder->drawPrimitives(Primitive, StartVertexLocation, VertexCount);
-      });
-    });
+    pending_work_estimate += VertexCount;
+    auto draw = EmitRecordOP<DrawRecord>();
+    draw->primitive = Primitive;
+    draw->vertex_start = StartVertexLocation;
+    draw->vertex_count = VertexCount;
+    draw->instance_count = 1;
+    draw->base_instance = 0;
   }
 
   void
@@ -1104,6 +1185,7 @@ public:
     DrawCallStatus status = PreDraw<true>();
     if (status == DrawCallStatus::Invalid)
       return;
+    CountDraw(IndexCount, 1);
     if (status == DrawCallStatus::Geometry) {
       return GeometryDrawIndexed(IndexCount, StartIndexLocation, BaseVertexLocation, 1, 0);
     }
@@ -1115,15 +1197,15 @@ public:
     auto IndexBufferOffset =
         state_.InputAssembler.IndexBufferOffset +
         StartIndexLocation * (state_.InputAssembler.IndexBufferFormat == DXGI_FORMAT_R32_UINT ? 4 : 2);
-    EmitOP([IndexType, IndexBufferOffset, Primitive, IndexCount, BaseVertexLocation](ArgumentEncodingContext &enc) {
-      enc.bumpVisibilityResultOffset();
-      enc.encodeRenderCommand([&, index_buffer = Obj(enc.currentIndexBuffer())](RenderCommandContext &ctx) {
-        assert(index_buffer);
-        ctx.encoder->drawIndexedPrimitives(
-            Primitive, IndexCount, IndexType, index_buffer, IndexBufferOffset, 1, BaseVertexLocation, 0
-        );
-      });
-    });
+    pending_work_estimate += IndexCount;
+    auto draw = EmitRecordOP<DrawIndexedRecord>();
+    draw->primitive = Primitive;
+    draw->index_type = IndexType;
+    draw->index_count = IndexCount;
+    draw->instance_count = 1;
+    draw->base_vertex = BaseVertexLocation;
+    draw->base_instance = 0;
+    draw->index_buffer_offset = IndexBufferOffset;
   }
 
   void
@@ -1136,6 +1218,7 @@ public:
     DrawCallStatus status = PreDraw<false>();
     if (status == DrawCallStatus::Invalid)
       return;
+    CountDraw(VertexCountPerInstance, InstanceCount);
     if (status == DrawCallStatus::Geometry) {
       return GeometryDraw(VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation);
     }
@@ -1144,15 +1227,13 @@ public:
           ControlPointCount, VertexCountPerInstance, InstanceCount, StartVertexLocation, StartInstanceLocation
       );
     }
-    EmitOP([Primitive, StartVertexLocation, VertexCountPerInstance, InstanceCount,
-          StartInstanceLocation](ArgumentEncodingContext &enc) {
-      enc.bumpVisibilityResultOffset();
-      enc.encodeRenderCommand([&](RenderCommandContext &ctx) {
-        ctx.encoder->drawPrimitives(
-            Primitive, StartVertexLocation, VertexCountPerInstance, InstanceCount, StartInstanceLocation
-        );
-      });
-    });
+    pending_work_estimate += uint64_t(VertexCountPerInstance) * InstanceCount;
+    auto draw = EmitRecordOP<DrawRecord>();
+    draw->primitive = Primitive;
+    draw->vertex_start = StartVertexLocation;
+    draw->vertex_count = VertexCountPerInstance;
+    draw->instance_count = InstanceCount;
+    draw->base_instance = StartInstanceLocation;
   }
 
   void
@@ -1167,6 +1248,7 @@ public:
     DrawCallStatus status = PreDraw<true>();
     if (status == DrawCallStatus::Invalid)
       return;
+    CountDraw(IndexCountPerInstance, InstanceCount);
     if (status == DrawCallStatus::Geometry) {
       return GeometryDrawIndexed(
           IndexCountPerInstance, StartIndexLocation, BaseVertexLocation, InstanceCount, StartInstanceLocation
@@ -1183,17 +1265,15 @@ public:
     auto IndexBufferOffset =
         state_.InputAssembler.IndexBufferOffset +
         StartIndexLocation * (state_.InputAssembler.IndexBufferFormat == DXGI_FORMAT_R32_UINT ? 4 : 2);
-    EmitOP([IndexType, IndexBufferOffset, Primitive, InstanceCount, BaseVertexLocation, StartInstanceLocation,
-          IndexCountPerInstance](ArgumentEncodingContext &enc) {
-      enc.bumpVisibilityResultOffset();
-      enc.encodeRenderCommand([&, index_buffer = Obj(enc.currentIndexBuffer())](RenderCommandContext &ctx) {
-        assert(index_buffer);
-        ctx.encoder->drawIndexedPrimitives(
-            Primitive, IndexCountPerInstance, IndexType, index_buffer, IndexBufferOffset, InstanceCount,
-            BaseVertexLocation, StartInstanceLocation
-        );
-      });
-    });
+    pending_work_estimate += uint64_t(IndexCountPerInstance) * InstanceCount;
+    auto draw = EmitRecordOP<DrawIndexedRecord>();
+    draw->primitive = Primitive;
+    draw->index_type = IndexType;
+    draw->index_count = IndexCountPerInstance;
+    draw->instance_count = InstanceCount;
+    draw->base_vertex = BaseVertexLocation;
+    draw->base_instance = StartInstanceLocation;
+    draw->index_buffer_offset = IndexBufferOffset;
   }
 
   void
@@ -1204,6 +1284,8 @@ public:
     assert(NumControlPoint);
 
     EmitOP([=](ArgumentEncodingContext &enc) {
+      if (enc.checkPredicate(false) == PredicateResult::Skip)
+        return;
       auto offset = enc.allocate_gpu_heap(sizeof(DXMT_DRAW_ARGUMENTS), 4);
       DXMT_DRAW_ARGUMENTS *draw_arugment = enc.get_gpu_heap_pointer<DXMT_DRAW_ARGUMENTS>(offset);
       draw_arugment->StartVertex = StartVertexLocation;
@@ -1260,6 +1342,8 @@ public:
     auto IndexBufferOffset = state_.InputAssembler.IndexBufferOffset;
 
     EmitOP([=](ArgumentEncodingContext &enc) {
+      if (enc.checkPredicate(false) == PredicateResult::Skip)
+        return;
       auto offset = enc.allocate_gpu_heap(sizeof(DXMT_DRAW_INDEXED_ARGUMENTS), 4);
       DXMT_DRAW_INDEXED_ARGUMENTS *draw_arugment = enc.get_gpu_heap_pointer<DXMT_DRAW_INDEXED_ARGUMENTS>(offset);
       draw_arugment->BaseVertex = BaseVertexLocation;
@@ -1315,6 +1399,8 @@ public:
       UINT StartInstanceLocation
   ) {
     EmitOP([=, topo = state_.InputAssembler.Topology](ArgumentEncodingContext &enc) {
+      if (enc.checkPredicate(false) == PredicateResult::Skip)
+        return;
       auto offset = enc.allocate_gpu_heap(sizeof(DXMT_DRAW_ARGUMENTS), 4);
       DXMT_DRAW_ARGUMENTS *draw_arugment = enc.get_gpu_heap_pointer<DXMT_DRAW_ARGUMENTS>(offset);
       draw_arugment->StartVertex = StartVertexLocation;
@@ -1341,6 +1427,8 @@ public:
     auto IndexBufferOffset = state_.InputAssembler.IndexBufferOffset;
 
     EmitOP([=, topo = state_.InputAssembler.Topology](ArgumentEncodingContext &enc) {
+      if (enc.checkPredicate(false) == PredicateResult::Skip)
+        return;
       auto offset = enc.allocate_gpu_heap(sizeof(DXMT_DRAW_INDEXED_ARGUMENTS), 4);
       DXMT_DRAW_INDEXED_ARGUMENTS *draw_arugment = enc.get_gpu_heap_pointer<DXMT_DRAW_INDEXED_ARGUMENTS>(offset);
       draw_arugment->BaseVertex = BaseVertexLocation;
@@ -1370,6 +1458,7 @@ public:
     DrawCallStatus status = PreDraw<true>();
     if (status == DrawCallStatus::Invalid)
       return;
+    pipeline_statistics.indirect();
     if (status == DrawCallStatus::Geometry) {
       return GeometryDrawIndexedIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
     }
@@ -1385,6 +1474,8 @@ public:
     if (auto bindable = reinterpret_cast<D3D11ResourceCommon *>(pBufferForArgs)) {
       EmitOP([IndexType, IndexBufferOffset, Primitive, ArgBuffer = bindable->buffer(),
             AlignedByteOffsetForArgs](ArgumentEncodingContext &enc) {
+        if (enc.checkPredicate(false) == PredicateResult::Skip)
+          return;
         auto buffer = enc.access(ArgBuffer, AlignedByteOffsetForArgs, 20, DXMT_ENCODER_RESOURCE_ACESS_READ);
         enc.bumpVisibilityResultOffset();
         enc.encodeRenderCommand([&, buffer, index_buffer = Obj(enc.currentIndexBuffer())](RenderCommandContext &ctx) {
@@ -1405,6 +1496,7 @@ public:
     DrawCallStatus status = PreDraw<false>();
     if (status == DrawCallStatus::Invalid)
       return;
+    pipeline_statistics.indirect();
     if (status == DrawCallStatus::Geometry) {
       return GeometryDrawIndirect(pBufferForArgs, AlignedByteOffsetForArgs);
     }
@@ -1416,6 +1508,8 @@ public:
     }
     if (auto bindable = reinterpret_cast<D3D11ResourceCommon *>(pBufferForArgs)) {
       EmitOP([Primitive, ArgBuffer = bindable->buffer(), AlignedByteOffsetForArgs](ArgumentEncodingContext &enc) {
+        if (enc.checkPredicate(false) == PredicateResult::Skip)
+          return;
         auto buffer = enc.access(ArgBuffer, AlignedByteOffsetForArgs, 20, DXMT_ENCODER_RESOURCE_ACESS_READ);
         enc.bumpVisibilityResultOffset();
         enc.encodeRenderCommand([&, buffer](RenderCommandContext &ctx) {
@@ -1431,6 +1525,8 @@ public:
   ) {
     if (auto bindable = reinterpret_cast<D3D11ResourceCommon *>(pBufferForArgs)) {
       EmitOP([=, topo = state_.InputAssembler.Topology, ArgBuffer = bindable->buffer()](ArgumentEncodingContext &enc) {
+        if (enc.checkPredicate(false) == PredicateResult::Skip)
+          return;
         auto buffer = enc.access(ArgBuffer, AlignedByteOffsetForArgs, 20, DXMT_ENCODER_RESOURCE_ACESS_READ);
         auto dispatch_arg_offset = enc.allocate_gpu_heap(sizeof(DXMT_DISPATCH_ARGUMENTS), 4);
   
@@ -1458,6 +1554,8 @@ public:
 
     if (auto bindable = reinterpret_cast<D3D11ResourceCommon *>(pBufferForArgs)) {
       EmitOP([=, topo = state_.InputAssembler.Topology, ArgBuffer = bindable->buffer()](ArgumentEncodingContext &enc) {
+        if (enc.checkPredicate(false) == PredicateResult::Skip)
+          return;
         auto buffer = enc.access(ArgBuffer, AlignedByteOffsetForArgs, 20, DXMT_ENCODER_RESOURCE_ACESS_READ);
         auto dispatch_arg_offset = enc.allocate_gpu_heap(sizeof(DXMT_DISPATCH_ARGUMENTS), 4);
   
@@ -1487,19 +1585,22 @@ public:
   Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override {
     if (!PreDispatch())
       return;
-    EmitOP([ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ](ArgumentEncodingContext &enc) {
-      enc.encodeComputeCommand([&](ComputeCommandContext &ctx) {
-        ctx.encoder->dispatchThreadgroups(
-            MTL::Size::Make(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ), ctx.threadgroup_size
-        );
-      });
-    });
+    auto &tg_size = GetManagedShader<PipelineStage::Compute>()->reflection().ThreadgroupSize;
+    uint64_t threadgroup_count = uint64_t(ThreadGroupCountX) * ThreadGroupCountY * ThreadGroupCountZ;
+    uint64_t threads_per_threadgroup = uint64_t(tg_size[0]) * tg_size[1] * tg_size[2];
+    pending_work_estimate += threadgroup_count * threads_per_threadgroup;
+    pipeline_statistics.dispatch(threadgroup_count, threads_per_threadgroup);
+    auto dispatch = EmitRecordOP<DispatchRecord>();
+    dispatch->threadgroup_count_x = ThreadGroupCountX;
+    dispatch->threadgroup_count_y = ThreadGroupCountY;
+    dispatch->threadgroup_count_z = ThreadGroupCountZ;
   }
 
   void
   DispatchIndirect(ID3D11Buffer *pBufferForArgs, UINT AlignedByteOffsetForArgs) override {
     if (!PreDispatch())
       return;
+    pipeline_statistics.indirect();
     if (auto bindable = reinterpret_cast<D3D11ResourceCommon *>(pBufferForArgs)) {
       EmitOP([AlignedByteOffsetForArgs, ArgBuffer = bindable->buffer()](ArgumentEncodingContext &enc) {
         auto buffer = enc.access(ArgBuffer, AlignedByteOffsetForArgs, 12, DXMT_ENCODER_RESOURCE_ACESS_READ);
@@ -1532,7 +1633,29 @@ public:
     state_.predicate = pPredicate;
     state_.predicate_value = PredicateValue;
 
-    EmitST([](ArgumentEncodingContext &enc) { enc.setCompatibilityFlag(FeatureCompatibility::UnsupportedPredication); });
+    RestorePredication();
+  }
+
+  void
+  RestorePredication() {
+    if (!state_.predicate) {
+      EmitST([](ArgumentEncodingContext &enc) { enc.setPredicate({}, false); });
+      return;
+    }
+    D3D11_QUERY_DESC desc;
+    state_.predicate->GetDesc(&desc);
+    if (desc.Query != D3D11_QUERY_OCCLUSION_PREDICATE) {
+      EmitST([](ArgumentEncodingContext &enc) {
+        enc.setCompatibilityFlag(FeatureCompatibility::UnsupportedPredication);
+        enc.setPredicate({}, false);
+      });
+      return;
+    }
+    // draws are skipped, or zeroed by GPU when the predicate matches; other commands are not predicated
+    auto query = reinterpret_cast<IMTLD3DOcclusionQuery *>(state_.predicate.ptr());
+    EmitST([query = query->__query(), value = bool(state_.predicate_value)](ArgumentEncodingContext &enc) mutable {
+      enc.setPredicate(std::move(query), value);
+    });
   }
 
   //-----------------------------------------------------------------------------
@@ -1556,8 +1679,12 @@ public:
   IASetInputLayout(ID3D11InputLayout *pInputLayout) override {
     if (auto expected = com_cast<IMTLD3D11InputLayout>(pInputLayout)) {
       state_.InputAssembler.InputLayout = std::move(expected);
+      vertex_buffer_binding_.setInputLayout(
+          true, state_.InputAssembler.InputLayout->GetManagedInputLayout()->input_slot_mask()
+      );
     } else {
       state_.InputAssembler.InputLayout = nullptr;
+      vertex_buffer_binding_.setInputLayout(false, 0);
     }
     InvalidateRenderPipeline();
   }
@@ -2479,6 +2606,8 @@ public:
 
   template <CommandWithContext<ArgumentEncodingContext> cmd> void EmitST(cmd &&fn);
   template <CommandWithContext<ArgumentEncodingContext> cmd> void EmitOP(cmd &&fn);
+  template <typename Record> Record *EmitRecordST(uint32_t extra = 0);
+  template <typename Record> Record *EmitRecordOP(uint32_t extra = 0);
 
   template <typename T> moveonly_list<T> AllocateCommandData(size_t n = 1);
 
@@ -2510,6 +2639,10 @@ public:
     }
 
     if (reflection->NumArguments && (dirty_sampler || dirty_srv || dirty_uav)) {
+      if constexpr (stage != PipelineStage::Compute) {
+        if (dirty_srv)
+          TrackSampledTextures(ShaderStage.SRVs, reflection);
+      }
       EmitST([reflection](ArgumentEncodingContext &enc) { enc.encodeShaderResources<stage, kind>(reflection); });
       ShaderStage.Samplers.clear_dirty();
       ShaderStage.SRVs.clear_dirty();
@@ -2519,6 +2652,16 @@ public:
     }
   }
 
+  void
+  TrackSampledTextures(const SRVBindingSet &SRVs, const MTL_SHADER_REFLECTION *reflection) {
+    for (auto [slot, entry] : SRVs) {
+      uint64_t mask = slot < 64 ? reflection->SRVSlotMaskLo : reflection->SRVSlotMaskHi;
+      if (!(mask & (1ull << (slot & 63))))
+        continue;
+      render_pass_usage.sample(entry.SRV->texture().ptr());
+    }
+  }
+
   void
   UpdateVertexBuffer() {
     if (!state_.InputAssembler.InputLayout)
@@ -2539,7 +2682,10 @@ public:
       EmitST([slot_mask](ArgumentEncodingContext &enc) { enc.encodeVertexBuffers<PipelineKind::Geometry>(slot_mask); });
     }
     if (cmdbuf_state == CommandBufferState::RenderPipelineReady) {
-      EmitST([slot_mask](ArgumentEncodingContext &enc) { enc.encodeVertexBuffers<PipelineKind::Ordinary>(slot_mask); });
+      if (vertex_stage_in_)
+        EmitST([slot_mask](ArgumentEncodingContext &enc) { enc.encodeVertexBuffersStageIn(slot_mask); });
+      else
+        EmitST([slot_mask](ArgumentEncodingContext &enc) { enc.encodeVertexBuffers<PipelineKind::Ordinary>(slot_mask); });
     }
 
     VertexBuffers.clear_dirty_mask(slot_mask);
@@ -2636,45 +2782,84 @@ public:
   ) {
     auto &ShaderStage = state_.ShaderStages[Stage];
 
-    for (unsigned slot = StartSlot; slot < StartSlot + NumBuffers; slot++) {
-      auto pConstantBuffer = ppConstantBuffers[slot - StartSlot];
-      if (pConstantBuffer) {
-        bool replaced = false;
-        auto &entry = ShaderStage.ConstantBuffers.bind(slot, {pConstantBuffer}, replaced);
-        if (!replaced) {
-          if (pFirstConstant &&
-              pFirstConstant[slot - StartSlot] != entry.FirstConstant) {
-            ShaderStage.ConstantBuffers.set_dirty(slot);
-            entry.FirstConstant = pFirstConstant[slot - StartSlot];
-            EmitST([=, offset = entry.FirstConstant
-                                << 4](ArgumentEncodingContext &enc) mutable {
-              enc.bindConstantBufferOffset<Stage>(slot, offset);
-            });
-          }
-          if (pNumConstants && pNumConstants[slot - StartSlot] != entry.NumConstants) {
-            ShaderStage.ConstantBuffers.set_dirty(slot);
-            entry.NumConstants = pNumConstants[slot - StartSlot];
-          }
+    uint64_t changed =
+        ShaderStage.ConstantBuffers.changed_mask(StartSlot, NumBuffers, (const void *const *)ppConstantBuffers);
+
+    if (pFirstConstant || pNumConstants) {
+      for (unsigned slot = StartSlot; slot < StartSlot + NumBuffers; slot++) {
+        if (!ppConstantBuffers[slot - StartSlot] || (changed & (1ull << (slot - StartSlot))))
           continue;
+        auto &entry = ShaderStage.ConstantBuffers.at(slot);
+        if (pFirstConstant && pFirstConstant[slot - StartSlot] != entry.FirstConstant) {
+          ShaderStage.ConstantBuffers.set_dirty(slot);
+          entry.FirstConstant = pFirstConstant[slot - StartSlot];
+          auto bind = EmitRecordST<BindConstantBufferOffsetRecord>();
+          bind->stage = Stage;
+          bind->slot = slot;
+          bind->offset = entry.FirstConstant << 4;
         }
-        entry.FirstConstant = pFirstConstant ? pFirstConstant[slot - StartSlot] : 0;
-        if (pNumConstants) {
+        if (pNumConstants && pNumConstants[slot - StartSlot] != entry.NumConstants) {
+          ShaderStage.ConstantBuffers.set_dirty(slot);
           entry.NumConstants = pNumConstants[slot - StartSlot];
-        } else {
-          D3D11_BUFFER_DESC desc;
-          pConstantBuffer->GetDesc(&desc);
-          entry.NumConstants = desc.ByteWidth >> 4;
         }
-        entry.Buffer = reinterpret_cast<D3D11ResourceCommon *>(pConstantBuffer);
-        EmitST([=, buffer = entry.Buffer->buffer(), offset = entry.FirstConstant << 4](ArgumentEncodingContext &enc
-             ) mutable { enc.bindConstantBuffer<Stage>(slot, offset, forward_rc(buffer)); });
-      } else {
+      }
+    }
+
+    while (changed) {
+      unsigned first = bit::tzcnt(changed);
+      unsigned count = bit::tzcnt(~(changed >> first));
+      SetConstantBufferRange<Stage>(
+          StartSlot + first, count, ppConstantBuffers + first, pFirstConstant ? pFirstConstant + first : nullptr,
+          pNumConstants ? pNumConstants + first : nullptr
+      );
+      changed &= ~((count == 64 ? ~0ull : ((1ull << count) - 1)) << first);
+    }
+  }
+
+  /**
+  Bind a contiguous range of slots that are known to be changed, with a
+  single command
+  */
+  template <PipelineStage Stage>
+  void
+  SetConstantBufferRange(
+      UINT StartSlot, UINT NumBuffers, ID3D11Buffer *const *ppConstantBuffers, const UINT *pFirstConstant,
+      const UINT *pNumConstants
+  ) {
+    struct CONSTANT_BUFFER_STATE {
+      Rc<Buffer> Buffer{};
+      UINT Offset = 0;
+    };
+    auto &ShaderStage = state_.ShaderStages[Stage];
+    auto buffers = AllocateCommandData<CONSTANT_BUFFER_STATE>(NumBuffers);
+
+    for (unsigned i = 0; i < NumBuffers; i++) {
+      auto pConstantBuffer = ppConstantBuffers[i];
+      if (!pConstantBuffer) {
         // BIND NULL
-        if (ShaderStage.ConstantBuffers.unbind(slot)) {
-          EmitST([=](ArgumentEncodingContext &enc) { enc.bindConstantBuffer<Stage>(slot, 0, {}); });
-        }
+        ShaderStage.ConstantBuffers.unbind(StartSlot + i);
+        continue;
       }
+      bool replaced = false;
+      auto &entry = ShaderStage.ConstantBuffers.bind(StartSlot + i, {pConstantBuffer}, replaced);
+      entry.FirstConstant = pFirstConstant ? pFirstConstant[i] : 0;
+      if (pNumConstants) {
+        entry.NumConstants = pNumConstants[i];
+      } else {
+        D3D11_BUFFER_DESC desc;
+        pConstantBuffer->GetDesc(&desc);
+        entry.NumConstants = desc.ByteWidth >> 4;
+      }
+      entry.Buffer = reinterpret_cast<D3D11ResourceCommon *>(pConstantBuffer);
+      buffers[i].Buffer = entry.Buffer->buffer();
+      buffers[i].Offset = entry.FirstConstant << 4;
     }
+
+    EmitST([StartSlot, buffers = std::move(buffers)](ArgumentEncodingContext &enc) mutable {
+      for (unsigned i = 0; i < buffers.size(); i++) {
+        enc.bindConstantBuffer<Stage>(StartSlot + i, buffers[i].Offset, forward_rc(buffers[i].Buffer));
+      }
+    });
   }
 
   template <PipelineStage Stage>
@@ -2707,35 +2892,66 @@ public:
   template <PipelineStage Stage>
   void
   SetShaderResource(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews) {
+    auto &ShaderStage = state_.ShaderStages[Stage];
+
+    for (unsigned base = 0; base < NumViews; base += 64) {
+      unsigned num = std::min(NumViews - base, 64u);
+      uint64_t changed = ShaderStage.SRVs.changed_mask(
+          StartSlot + base, num, (const void *const *)ppShaderResourceViews + base
+      );
+      while (changed) {
+        unsigned first = bit::tzcnt(changed);
+        unsigned count = bit::tzcnt(~(changed >> first));
+        SetShaderResourceRange<Stage>(StartSlot + base + first, count, ppShaderResourceViews + base + first);
+        changed &= ~((count == 64 ? ~0ull : ((1ull << count) - 1)) << first);
+      }
+    }
+  }
 
+  /**
+  Bind a contiguous range of slots that are known to be changed, with a
+  single command
+  */
+  template <PipelineStage Stage>
+  void
+  SetShaderResourceRange(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews) {
+    struct SHADER_RESOURCE_STATE {
+      Rc<Buffer> Buffer{};
+      Rc<Texture> Texture{};
+      unsigned ViewId = 0;
+      BufferSlice Slice{};
+    };
     auto &ShaderStage = state_.ShaderStages[Stage];
-    for (unsigned slot = StartSlot; slot < StartSlot + NumViews; slot++) {
-      auto pView = static_cast<D3D11ShaderResourceView *>(ppShaderResourceViews[slot - StartSlot]);
-      if (pView) {
-        bool replaced = false;
-        auto &entry = ShaderStage.SRVs.bind(slot, {pView}, replaced);
-        if (!replaced)
-          continue;
-        entry.SRV = pView;
-        if (auto buffer = entry.SRV->buffer()) {
-          EmitST([=, buffer = std::move(buffer), viewId = pView->viewId(),
-                slice = pView->bufferSlice()](ArgumentEncodingContext &enc) mutable {
-            enc.bindBuffer<Stage>(slot, forward_rc(buffer), viewId, slice);
-          });
-        } else {
-          EmitST([=, texture = pView->texture(), viewId = pView->viewId()](ArgumentEncodingContext &enc) mutable {
-            enc.bindTexture<Stage>(slot, forward_rc(texture), viewId);
-          });
-        }
-      } else {
+    auto views = AllocateCommandData<SHADER_RESOURCE_STATE>(NumViews);
+
+    for (unsigned i = 0; i < NumViews; i++) {
+      auto pView = static_cast<D3D11ShaderResourceView *>(ppShaderResourceViews[i]);
+      if (!pView) {
         // BIND NULL
-        if (ShaderStage.SRVs.unbind(slot)) {
-          EmitST([=](ArgumentEncodingContext& enc) {
-            enc.bindBuffer<Stage>(slot, {}, 0, {});
-          });
-        }
+        ShaderStage.SRVs.unbind(StartSlot + i);
+        continue;
+      }
+      bool replaced = false;
+      auto &entry = ShaderStage.SRVs.bind(StartSlot + i, {pView}, replaced);
+      entry.SRV = pView;
+      views[i].ViewId = pView->viewId();
+      if (auto buffer = pView->buffer()) {
+        views[i].Buffer = std::move(buffer);
+        views[i].Slice = pView->bufferSlice();
+      } else {
+        views[i].Texture = pView->texture();
       }
     }
+
+    EmitST([StartSlot, views = std::move(views)](ArgumentEncodingContext &enc) mutable {
+      for (unsigned i = 0; i < views.size(); i++) {
+        auto &view = views[i];
+        if (view.Texture)
+          enc.bindTexture<Stage>(StartSlot + i, forward_rc(view.Texture), view.ViewId);
+        else
+          enc.bindBuffer<Stage>(StartSlot + i, forward_rc(view.Buffer), view.ViewId, view.Slice);
+      }
+    });
   }
 
   template <PipelineStage Stage>
@@ -2767,18 +2983,22 @@ public:
           continue;
         if (auto expected = com_cast<IMTLD3D11SamplerState>(pSampler)) {
           entry.Sampler = expected.ptr();
-          EmitST([=, sampler = entry.Sampler](ArgumentEncodingContext &enc) {
-            enc.bindSampler<Stage>(Slot, sampler->GetSamplerState(), sampler->GetLODBias());
-          });
+          auto bind = EmitRecordST<BindSamplerRecord>();
+          bind->stage = Stage;
+          bind->slot = Slot;
+          bind->sampler = entry.Sampler->GetSamplerState();
+          bind->bias = entry.Sampler->GetLODBias();
         } else {
           D3D11_ASSERT(0 && "wtf");
         }
       } else {
         // BIND NULL
         if (ShaderStage.Samplers.unbind(Slot)) {
-          EmitST([=](ArgumentEncodingContext& enc) {
-            enc.bindSampler<Stage>(Slot, nullptr, 0);
-          });
+          auto bind = EmitRecordST<BindSamplerRecord>();
+          bind->stage = Stage;
+          bind->slot = Slot;
+          bind->sampler = nullptr;
+          bind->bias = 0;
         }
       }
     }
@@ -2841,6 +3061,8 @@ public:
       auto pUAV = static_cast<D3D11UnorderedAccessView*>(ppUnorderedAccessViews[slot - StartSlot]);
       auto InitialCount = pUAVInitialCounts ? pUAVInitialCounts[slot - StartSlot] : ~0u;
       if (pUAV) {
+        if constexpr (Stage != PipelineStage::Compute)
+          render_pass_usage.bindUAV();
         bool replaced = false;
         auto &entry = binding_set.bind(slot, {pUAV}, replaced);
         if (InitialCount != ~0u) {
@@ -2888,6 +3110,7 @@ public:
       if (pVertexBuffer) {
         bool replaced = false;
         auto &entry = VertexBuffers.bind(slot, {pVertexBuffer}, replaced);
+        vertex_buffer_binding_.setBound(slot, true);
         if (!replaced) {
           if (pStrides && pStrides[slot - StartSlot] != entry.Stride) {
             VertexBuffers.set_dirty(slot);
@@ -2897,10 +3120,10 @@ public:
             VertexBuffers.set_dirty(slot);
             entry.Offset = pOffsets[slot - StartSlot];
           }
-          EmitST([=, offset = entry.Offset,
-                stride = entry.Stride](ArgumentEncodingContext &enc) mutable {
-            enc.bindVertexBufferOffset(slot, offset, stride);
-          });
+          auto bind = EmitRecordST<BindVertexBufferOffsetRecord>();
+          bind->slot = slot;
+          bind->offset = entry.Offset;
+          bind->stride = entry.Stride;
           continue;
         }
         if (pStrides) {
@@ -2922,6 +3145,7 @@ public:
         });
       } else {
         if (VertexBuffers.unbind(slot)) {
+          vertex_buffer_binding_.setBound(slot, false);
           EmitST([=](ArgumentEncodingContext& enc) {
             enc.bindVertexBuffer(slot, 0, 0, {});
           });
@@ -2957,6 +3181,13 @@ public:
 
 #pragma region CopyResource
 
+  /**
+  Whole buffer copy without a blit: the destination shares the allocation of
+  the source, and a physical copy is only made once either of them is written.
+  Returns false if not applicable.
+  */
+  bool AliasBuffer(ID3D11Buffer *pDstResource, ID3D11Buffer *pSrcResource);
+
   void
   CopyBuffer(
       ID3D11Buffer *pDstResource, uint32_t DstSubresource, uint32_t DstX, uint32_t DstY, uint32_t DstZ,
@@ -3224,21 +3455,10 @@ public:
     if (auto dst = GetTexture(cmd.pDst)) {
       auto bytes_per_depth_slice = cmd.EffectiveRows * cmd.EffectiveBytesPerRow;
       auto [ptr, staging_buffer, offset] = AllocateStagingBuffer(bytes_per_depth_slice * cmd.DstRegion.size.depth, 16);
-      if (cmd.EffectiveBytesPerRow == SrcRowPitch) {
-        for (unsigned depthSlice = 0; depthSlice < cmd.DstRegion.size.depth; depthSlice++) {
-          char *dst = ((char *)ptr) + depthSlice * bytes_per_depth_slice;
-          const char *src = ((const char *)pSrcData) + depthSlice * SrcDepthPitch;
-          memcpy(dst, src, bytes_per_depth_slice);
-        }
-      } else {
-        for (unsigned depthSlice = 0; depthSlice < cmd.DstRegion.size.depth; depthSlice++) {
-          for (unsigned row = 0; row < cmd.EffectiveRows; row++) {
-            char *dst = ((char *)ptr) + row * cmd.EffectiveBytesPerRow + depthSlice * bytes_per_depth_slice;
-            const char *src = ((const char *)pSrcData) + row * SrcRowPitch + depthSlice * SrcDepthPitch;
-            memcpy(dst, src, cmd.EffectiveBytesPerRow);
-          }
-        }
-      }
+      copy_rows(
+          ptr, cmd.EffectiveBytesPerRow, bytes_per_depth_slice, pSrcData, SrcRowPitch, SrcDepthPitch,
+          cmd.EffectiveBytesPerRow, cmd.EffectiveRows, cmd.DstRegion.size.depth
+      );
       SwitchToBlitEncoder(CommandBufferState::UpdateBlitEncoderActive);
       EmitOP([staging_buffer, offset, dst = std::move(dst), cmd = std::move(cmd),
             bytes_per_depth_slice](ArgumentEncodingContext &enc) {
@@ -3264,6 +3484,41 @@ public:
 
   bool promote_flush = false;
 
+  RenderPassUsage<Texture> render_pass_usage;
+
+  /**
+  Commands and estimated GPU work (in vertices/threads) recorded since the
+  last commit. Used by immediate context to commit chunks adaptively.
+  */
+  uint32_t pending_command_count = 0;
+  uint64_t pending_work_estimate = 0;
+
+  /**
+  Accumulated over the lifetime of context, see PipelineStatisticsCounter
+  */
+  PipelineStatisticsCounter pipeline_statistics;
+
+  void
+  CountDraw(uint64_t VertexCount, uint64_t InstanceCount) {
+    pipeline_statistics.draw(
+        state_.InputAssembler.Topology, VertexCount, InstanceCount,
+        state_.ShaderStages[PipelineStage::Geometry].Shader.ptr() != nullptr,
+        state_.ShaderStages[PipelineStage::Hull].Shader.ptr() != nullptr
+    );
+  }
+
+  /**
+  Called right after a pass has ended. Return true to commit the current
+  chunk at this point, so GPU can start working on it before flush/present.
+  */
+  bool ShouldCommitEarly();
+
+  /**
+  Called right after a pass has ended. Event queries ended inside a pass are
+  signaled here instead of splitting the pass.
+  */
+  void SignalPendingEvent();
+
   /**
   Render pass can be invalidated by reasons:
   - render target changes (including depth stencil)
@@ -3274,8 +3529,10 @@ public:
   */
   bool
   InvalidateCurrentPass(bool defer_commit = false) {
+    bool pass_ended = true;
     switch (cmdbuf_state) {
     case CommandBufferState::Idle:
+      pass_ended = false;
       break;
     case CommandBufferState::RenderEncoderActive:
     case CommandBufferState::RenderPipelineReady:
@@ -3308,6 +3565,10 @@ public:
     }
 
     cmdbuf_state = CommandBufferState::Idle;
+    if (pass_ended)
+      SignalPendingEvent();
+    if (pass_ended && !promote_flush && !defer_commit && ShouldCommitEarly())
+      promote_flush = true;
     if (promote_flush && !defer_commit) {
       Commit();
       return true;
@@ -3397,6 +3658,7 @@ public:
     if (cmdbuf_state == CommandBufferState::RenderEncoderActive)
       return true;
     InvalidateCurrentPass();
+    render_pass_usage.begin(state_.OutputMerger.UAVs.any_bound());
 
     // set dirty state
     state_.ShaderStages[PipelineStage::Vertex].ConstantBuffers.set_dirty();
@@ -3411,6 +3673,8 @@ public:
     state_.ShaderStages[PipelineStage::Domain].ConstantBuffers.set_dirty();
     state_.ShaderStages[PipelineStage::Domain].Samplers.set_dirty();
     state_.ShaderStages[PipelineStage::Domain].SRVs.set_dirty();
+    // so that textures sampled by GS are tracked in the new pass as well
+    state_.ShaderStages[PipelineStage::Geometry].SRVs.set_dirty();
     state_.InputAssembler.VertexBuffers.set_dirty();
     dirty_state.set(
         DirtyState::BlendFactorAndStencilRef, DirtyState::RasterizerState, DirtyState::DepthStencilState,
@@ -3492,7 +3756,9 @@ public:
           auto colorAttachment = renderPassDescriptor->colorAttachments()->object(rtv.RenderTargetIndex);
           colorAttachment->setTexture(rtv.Texture->view(rtv.viewId));
           colorAttachment->setDepthPlane(rtv.DepthPlane);
-          colorAttachment->setLoadAction(rtv.LoadAction);
+          colorAttachment->setLoadAction(
+              ctx.takeDiscardedAttachment(rtv.Texture, rtv.viewId) ? MTL::LoadActionDontCare : rtv.LoadAction
+          );
           colorAttachment->setStoreAction(MTL::StoreActionStore);
         };
         uint32_t dsv_planar_flags = 0;
@@ -3500,18 +3766,19 @@ public:
         if (dsv.Texture.ptr()) {
           dsv_planar_flags = DepthStencilPlanarFlags(dsv.PixelFormat);
           MTL::Texture *texture = dsv.Texture->view(dsv.viewId);
-          // TODO: ...should know more about store behavior (e.g. DiscardView)
+          // store action may become DontCare later by a discard, see `discardTexture`
+          bool discarded = ctx.takeDiscardedAttachment(dsv.Texture, dsv.viewId);
           if (dsv_planar_flags & 1) {
             auto depthAttachment = renderPassDescriptor->depthAttachment();
             depthAttachment->setTexture(texture);
-            depthAttachment->setLoadAction(dsv.DepthLoadAction);
+            depthAttachment->setLoadAction(discarded ? MTL::LoadActionDontCare : dsv.DepthLoadAction);
             depthAttachment->setStoreAction(MTL::StoreActionStore);
           }
 
           if (dsv_planar_flags & 2) {
             auto stencilAttachment = renderPassDescriptor->stencilAttachment();
             stencilAttachment->setTexture(texture);
-            stencilAttachment->setLoadAction(dsv.StencilLoadAction);
+            stencilAttachment->setLoadAction(discarded ? MTL::LoadActionDontCare : dsv.StencilLoadAction);
             stencilAttachment->setStoreAction(MTL::StoreActionStore);
           }
         }
@@ -3652,6 +3919,74 @@ public:
       Desc.IndexBufferFormat = SM50_INDEX_BUFFER_FORMAT_NONE;
     }
     Desc.SampleCount = state_.OutputMerger.SampleCount;
+    Desc.VertexStageIn = false;
+    Desc.VertexBuffersBound = false;
+    Desc.PSZeroBiasSamplerMask = 0;
+  }
+
+  /**
+  Vertex fetch can go through a MTLVertexDescriptor only if the input layout
+  is expressible and every buffer it reads is bound with a stride and offset
+  aligned to 4 bytes, see d3d11_vertex_stage_in.hpp
+  */
+  bool
+  IsVertexStageInApplicable() {
+    if (!vertex_stage_in_enabled_ || !state_.InputAssembler.InputLayout)
+      return false;
+    auto layout = state_.InputAssembler.InputLayout->GetManagedInputLayout();
+    return IsStageInApplicable(
+        state_.ShaderStages[PipelineStage::Geometry].Shader.ptr() != nullptr, layout->stage_in_compatible(),
+        layout->input_slot_mask(), state_.InputAssembler.VertexBuffers
+    );
+  }
+
+  /**
+  Pulled vertices need no null binding check if every slot the input layout
+  reads is bound. Nothing is pulled with stage_in.
+  */
+  bool
+  AreVertexBuffersBound(bool stage_in) {
+    return !stage_in && vertex_buffer_binding_.allBound();
+  }
+
+  /**
+  Pixel shader samplers whose LOD bias is currently zero, see
+  d3d11_sampler_specialization.hpp
+  */
+  uint16_t
+  GetZeroBiasSamplerMask() {
+    auto PS = GetManagedShader<PipelineStage::Pixel>();
+    if (!PS)
+      return 0;
+    auto &Samplers = state_.ShaderStages[PipelineStage::Pixel].Samplers;
+    uint16_t slot_mask = PS->reflection().SamplerSlotMask;
+    uint16_t mask = 0;
+    for (unsigned slot = 0; slot < 16; slot++) {
+      if ((slot_mask & (1 << slot)) && Samplers.test_bound(slot) && Samplers[slot].Sampler->GetLODBias() == 0.0f)
+        mask |= 1 << slot;
+    }
+    return mask;
+  }
+
+  /**
+  Counts the draw for the bound pixel shader. Returns false if the current
+  pipeline is specialized for samplers that are no longer bound, or a
+  specialization has just become due.
+  */
+  bool
+  UpdateSamplerSpecialization() {
+    if (!sampler_specialization_enabled_)
+      return true;
+    auto PS = GetManagedShader<PipelineStage::Pixel>();
+    if (!PS) {
+      sampler_specialization_due_ = 0;
+      return !sampler_specialization_mask_;
+    }
+    uint16_t zero_bias_mask = GetZeroBiasSamplerMask();
+    sampler_specialization_due_ = sampler_specialization_.draw(PS->id(), zero_bias_mask);
+    return SamplerSpecialization::compatible(
+        sampler_specialization_mask_, zero_bias_mask, sampler_specialization_due_
+    );
   }
 
   template <bool IndexedDraw>
@@ -3785,8 +4120,16 @@ public:
     if (state_.ShaderStages[PipelineStage::Hull].Shader) {
       return FinalizeTessellationRenderPipeline<IndexedDraw>();
     }
-    if (cmdbuf_state == CommandBufferState::RenderPipelineReady)
-      return DrawCallStatus::Ordinary;
+    bool sampler_specialization_valid = UpdateSamplerSpecialization();
+    if (cmdbuf_state == CommandBufferState::RenderPipelineReady) {
+      if (likely(
+              vertex_stage_in_ == IsVertexStageInApplicable() &&
+              vertex_buffers_bound_ == AreVertexBuffersBound(vertex_stage_in_) &&
+              sampler_specialization_valid
+          ))
+        return DrawCallStatus::Ordinary;
+      InvalidateRenderPipeline();
+    }
     auto GS = GetManagedShader<PipelineStage::Geometry>();
     if (GS) {
       if (GS->reflection().GeometryShader.GSPassThrough == ~0u) {
@@ -3802,6 +4145,15 @@ public:
 
     MTL_GRAPHICS_PIPELINE_DESC pipelineDesc;
     InitializeGraphicsPipelineDesc<IndexedDraw>(pipelineDesc);
+    pipelineDesc.VertexStageIn = IsVertexStageInApplicable();
+    pipelineDesc.VertexBuffersBound = AreVertexBuffersBound(pipelineDesc.VertexStageIn);
+    if (sampler_specialization_enabled_) {
+      pipelineDesc.PSZeroBiasSamplerMask = sampler_specialization_due_;
+      if (pipelineDesc.PSZeroBiasSamplerMask && pipelineDesc.PSZeroBiasSamplerMask != sampler_specialization_mask_) {
+        EmitST([](ArgumentEncodingContext &enc) { enc.currentFrameStatistics().sampler_specialization_count++; });
+      }
+      sampler_specialization_mask_ = pipelineDesc.PSZeroBiasSamplerMask;
+    }
 
     device->CreateGraphicsPipeline(&pipelineDesc, &pipeline);
     EmitST([pso = std::move(pipeline)](ArgumentEncodingContext& enc) {
@@ -3823,6 +4175,12 @@ public:
       state_.ShaderStages[PipelineStage::Vertex].Samplers.set_dirty();
       previous_render_pipeline_state = CommandBufferState::RenderPipelineReady;
     }
+    if (vertex_stage_in_ != pipelineDesc.VertexStageIn) {
+      // vertex buffers are bound to different indices
+      state_.InputAssembler.VertexBuffers.set_dirty();
+      vertex_stage_in_ = pipelineDesc.VertexStageIn;
+    }
+    vertex_buffers_bound_ = pipelineDesc.VertexBuffersBound;
 
     return DrawCallStatus::Ordinary;
   }
@@ -3869,20 +4227,19 @@ public:
         state_.Rasterizer.RasterizerState ? state_.Rasterizer.RasterizerState : default_rasterizer_state;
     bool allow_scissor = current_rs->IsScissorEnabled();
     if (dirty_state.any(DirtyState::Viewport)) {
-      auto viewports = AllocateCommandData<MTL::Viewport>(state_.Rasterizer.NumViewports);
+      auto set = EmitRecordST<SetViewportsRecord>(sizeof(MTL::Viewport) * state_.Rasterizer.NumViewports);
+      set->count = state_.Rasterizer.NumViewports;
+      auto viewports = set->viewports();
       for (unsigned i = 0; i < state_.Rasterizer.NumViewports; i++) {
         auto &d3dViewport = state_.Rasterizer.viewports[i];
         viewports[i] = {d3dViewport.TopLeftX, d3dViewport.TopLeftY, d3dViewport.Width,
                         d3dViewport.Height,   d3dViewport.MinDepth, d3dViewport.MaxDepth};
       }
-      EmitST([viewports = std::move(viewports)](ArgumentEncodingContext& enc) {
-        enc.encodeRenderCommand([&](RenderCommandContext& ctx) {
-          ctx.encoder->setViewports(viewports.data(), viewports.size());
-        });
-      });
     }
     if (dirty_state.any(DirtyState::Scissors)) {
-      auto scissors = AllocateCommandData<MTL::ScissorRect>(state_.Rasterizer.NumViewports);
+      auto set = EmitRecordST<SetScissorRectsRecord>(sizeof(MTL::ScissorRect) * state_.Rasterizer.NumViewports);
+      set->count = state_.Rasterizer.NumViewports;
+      auto scissors = set->scissor_rects();
       for (unsigned i = 0; i < state_.Rasterizer.NumViewports; i++) {
         if (allow_scissor) {
           if (i < state_.Rasterizer.NumScissorRects) {
@@ -3901,11 +4258,6 @@ public:
           };
         }
       }
-      EmitST([scissors = std::move(scissors)](ArgumentEncodingContext& enc) {
-        enc.encodeRenderCommand([&](RenderCommandContext& ctx) {
-          ctx.encoder->setScissorRects(scissors.data(), scissors.size());
-        });
-      });
     }
     dirty_state.clrAll();
     if (cmdbuf_state == CommandBufferState::TessellationRenderPipelineReady) {
@@ -4091,6 +4443,9 @@ public:
         });
       }
     }
+
+    if (state_.predicate)
+      RestorePredication();
   }
 
   void ResetEncodingContextState() {
@@ -4103,6 +4458,7 @@ public:
 
   void ResetD3D11ContextState() {
     state_ = {};
+    vertex_buffer_binding_ = {};
   }
 
 protected:
@@ -4110,6 +4466,28 @@ protected:
   CommandBufferState cmdbuf_state = CommandBufferState::Idle;
   CommandBufferState previous_render_pipeline_state = CommandBufferState::Idle;
   ContextInternalState &ctx_state;
+  bool vertex_stage_in_enabled_;
+  /**
+  The current ordinary render pipeline fetches vertices with stage_in.
+  */
+  bool vertex_stage_in_ = false;
+  /**
+  The current ordinary render pipeline pulls vertices without null binding
+  check.
+  */
+  bool vertex_buffers_bound_ = false;
+  VertexBufferBinding vertex_buffer_binding_;
+  bool sampler_specialization_enabled_;
+  SamplerSpecialization sampler_specialization_;
+  /**
+  The bound pixel shader is due to be specialized for these samplers.
+  */
+  uint16_t sampler_specialization_due_ = 0;
+  /**
+  The pixel shader of the current ordinary render pipeline has no LOD bias
+  for these samplers.
+  */
+  uint16_t sampler_specialization_mask_ = 0;
 
   IMTLD3D11RasterizerState *default_rasterizer_state;
   IMTLD3D11DepthStencilState *default_depth_stencil_state;
@@ -4141,6 +4519,8 @@ public:
       state_(),
       annotation_(this),
       ext_(this) {
+    vertex_stage_in_enabled_ = Config::getInstance().getOption<bool>("d3d11.vertexStageIn", false);
+    sampler_specialization_enabled_ = Config::getInstance().getOption<bool>("d3d11.samplerSpecialization", false);
     pDevice->CreateRasterizerState2(&kDefaultRasterizerDesc, (ID3D11RasterizerState2 **)&default_rasterizer_state);
     pDevice->CreateBlendState1(&kDefaultBlendDesc, (ID3D11BlendState1 **)&default_blend_state);
     pDevice->CreateDepthStencilState(
@@ -4469,6 +4849,14 @@ public:
               allocate_cpu_heap(list.calculateCommandSize<cmd>(), 16));
   }
 
+  template <typename Record>
+  Record *
+  EmitRecord(uint32_t extra = 0) {
+    return list.emitRecord<Record>(
+        [this](size_t size, size_t alignment) { return allocate_cpu_heap(size, alignment); }, extra
+    );
+  }
+
 #pragma endregion
 
 #pragma region ImmediateContext-related
@@ -4488,6 +4876,7 @@ public:
   uint32_t visibility_query_count = 0;
   std::vector<std::pair<Com<IMTLD3DOcclusionQuery>, uint32_t>> issued_visibility_query;
   std::vector<Com<MTLD3D11EventQuery>> issued_event_query;
+  PipelineStatisticsCounter pipeline_statistics;
 
 private:
   UINT context_flag;
@@ -447,16 +447,14 @@ public:
     case D3D11_QUERY_OCCLUSION_PREDICATE:
       return CreateOcculusionQuery(this, pQueryDesc, ppQuery);
     case D3D11_QUERY_TIMESTAMP:
-      *ppQuery = ref(new MTLD3D11EventQueryImpl<UINT64>(this, pQueryDesc));
+      *ppQuery = ref(new MTLD3D11TimestampQuery(this, pQueryDesc));
       return S_OK;
     case D3D11_QUERY_TIMESTAMP_DISJOINT: {
-      *ppQuery = ref(new MTLD3D11EventQueryImpl<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>(this, pQueryDesc));
+      *ppQuery = ref(new MTLD3D11TimestampDisjointQuery(this, pQueryDesc));
       return S_OK;
     }
     case D3D11_QUERY_PIPELINE_STATISTICS: {
-      *ppQuery =
-          ref(new MTLD3D11DummyQuery<D3D11_QUERY_DATA_PIPELINE_STATISTICS>(
-              this, pQueryDesc));
+      *ppQuery = ref(new MTLD3D11PipelineStatisticsQuery(this, pQueryDesc));
       return S_OK;
     }
     default:
@@ -46,6 +46,11 @@ public:
   virtual uint32_t input_slot_mask() = 0;
   virtual uint32_t
   input_layout_element(MTL_SHADER_INPUT_LAYOUT_ELEMENT_DESC **ppElements) = 0;
+  /**
+  Whether the layout can be expressed as a MTLVertexDescriptor. Strides and
+  offsets of the bound vertex buffers must be checked separately.
+  */
+  virtual bool stage_in_compatible() = 0;
 };
 
 HRESULT ExtractMTLInputLayoutElements(
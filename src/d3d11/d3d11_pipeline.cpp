@@ -22,27 +22,40 @@ public:
         topology_class(pDesc->TopologyClass), device_(pDevice),
         pBlendState(pDesc->BlendState),
         RasterizationEnabled(pDesc->RasterizationEnabled),
-        SampleCount(pDesc->SampleCount) {
+        SampleCount(pDesc->SampleCount),
+        InputLayout(pDesc->VertexStageIn ? pDesc->InputLayout : nullptr) {
     uint32_t unorm_output_reg_mask = 0;
     for (unsigned i = 0; i < num_rtvs; i++) {
       rtv_formats[i] = pDesc->ColorAttachmentFormats[i];
       unorm_output_reg_mask |= (uint32_t(IsUnorm8RenderTargetFormat(pDesc->ColorAttachmentFormats[i])) << i);
     }
 
+    // user outputs the vertex shader only ever writes literals to are folded
+    // into the pixel shader instead of being interpolated
+    uint32_t constant_reg_mask = 0;
+    if (pDesc->PixelShader && !pDesc->SOLayout) {
+      constant_reg_mask = pDesc->VertexShader->reflection().ConstantOutputRegisterMask &
+                          pDesc->PixelShader->reflection().ConstantInputRegisterMask;
+    }
+
     if (pDesc->SOLayout) {
       VertexShader =
           pDesc->VertexShader->get_shader(ShaderVariantVertexStreamOutput{
               (uint64_t)pDesc->InputLayout, (uint64_t)pDesc->SOLayout});
     } else {
       VertexShader = pDesc->VertexShader->get_shader(ShaderVariantVertex{
-          (uint64_t)pDesc->InputLayout, pDesc->GSPassthrough, !pDesc->RasterizationEnabled});
+          (uint64_t)pDesc->InputLayout, pDesc->GSPassthrough, !pDesc->RasterizationEnabled,
+          pDesc->PixelShader ? pDesc->PixelShader->reflection().InputRegisterMask & ~constant_reg_mask : 0,
+          pDesc->VertexStageIn, pDesc->VertexBuffersBound});
     }
 
     if (pDesc->PixelShader) {
       PixelShader = pDesc->PixelShader->get_shader(ShaderVariantPixel{
           pDesc->SampleMask, pDesc->BlendState->IsDualSourceBlending(),
           depth_stencil_format == MTL::PixelFormatInvalid,
-          unorm_output_reg_mask});
+          unorm_output_reg_mask,
+          constant_reg_mask ? (uint64_t)pDesc->VertexShader->handle() : 0,
+          pDesc->PSZeroBiasSamplerMask});
     }
   }
 
@@ -93,6 +106,29 @@ public:
     }
     pipelineDescriptor->setRasterizationEnabled(RasterizationEnabled);
 
+    if (InputLayout) {
+      MTL_SHADER_INPUT_LAYOUT_ELEMENT_DESC *elements;
+      uint32_t num_elements = InputLayout->input_layout_element(&elements);
+      auto vertexDescriptor = pipelineDescriptor->vertexDescriptor();
+      for (unsigned i = 0; i < num_elements; i++) {
+        auto &element = elements[i];
+        auto attribute = vertexDescriptor->attributes()->object(element.Index);
+        attribute->setFormat((MTL::VertexFormat)element.Format);
+        attribute->setOffset(element.Offset);
+        attribute->setBufferIndex(element.Slot + 1);
+        auto layout = vertexDescriptor->layouts()->object(element.Slot + 1);
+        // stride is provided when binding the buffer
+        layout->setStride(MTL::BufferLayoutStrideDynamic);
+        if (element.StepFunction) {
+          layout->setStepFunction(MTL::VertexStepFunctionPerInstance);
+          layout->setStepRate(element.InstanceStepRate);
+        } else {
+          layout->setStepFunction(MTL::VertexStepFunctionPerVertex);
+          layout->setStepRate(1);
+        }
+      }
+    }
+
     for (unsigned i = 0; i < num_rtvs; i++) {
       if (rtv_formats[i] == MTL::PixelFormatInvalid)
         continue;
@@ -150,6 +186,7 @@ private:
   Obj<MTL::RenderPipelineState> state_;
   bool RasterizationEnabled;
   UINT SampleCount;
+  ManagedInputLayout InputLayout;
 };
 
 Com<IMTLCompiledGraphicsPipeline>
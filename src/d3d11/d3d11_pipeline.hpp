@@ -29,6 +29,22 @@ struct MTL_GRAPHICS_PIPELINE_DESC {
   SM50_INDEX_BUFFER_FORAMT IndexBufferFormat;
   uint32_t SampleMask;
   uint32_t GSPassthrough;
+  /**
+  Vertex inputs are fetched with a MTLVertexDescriptor (buffer index of IA
+  slot N is N + 1) instead of being pulled from the vertex buffer table.
+  Ordinary pipelines only.
+  */
+  bool VertexStageIn;
+  /**
+  Every slot the input layout reads is bound to a buffer, so pulled vertices
+  skip the null binding check. Ordinary pipelines only.
+  */
+  bool VertexBuffersBound;
+  /**
+  Pixel shader samplers (s#) that are bound with no LOD bias, which is then
+  folded into the shader. Ordinary pipelines only.
+  */
+  uint16_t PSZeroBiasSamplerMask;
 };
 
 struct MTL_COMPUTE_PIPELINE_DESC {
@@ -108,6 +124,9 @@ template <> struct hash<MTL_GRAPHICS_PIPELINE_DESC> {
     state.add((size_t)v.GSStripTopology);
     state.add((size_t)v.SampleMask);
     state.add((size_t)v.GSPassthrough);
+    state.add((size_t)v.VertexStageIn);
+    state.add((size_t)v.VertexBuffersBound);
+    state.add((size_t)v.PSZeroBiasSamplerMask);
     state.add((size_t)v.SampleCount);
     state.add((size_t)v.NumColorAttachments);
     for (unsigned i = 0; i < v.NumColorAttachments; i++) {
@@ -177,7 +196,10 @@ template <> struct equal_to<MTL_GRAPHICS_PIPELINE_DESC> {
            (x.SampleCount == y.SampleCount) &&
            (x.IndexBufferFormat == y.IndexBufferFormat) &&
            (x.SampleMask == y.SampleMask) &&
-           (x.GSPassthrough == y.GSPassthrough);
+           (x.GSPassthrough == y.GSPassthrough) &&
+           (x.VertexStageIn == y.VertexStageIn) &&
+           (x.VertexBuffersBound == y.VertexBuffersBound) &&
+           (x.PSZeroBiasSamplerMask == y.PSZeroBiasSamplerMask);
   }
 };
 } // namespace std
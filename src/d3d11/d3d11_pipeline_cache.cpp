@@ -3,6 +3,7 @@
 #include "d3d11_device.hpp"
 #include "d3d11_shader.hpp"
 #include "d3d11_pipeline.hpp"
+#include "d3d11_vertex_stage_in.hpp"
 #include "log/log.hpp"
 #include <shared_mutex>
 
@@ -76,10 +77,14 @@ public:
   CachedInputLayout(
       std::vector<MTL_SHADER_INPUT_LAYOUT_ELEMENT_DESC> &&attributes,
       uint32_t input_slot_mask)
-      : attributes_(attributes), input_slot_mask_(input_slot_mask) {}
+      : attributes_(attributes), input_slot_mask_(input_slot_mask) {
+    stage_in_compatible_ = IsStageInCompatibleLayout(input_slot_mask_, attributes_.data(), attributes_.size());
+  }
 
   virtual uint32_t input_slot_mask() final { return input_slot_mask_; }
 
+  virtual bool stage_in_compatible() final { return stage_in_compatible_; }
+
   virtual uint32_t input_layout_element(
       MTL_SHADER_INPUT_LAYOUT_ELEMENT_DESC **ppElements) final {
     *ppElements = attributes_.data();
@@ -88,6 +93,7 @@ public:
 
   std::vector<MTL_SHADER_INPUT_LAYOUT_ELEMENT_DESC> attributes_;
   uint32_t input_slot_mask_;
+  bool stage_in_compatible_;
 };
 
 class MTLD3D11InputLayout final
@@ -38,7 +38,7 @@ public:
       PixelShader = pDesc->PixelShader->get_shader(ShaderVariantPixel{
           pDesc->SampleMask, pDesc->BlendState->IsDualSourceBlending(),
           depth_stencil_format == MTL::PixelFormatInvalid,
-          unorm_output_reg_mask});
+          unorm_output_reg_mask, 0, 0});
     }
   }
 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "d3d11.h"
+#include <cstdint>
+
+namespace dxmt {
+
+inline uint64_t
+GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY topology, uint64_t vertex_count) {
+  switch (topology) {
+  case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
+    return vertex_count;
+  case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
+    return vertex_count / 2;
+  case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
+    return vertex_count > 1 ? vertex_count - 1 : 0;
+  case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+    return vertex_count / 3;
+  case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+    return vertex_count > 2 ? vertex_count - 2 : 0;
+  case D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ:
+    return vertex_count / 4;
+  case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ:
+    return vertex_count > 3 ? vertex_count - 3 : 0;
+  case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ:
+    return vertex_count / 6;
+  case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ:
+    return vertex_count >= 6 ? (vertex_count - 4) / 2 : 0;
+  default:
+    if (topology >= D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST &&
+        topology <= D3D11_PRIMITIVE_TOPOLOGY_32_CONTROL_POINT_PATCHLIST)
+      return vertex_count / (topology - D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST + 1);
+    return 0;
+  }
+}
+
+/**
+Pipeline statistics accounted on CPU from draw/dispatch parameters. Counts
+that are only known after shader execution or rasterization are not available:
+- GSPrimitives, DSInvocations, PSInvocations are never counted
+- CInvocations/CPrimitives are only counted without GS/tessellation
+Indirect draws/dispatches are not counted either, their arguments are only
+known to GPU. They are tallied in `uncounted_indirect_calls` instead, so a
+query can tell its result is incomplete.
+*/
+struct PipelineStatisticsCounter {
+  D3D11_QUERY_DATA_PIPELINE_STATISTICS data{};
+  uint64_t uncounted_indirect_calls = 0;
+
+  void
+  draw(
+      D3D11_PRIMITIVE_TOPOLOGY topology, uint64_t vertex_count, uint64_t instance_count, bool geometry,
+      bool tessellation
+  ) {
+    uint64_t vertices = vertex_count * instance_count;
+    uint64_t primitives = GetPrimitiveCount(topology, vertex_count) * instance_count;
+    data.IAVertices += vertices;
+    data.IAPrimitives += primitives;
+    data.VSInvocations += vertices;
+    if (tessellation)
+      data.HSInvocations += primitives;
+    if (geometry)
+      data.GSInvocations += primitives;
+    if (!geometry && !tessellation) {
+      data.CInvocations += primitives;
+      data.CPrimitives += primitives;
+    }
+  }
+
+  void
+  dispatch(uint64_t threadgroup_count, uint64_t threads_per_threadgroup) {
+    data.CSInvocations += threadgroup_count * threads_per_threadgroup;
+  }
+
+  void
+  indirect() {
+    uncounted_indirect_calls++;
+  }
+
+  void
+  merge(const PipelineStatisticsCounter &other) {
+    data.IAVertices += other.data.IAVertices;
+    data.IAPrimitives += other.data.IAPrimitives;
+    data.VSInvocations += other.data.VSInvocations;
+    data.GSInvocations += other.data.GSInvocations;
+    data.GSPrimitives += other.data.GSPrimitives;
+    data.CInvocations += other.data.CInvocations;
+    data.CPrimitives += other.data.CPrimitives;
+    data.PSInvocations += other.data.PSInvocations;
+    data.HSInvocations += other.data.HSInvocations;
+    data.DSInvocations += other.data.DSInvocations;
+    data.CSInvocations += other.data.CSInvocations;
+    uncounted_indirect_calls += other.uncounted_indirect_calls;
+  }
+};
+
+} // namespace dxmt
@@ -35,12 +35,13 @@ public:
         ShaderVariantTessellationHull{(uint64_t)pDesc->VertexShader->handle()});
     DomainShader =
         pDesc->DomainShader->get_shader(ShaderVariantTessellationDomain{
-            (uint64_t)pDesc->HullShader->handle(), pDesc->GSPassthrough, !pDesc->RasterizationEnabled});
+            (uint64_t)pDesc->HullShader->handle(), pDesc->GSPassthrough, !pDesc->RasterizationEnabled,
+            pDesc->PixelShader ? pDesc->PixelShader->reflection().InputRegisterMask : 0});
     if (pDesc->PixelShader) {
       PixelShader = pDesc->PixelShader->get_shader(ShaderVariantPixel{
           pDesc->SampleMask, pDesc->BlendState->IsDualSourceBlending(),
           depth_stencil_format == MTL::PixelFormatInvalid,
-          unorm_output_reg_mask});
+          unorm_output_reg_mask, 0, 0});
     }
     hull_reflection = pDesc->HullShader->reflection();
   }
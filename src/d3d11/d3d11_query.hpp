@@ -1,7 +1,9 @@
 #pragma once
 #include "com/com_guid.hpp"
 #include "d3d11_device_child.hpp"
+#include "d3d11_pipeline_statistics.hpp"
 #include "dxmt_occlusion_query.hpp"
+#include "dxmt_timestamp_query.hpp"
 #include "log/log.hpp"
 
 DEFINE_COM_INTERFACE("a301e56d-d87e-4b69-8440-bd003e285904",
@@ -134,6 +136,94 @@ private:
   uint64_t should_be_signaled_at = 0;
 };
 
+class MTLD3D11TimestampQuery : public MTLD3D11EventQueryImpl<UINT64> {
+public:
+  using MTLD3D11EventQueryImpl<UINT64>::MTLD3D11EventQueryImpl;
+
+  /**
+  Each End() gets a new query object, a previous one can still be resolved by
+  GPU but no longer observed.
+  */
+  Rc<TimestampQuery>
+  Write() {
+    query_ = new TimestampQuery();
+    return query_;
+  }
+
+  bool
+  GetValue(uint64_t *value) {
+    if (!query_)
+      return false;
+    return query_->getValue(value);
+  }
+
+private:
+  Rc<TimestampQuery> query_;
+};
+
+class MTLD3D11TimestampDisjointQuery : public MTLD3D11EventQueryImpl<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT> {
+public:
+  using MTLD3D11EventQueryImpl<D3D11_QUERY_DATA_TIMESTAMP_DISJOINT>::MTLD3D11EventQueryImpl;
+
+  void
+  Begin(uint64_t current_seq_id) {
+    began_at = current_seq_id;
+  }
+
+  bool
+  IsDisjoint(uint64_t disjoint_seq_id) {
+    return disjoint_seq_id >= began_at;
+  }
+
+private:
+  uint64_t began_at = 0;
+};
+
+class MTLD3D11PipelineStatisticsQuery : public MTLD3D11EventQueryImpl<D3D11_QUERY_DATA_PIPELINE_STATISTICS> {
+public:
+  using MTLD3D11EventQueryImpl<D3D11_QUERY_DATA_PIPELINE_STATISTICS>::MTLD3D11EventQueryImpl;
+
+  void
+  Begin(const PipelineStatisticsCounter &counter) {
+    begin_ = counter.data;
+    begin_uncounted_indirect_calls_ = counter.uncounted_indirect_calls;
+  }
+
+  void
+  End(const PipelineStatisticsCounter &counter) {
+    auto &end = counter.data;
+    result_ = {
+        end.IAVertices - begin_.IAVertices,       end.IAPrimitives - begin_.IAPrimitives,
+        end.VSInvocations - begin_.VSInvocations, end.GSInvocations - begin_.GSInvocations,
+        end.GSPrimitives - begin_.GSPrimitives,   end.CInvocations - begin_.CInvocations,
+        end.CPrimitives - begin_.CPrimitives,     end.PSInvocations - begin_.PSInvocations,
+        end.HSInvocations - begin_.HSInvocations, end.DSInvocations - begin_.DSInvocations,
+        end.CSInvocations - begin_.CSInvocations,
+    };
+    uncounted_indirect_calls_ = counter.uncounted_indirect_calls - begin_uncounted_indirect_calls_;
+  }
+
+  /**
+  Indirect draws/dispatches issued between Begin() and End(), which are
+  missing from Result(). See PipelineStatisticsCounter.
+  */
+  uint64_t
+  UncountedIndirectCalls() {
+    return uncounted_indirect_calls_;
+  }
+
+  const D3D11_QUERY_DATA_PIPELINE_STATISTICS &
+  Result() {
+    return result_;
+  }
+
+private:
+  D3D11_QUERY_DATA_PIPELINE_STATISTICS begin_{};
+  D3D11_QUERY_DATA_PIPELINE_STATISTICS result_{};
+  uint64_t begin_uncounted_indirect_calls_ = 0;
+  uint64_t uncounted_indirect_calls_ = 0;
+};
+
 HRESULT CreateOcculusionQuery(MTLD3D11Device *pDevice,
                               const D3D11_QUERY_DESC *pDesc,
                               ID3D11Query **ppQuery);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+namespace dxmt {
+
+/**
+How the current render pass has used textures so far, to decide whether a
+blit touching a texture (i.e. mipmap generation) can be hoisted before the
+pass instead of ending it. Textures are only compared by address.
+*/
+template <typename Texture> class RenderPassUsage {
+public:
+  void
+  begin(bool uav_bound) {
+    uav_bound_ = uav_bound;
+    sampled_.clear();
+  }
+
+  /**
+  The pass may write through an OM UAV from now on, which holds until the pass
+  ends even if the UAV gets unbound
+  */
+  void
+  bindUAV() {
+    uav_bound_ = true;
+  }
+
+  void
+  sample(Texture *texture) {
+    if (texture && !sampled(texture))
+      sampled_.push_back(texture);
+  }
+
+  bool
+  sampled(Texture *texture) const {
+    return std::find(sampled_.begin(), sampled_.end(), texture) != sampled_.end();
+  }
+
+  /**
+  `attached` tells whether the texture is bound as a render target or depth
+  stencil of the pass. Earlier draws must not observe the result of the blit,
+  and a UAV may write any texture.
+  */
+  bool
+  canHoistBlit(Texture *texture, bool attached) const {
+    if (uav_bound_ || attached)
+      return false;
+    return !sampled(texture);
+  }
+
+private:
+  bool uav_bound_ = false;
+  std::vector<Texture *> sampled_;
+};
+
+} // namespace dxmt
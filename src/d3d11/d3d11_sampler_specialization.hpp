@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace dxmt {
+
+/**
+Tracks, per pixel shader, which of its samplers have had a zero LOD bias for
+the last kPromoteDraws draws. Once promoted, the pipeline is rebuilt with the
+bias of those samplers folded to zero in the pixel shader.
+
+Only the bias is folded: the sampler handle is still loaded from the argument
+table, so the indirection itself remains and a sampler state change doesn't
+need a new pipeline.
+*/
+class SamplerSpecialization {
+public:
+  static constexpr uint32_t kPromoteDraws = 64;
+
+  /**
+  Counts a draw with the pixel shader `shader_id` and returns the sampler mask
+  it's due to be specialized for, or 0 if none is yet.
+  */
+  uint16_t
+  draw(uint64_t shader_id, uint16_t zero_bias_mask) {
+    auto &entry = shaders_[shader_id];
+    if (entry.candidate != zero_bias_mask) {
+      entry.candidate = zero_bias_mask;
+      entry.draws = 0;
+    } else if (entry.draws < kPromoteDraws) {
+      entry.draws++;
+    }
+    return entry.draws >= kPromoteDraws ? entry.candidate : 0;
+  }
+
+  /**
+  Whether a pipeline specialized for `pipeline_mask` can still be used. Any
+  of its samplers now having a bias falls back to a generic pipeline.
+  */
+  static bool
+  compatible(uint16_t pipeline_mask, uint16_t zero_bias_mask, uint16_t due_mask) {
+    if (pipeline_mask & ~zero_bias_mask)
+      return false;
+    return !due_mask || due_mask == pipeline_mask;
+  }
+
+private:
+  struct Entry {
+    uint16_t candidate = 0;
+    uint32_t draws = 0;
+  };
+  std::unordered_map<uint64_t, Entry> shaders_;
+};
+
+} // namespace dxmt
@@ -1,6 +1,7 @@
 #include "d3d11_shader.hpp"
 #include "Metal/MTLLibrary.hpp"
 #include "airconv_public.h"
+#include "config/config.hpp"
 #include "d3d11_input_layout.hpp"
 
 namespace dxmt {
@@ -103,15 +104,21 @@ CreateVariantShader(MTLD3D11Device *pDevice, ManagedShader shader,
 
   auto proc = [=](const char *func_name) -> SM50CompiledBitcode * {
     SM50_SHADER_IA_INPUT_LAYOUT_DATA data_ia_layout;
+    SM50_SHADER_LINKED_OUTPUT_MASK_DATA data_linked_output;
+    data_linked_output.type = SM50_SHADER_LINKED_OUTPUT_MASK;
+    data_linked_output.output_reg_mask = variant.linked_output_reg_mask;
+    data_linked_output.next = nullptr;
     SM50_SHADER_GS_PASS_THROUGH_DATA data_gs_passthrough;
     data_gs_passthrough.type = SM50_SHADER_GS_PASS_THROUGH;
     data_gs_passthrough.DataEncoded = variant.gs_passthrough;
     data_gs_passthrough.RasterizationDisabled = variant.rasterization_disabled;
-    data_gs_passthrough.next = nullptr;
+    data_gs_passthrough.next = &data_linked_output;
     if (variant.input_layout_handle) {
-      data_gs_passthrough.next = &data_ia_layout;
+      data_linked_output.next = &data_ia_layout;
       data_ia_layout.type = SM50_SHADER_IA_INPUT_LAYOUT;
       data_ia_layout.next = nullptr;
+      data_ia_layout.stage_in = variant.vertex_stage_in;
+      data_ia_layout.slots_bound = variant.vertex_buffers_bound;
       data_ia_layout.slot_mask =
           ((ManagedInputLayout)variant.input_layout_handle)->input_slot_mask();
       data_ia_layout.num_elements =
@@ -152,6 +159,16 @@ CreateVariantShader(MTLD3D11Device *pDevice, ManagedShader shader,
     data.dual_source_blending = variant.dual_source_blending;
     data.disable_depth_output = variant.disable_depth_output;
     data.unorm_output_reg_mask = variant.unorm_output_reg_mask;
+    data.min_precision_half =
+        Config::getInstance().getOption<bool>("d3d11.shaderMinPrecisionHalf", false);
+    data.zero_bias_sampler_mask = variant.zero_bias_sampler_mask;
+    SM50_SHADER_LINKED_CONSTANT_INPUT_DATA data_linked_constant;
+    if (variant.linked_vertex_shader_handle) {
+      data.next = &data_linked_constant;
+      data_linked_constant.type = SM50_SHADER_LINKED_CONSTANT_INPUT;
+      data_linked_constant.next = nullptr;
+      data_linked_constant.producer = (SM50Shader *)variant.linked_vertex_shader_handle;
+    }
 
     SM50CompiledBitcode *compile_result = nullptr;
     SM50Error *sm50_err = nullptr;
@@ -210,6 +227,8 @@ CreateVariantShader(MTLD3D11Device *pDevice, ManagedShader shader,
                 (MTL_SHADER_INPUT_LAYOUT_ELEMENT_DESC **)&ia_layout.elements);
     ia_layout.type = SM50_SHADER_IA_INPUT_LAYOUT;
     ia_layout.next = nullptr;
+    ia_layout.stage_in = false;
+    ia_layout.slots_bound = false;
 
     SM50CompiledBitcode *compile_result = nullptr;
     SM50Error *sm50_err = nullptr;
@@ -260,10 +279,15 @@ std::unique_ptr<CompiledShader>
 CreateVariantShader(MTLD3D11Device *pDevice, ManagedShader shader,
                     ShaderVariantTessellationDomain variant) {
   auto proc = [=](const char *func_name) -> SM50CompiledBitcode * {
+    SM50_SHADER_LINKED_OUTPUT_MASK_DATA linked_output;
+    linked_output.type = SM50_SHADER_LINKED_OUTPUT_MASK;
+    linked_output.output_reg_mask = variant.linked_output_reg_mask;
+    linked_output.next = nullptr;
     SM50_SHADER_GS_PASS_THROUGH_DATA gs_passthrough;
+    gs_passthrough.type = SM50_SHADER_GS_PASS_THROUGH;
     gs_passthrough.DataEncoded = variant.gs_passthrough;
     gs_passthrough.RasterizationDisabled = variant.rasterization_disabled;
-    gs_passthrough.next = nullptr;
+    gs_passthrough.next = &linked_output;
 
     SM50CompiledBitcode *compile_result = nullptr;
     SM50Error *sm50_err = nullptr;
@@ -306,6 +330,8 @@ CreateVariantShader(MTLD3D11Device *pDevice, ManagedShader shader,
       data_so.next = &data_vertex_pulling;
       data_vertex_pulling.type = SM50_SHADER_IA_INPUT_LAYOUT;
       data_vertex_pulling.next = nullptr;
+      data_vertex_pulling.stage_in = false;
+      data_vertex_pulling.slots_bound = false;
       data_vertex_pulling.slot_mask =
           ((ManagedInputLayout)variant.input_layout_handle)->input_slot_mask();
       data_vertex_pulling.num_elements =
@@ -354,6 +380,8 @@ CreateVariantShader(MTLD3D11Device *pDevice, ManagedShader shader,
 
     ia_layout.type = SM50_SHADER_IA_INPUT_LAYOUT;
     ia_layout.next = nullptr;
+    ia_layout.stage_in = false;
+    ia_layout.slots_bound = false;
 
     SM50_SHADER_PSO_GEOMETRY_SHADER_DATA geometry;
     geometry.type = SM50_SHADER_PSO_GEOMETRY_SHADER;
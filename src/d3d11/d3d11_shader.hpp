@@ -78,10 +78,16 @@ struct ShaderVariantVertex {
   uint64_t input_layout_handle;
   uint32_t gs_passthrough;
   bool rasterization_disabled;
+  uint32_t linked_output_reg_mask;
+  bool vertex_stage_in;
+  bool vertex_buffers_bound;
   bool operator==(const this_type &rhs) const {
     return input_layout_handle == rhs.input_layout_handle &&
            gs_passthrough == rhs.gs_passthrough &&
-           rasterization_disabled == rhs.rasterization_disabled;
+           rasterization_disabled == rhs.rasterization_disabled &&
+           linked_output_reg_mask == rhs.linked_output_reg_mask &&
+           vertex_stage_in == rhs.vertex_stage_in &&
+           vertex_buffers_bound == rhs.vertex_buffers_bound;
   }
 };
 
@@ -91,11 +97,16 @@ struct ShaderVariantPixel {
   bool dual_source_blending;
   bool disable_depth_output;
   uint32_t unorm_output_reg_mask;
+  /* vertex shader whose constant outputs are folded into inputs, or 0 */
+  uint64_t linked_vertex_shader_handle;
+  uint32_t zero_bias_sampler_mask;
   bool operator==(const this_type &rhs) const {
     return sample_mask == rhs.sample_mask &&
            dual_source_blending == rhs.dual_source_blending &&
            disable_depth_output == rhs.disable_depth_output &&
-           unorm_output_reg_mask == rhs.unorm_output_reg_mask;
+           unorm_output_reg_mask == rhs.unorm_output_reg_mask &&
+           linked_vertex_shader_handle == rhs.linked_vertex_shader_handle &&
+           zero_bias_sampler_mask == rhs.zero_bias_sampler_mask;
   }
 };
 
@@ -124,10 +135,12 @@ struct ShaderVariantTessellationDomain {
   uint64_t hull_shader_handle;
   uint32_t gs_passthrough;
   bool rasterization_disabled;
+  uint32_t linked_output_reg_mask;
   bool operator==(const this_type &rhs) const {
     return hull_shader_handle == rhs.hull_shader_handle &&
            gs_passthrough == rhs.gs_passthrough &&
-           rasterization_disabled == rhs.rasterization_disabled;
+           rasterization_disabled == rhs.rasterization_disabled &&
+           linked_output_reg_mask == rhs.linked_output_reg_mask;
   }
 };
 
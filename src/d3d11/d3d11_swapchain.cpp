@@ -576,12 +576,22 @@ public:
       text[21] = 'M';
       text[22] = 'S';
     }
+    if (flags.test(FeatureCompatibility::UnsupportedIndirectPipelineStatistics)) {
+      text[24] = 'I';
+      text[25] = 'S';
+    }
     hud.printLine(text);
     hud.printLine(std::format(
         "Commit: {:2} -{:4.1f} -{:4.1f}", std::min(frame.command_buffer_count, 99u),
         std::min(average.commit_interval.count() / 1000000.0, 99.9),
         std::min(statistics.max().commit_interval.count() / 1000000.0, 99.9)
     ));
+    hud.printLine(std::format(
+        "Chunk: {:4} {:4}  Early: {:2} Query: {:2}",
+        std::min(average.chunk_command_count / std::max(average.command_buffer_count, 1u), 9999u),
+        std::min(statistics.max().max_chunk_command_count, 9999u), std::min(frame.adaptive_commit_count, 99u),
+        std::min(frame.query_pass_saved, 99u)
+    ));
     hud.printLine(std::format(
         "Sync:   {:2} {:4.1f}  {:2} {:4.1f} {:2}", std::min(frame.sync_count, 99u),
         std::min(average.sync_interval.count() / 1000000.0, 99.9), std::min(statistics.max().event_stall, 99u),
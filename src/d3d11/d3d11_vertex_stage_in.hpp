@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dxmt {
+
+/**
+Input layout slot N is bound at buffer index N + 1, below the vertex buffer
+table at 16, so only slots 0-14 can be fetched by a MTLVertexDescriptor.
+*/
+constexpr unsigned kStageInSlotCount = 15;
+
+/**
+Whether an input layout can be expressed as a MTLVertexDescriptor. Strides and
+offsets of the bound vertex buffers must be checked separately, see
+`AreStageInBuffersApplicable`.
+*/
+template <typename Element>
+bool
+IsStageInCompatibleLayout(uint32_t input_slot_mask, const Element *elements, size_t element_count) {
+  if (input_slot_mask >= (1u << kStageInSlotCount))
+    return false;
+  for (size_t i = 0; i < element_count; i++) {
+    auto &element = elements[i];
+    if (element.Index >= 31 || element.Offset & 3)
+      return false;
+    // MTLVertexStepFunctionConstant doesn't take base instance into account
+    if (element.StepFunction && element.InstanceStepRate == 0)
+      return false;
+  }
+  return true;
+}
+
+/**
+Every buffer read by the input layout must be bound, with a stride and offset
+aligned to 4 bytes. Otherwise vertices are pulled by the shader, which also
+takes care of out-of-bounds and unbound slots.
+*/
+template <typename VertexBufferSet>
+bool
+AreStageInBuffersApplicable(uint32_t input_slot_mask, VertexBufferSet &buffers) {
+  for (unsigned slot = 0; slot < kStageInSlotCount; slot++) {
+    if (!(input_slot_mask & (1u << slot)))
+      continue;
+    if (!buffers.test_bound(slot))
+      return false;
+    auto &entry = buffers[slot];
+    if (!entry.Stride || (entry.Stride & 3) || (entry.Offset & 3))
+      return false;
+  }
+  return true;
+}
+
+/**
+Whether a draw with a stage_in compatible input layout can fetch vertices with
+it. Stream output and geometry shader emulation pull vertices themselves.
+*/
+template <typename VertexBufferSet>
+bool
+IsStageInApplicable(
+    bool geometry_shader_bound, bool layout_compatible, uint32_t input_slot_mask, VertexBufferSet &buffers
+) {
+  if (geometry_shader_bound || !layout_compatible)
+    return false;
+  return AreStageInBuffersApplicable(input_slot_mask, buffers);
+}
+
+/**
+Whether every slot read by the input layout has a vertex buffer bound. Updated
+as bindings change, so a draw doesn't have to scan the slots.
+*/
+class VertexBufferBinding {
+public:
+  void
+  setInputLayout(bool present, uint32_t input_slot_mask) {
+    has_layout_ = present;
+    input_slot_mask_ = present ? input_slot_mask : 0;
+    update();
+  }
+
+  void
+  setBound(unsigned slot, bool bound) {
+    if (bound)
+      bound_mask_ |= 1u << slot;
+    else
+      bound_mask_ &= ~(1u << slot);
+    update();
+  }
+
+  bool
+  allBound() const {
+    return all_bound_;
+  }
+
+private:
+  void
+  update() {
+    all_bound_ = has_layout_ && (input_slot_mask_ & ~bound_mask_) == 0;
+  }
+
+  bool has_layout_ = false;
+  bool all_bound_ = false;
+  uint32_t input_slot_mask_ = 0;
+  uint32_t bound_mask_ = 0;
+};
+
+} // namespace dxmt
@@ -10,6 +10,8 @@
 #include "dxmt_texture.hpp"
 #include "mtld11_resource.hpp"
 #include "objc_pointer.hpp"
+#include "util_memory.hpp"
+#include <algorithm>
 
 namespace dxmt {
 
@@ -44,7 +46,8 @@ private:
 public:
   DynamicTexture2D(
       const tag_texture_2d::DESC1 *pDesc, Obj<MTL::TextureDescriptor> &&descriptor,
-      const D3D11_SUBRESOURCE_DATA *pInitialData, UINT bytes_per_image, UINT bytes_per_row, MTLD3D11Device *device
+      const D3D11_SUBRESOURCE_DATA *pInitialData, UINT bytes_per_image, UINT bytes_per_row, UINT bytes_per_texel,
+      MTLD3D11Device *device
   ) :
       TResourceBase<tag_texture_2d>(*pDesc, device),
       bytes_per_image_(bytes_per_image),
@@ -63,16 +66,12 @@ public:
     D3D11_ASSERT(_.ptr() == nullptr);
 
     if (pInitialData) {
-      if (pInitialData->SysMemPitch != bytes_per_row_) {
-        for (unsigned row = 0; row < texture_->height(); row++) {
-          memcpy(
-              ptr_add(allocation->mappedMemory, row * bytes_per_row_),
-              ptr_add(pInitialData->pSysMem, row * pInitialData->SysMemPitch),
-              pInitialData->SysMemPitch);
-        }
-      } else {
-        memcpy(allocation->mappedMemory, pInitialData->pSysMem, bytes_per_image);
-      }
+      // bytes_per_row_ is aligned, only the texels of each source row are read
+      size_t row_length = std::min<size_t>(pInitialData->SysMemPitch, bytes_per_texel * pDesc->Width);
+      copy_rows(
+          allocation->mappedMemory, bytes_per_row_, pInitialData->pSysMem, pInitialData->SysMemPitch, row_length,
+          bytes_per_image / bytes_per_row_
+      );
     }
     dynamic_ = new DynamicTexture(texture_.ptr(), flags);
   }
@@ -152,7 +151,9 @@ CreateDynamicTexture2D(
   }
 
   *ppTexture = reinterpret_cast<ID3D11Texture2D1 *>(
-      ref(new DynamicTexture2D(pDesc, std::move(textureDescriptor), pInitialData, bufferLen, bytesPerRow, pDevice))
+      ref(new DynamicTexture2D(
+          pDesc, std::move(textureDescriptor), pInitialData, bufferLen, bytesPerRow, format.BytesPerTexel, pDevice
+      ))
   );
   return S_OK;
 }
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "rc/util_rc_ptr.hpp"
+#include <atomic>
+#include <cstdint>
+
+namespace dxmt {
+
+/**
+Number of other resources sharing an allocation with whichever resource holds
+it. Acquired on the encoding thread, but a resource can release its share from
+any thread when it's destroyed.
+*/
+class AliasCount {
+public:
+  void
+  acquire() {
+    count_.fetch_add(1u, std::memory_order_relaxed);
+  }
+
+  /**
+  Called by a resource no longer holding the allocation. The last holder
+  releases nothing, so the count never underflows.
+  */
+  void
+  release() {
+    uint32_t count = count_.load(std::memory_order_relaxed);
+    while (count && !count_.compare_exchange_weak(count, count - 1, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint32_t
+  get() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  explicit
+  operator bool() const {
+    return get() != 0;
+  }
+
+private:
+  std::atomic<uint32_t> count_ = {0u};
+};
+
+/**
+The current allocation of a resource. It's replaced by `rename`, or by `alias`
+to share the current allocation of another resource. `Allocation` has an
+`AliasCount aliases` member.
+*/
+template <typename Allocation> class AllocationSlot {
+public:
+  AllocationSlot() = default;
+  AllocationSlot(const AllocationSlot &) = delete;
+
+  ~AllocationSlot() {
+    if (current_.ptr())
+      current_->aliases.release();
+  }
+
+  Allocation *
+  ptr() const {
+    return current_.ptr();
+  }
+
+  /**
+  Bumped on every rename, cheap to check whether the allocation has changed
+  */
+  uint64_t
+  generation() const {
+    return generation_;
+  }
+
+  Rc<Allocation>
+  rename(Rc<Allocation> &&allocation) {
+    Rc<Allocation> old = std::move(current_);
+    if (old.ptr())
+      old->aliases.release();
+    current_ = std::move(allocation);
+    generation_++;
+    return old;
+  }
+
+  /**
+  Returns the replaced allocation, or nothing if both already share it.
+  */
+  Rc<Allocation>
+  alias(AllocationSlot &source) {
+    if (source.current_.ptr() == current_.ptr())
+      return {};
+    source.current_->aliases.acquire();
+    return rename(Rc<Allocation>(source.current_));
+  }
+
+private:
+  Rc<Allocation> current_;
+  uint64_t generation_ = 0;
+};
+
+} // namespace dxmt
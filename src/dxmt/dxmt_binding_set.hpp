@@ -1,6 +1,8 @@
 #pragma once
 
 #include "util_bit.hpp"
+#include <array>
+#include <cassert>
 
 namespace dxmt {
 
@@ -15,11 +17,16 @@ template <typename Element, size_t NumElements> class BindingSet {
   bit::bitset<NumElements> dirty;
   bit::bitset<NumElements> bound;
   std::array<Element, NumElements> storage;
+  /**
+  RawPointer of bound elements (nullptr if unbound), kept contiguous so
+  incoming bindings can be compared in bulk
+  */
+  std::array<const void *, NumElements> raw{};
 
 public:
   BindingSet() {};
   BindingSet(const BindingSet &copy) = delete; // doesn't make sense here
-  BindingSet(BindingSet &&move) : storage(std::move(move.storage)) {
+  BindingSet(BindingSet &&move) : storage(std::move(move.storage)), raw(move.raw) {
     bound = move.bound;
     dirty = move.bound; // intended behavior
   };
@@ -27,6 +34,7 @@ public:
   BindingSet &
   operator=(BindingSet &&move) {
     storage = std::move(move.storage);
+    raw = move.raw;
     bound = move.bound;
     dirty = move.bound; // intended behavior
     return *this;
@@ -114,6 +122,17 @@ public:
     dirty.set(slot, true);
   };
 
+  /**
+  compare `count` (at most 64) pointers with RawPointer of bound elements
+  starting from `slot`, a null pointer matches an unbound slot.
+  returns a mask where bit i is set if binding pointers[i] at slot + i
+  is not redundant
+  */
+  inline uint64_t
+  changed_mask(size_t slot, size_t count, const void *const *pointers) const {
+    return bit::pcmpneq(raw.data() + slot, pointers, count);
+  }
+
   /**
   try to bind element at specific slot, and return a reference to the
   corresponding element storage it also tells if a replacement does happen
@@ -132,6 +151,7 @@ public:
     // new (storage.data() + slot) Element(std::forward<Element>(element));
     // std::construct_at(storage.data() + slot, std::forward<Element>(element));
     // idk why placement construction kills performance
+    raw[slot] = element.RawPointer;
     storage[slot] = std::forward<Element>(element);
     dirty.set(slot, true);
     replacement = true;
@@ -148,6 +168,7 @@ public:
       // destruction then a redunant Release occur when trying to move Element
       // at bind()
       storage[slot] = {};
+      raw[slot] = nullptr;
       bound.set(slot, false);
       dirty.set(slot, true);
       return true;
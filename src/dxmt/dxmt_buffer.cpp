@@ -121,9 +121,12 @@ Buffer::allocate(Flags<BufferAllocationFlag> flags) {
 
 Rc<BufferAllocation>
 Buffer::rename(Rc<BufferAllocation> &&newAllocation) {
-  Rc<BufferAllocation> old = std::move(current_);
-  current_ = std::move(newAllocation);
-  return old;
+  return current_.rename(std::move(newAllocation));
+}
+
+Rc<BufferAllocation>
+Buffer::alias(Buffer &source) {
+  return current_.alias(source.current_);
 }
 
 void Buffer::incRef(){
@@ -3,6 +3,7 @@
 #include "Metal/MTLDevice.hpp"
 #include "Metal/MTLPixelFormat.hpp"
 #include "Metal/MTLTexture.hpp"
+#include "dxmt_allocation_slot.hpp"
 #include "dxmt_deptrack.hpp"
 #include "dxmt_residency.hpp"
 #include "objc_pointer.hpp"
@@ -58,6 +59,10 @@ public:
   uint64_t gpuAddress;
   DXMT_RESOURCE_RESIDENCY_STATE residencyState;
   EncoderDepKey depkey;
+  /**
+  Number of other buffers sharing this allocation, see `Buffer::alias`.
+  */
+  AliasCount aliases;
 
 private:
   BufferAllocation(Obj<MTL::Buffer> &&buffer, Flags<BufferAllocationFlag> flags);
@@ -76,7 +81,7 @@ public:
 
   BufferViewKey createView(BufferViewDescriptor const &);
 
-  constexpr BufferAllocation *
+  BufferAllocation *
   current() {
     return current_.ptr();
   }
@@ -85,6 +90,22 @@ public:
 
   Rc<BufferAllocation> rename(Rc<BufferAllocation> &&newAllocation);
 
+  /**
+  Makes this buffer share the current allocation of `source`, as if its whole
+  content has been copied. The allocation must not be written while it's
+  shared: whichever buffer writes first has to move to a private copy.
+  Returns the replaced allocation.
+  */
+  Rc<BufferAllocation> alias(Buffer &source);
+
+  /**
+  Bumped on every rename, cheap to check whether current() has changed
+  */
+  uint64_t
+  generation() {
+    return current_.generation();
+  }
+
   Buffer(uint64_t length, MTL::Device *device) : length_(length), device_(device) {}
 
   MTL::Texture *view(BufferViewKey key);
@@ -103,7 +124,7 @@ private:
 
   uint64_t length_;
 
-  Rc<BufferAllocation> current_;
+  AllocationSlot<BufferAllocation> current_;
   uint32_t version_ = 0;
   std::atomic<uint32_t> refcount_ = {0u};
 
@@ -57,6 +57,16 @@ EmulatedCommandContext::EmulatedCommandContext(MTL::Device *device) {
     gs_draw_arguments_marshal = transfer(device->newRenderPipelineState(gs_marshal_pipeline, &error));
   }
 
+  auto predicated_draw_arguments_marshal_vs =
+      transfer(library->newFunction(NS::String::string("predicated_draw_arguments_marshal", NS::ASCIIStringEncoding)));
+  {
+    auto predicate_marshal_pipeline = MTL::RenderPipelineDescriptor::alloc()->init();
+    predicate_marshal_pipeline->setVertexFunction(predicated_draw_arguments_marshal_vs);
+    predicate_marshal_pipeline->setRasterizationEnabled(false);
+    predicated_draw_arguments_marshal =
+        transfer(device->newRenderPipelineState(predicate_marshal_pipeline, &error));
+  }
+
   dispatch_release(dispatch_data);
 }
 } // namespace dxmt
\ No newline at end of file
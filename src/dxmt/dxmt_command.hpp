@@ -151,6 +151,14 @@ public:
     encoder->setVertexBuffer(nullptr, 0, 0);
   }
 
+  void
+  MarshalPredicatedDrawArguments(MTL::RenderCommandEncoder *encoder, MTL::Buffer *commands, uint32_t commands_offset) {
+    encoder->setRenderPipelineState(predicated_draw_arguments_marshal);
+    encoder->setVertexBuffer(commands, commands_offset, 0);
+    encoder->drawPrimitives(MTL::PrimitiveTypePoint, NS::UInteger(0), NS::UInteger(1));
+    encoder->setVertexBuffer(nullptr, 0, 0);
+  }
+
 private:
   Obj<MTL::ComputePipelineState> clear_texture_1d_uint_pipeline;
   Obj<MTL::ComputePipelineState> clear_texture_1d_array_uint_pipeline;
@@ -169,6 +177,7 @@ private:
   Obj<MTL::RenderPipelineState> present_swapchain_blit;
   Obj<MTL::RenderPipelineState> present_swapchain_scale;
   Obj<MTL::RenderPipelineState> gs_draw_arguments_marshal;
+  Obj<MTL::RenderPipelineState> predicated_draw_arguments_marshal;
 };
 
 } // namespace dxmt
\ No newline at end of file
@@ -230,3 +230,32 @@ struct DXMTGSDispatchMarshal {
       break;
   };
 }
+
+struct DXMTPredicatedDrawMarshal {
+  device uint* draw_arguments; // (vertex|index_count, instance_count, ...)
+  device const ulong* visibility_result;
+  uint visibility_result_count;
+  uint predicate_value;
+  uint end_of_command;
+};
+
+[[vertex]] void predicated_draw_arguments_marshal(
+    constant DXMTPredicatedDrawMarshal* tasks [[buffer(0)]]
+) {
+  uint index = 0;
+  for(;;) {
+    constant DXMTPredicatedDrawMarshal& task = tasks[index];
+
+    ulong samples = 0;
+    for (uint i = 0; i < task.visibility_result_count; i++)
+      samples += task.visibility_result[i];
+    if ((samples != 0) == (task.predicate_value != 0)) {
+      task.draw_arguments[0] = 0;
+      task.draw_arguments[1] = 0;
+    }
+
+    if (task.end_of_command)
+      break;
+    index++;
+  };
+}
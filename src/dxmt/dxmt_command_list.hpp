@@ -1,5 +1,10 @@
 #pragma once
+#include <algorithm>
+#include <cassert>
 #include <concepts>
+#include <cstdint>
+#include <functional>
+#include <new>
 
 namespace dxmt {
 
@@ -8,6 +13,40 @@ concept CommandWithContext = requires(F f, context &ctx) {
   { f(ctx) } -> std::same_as<void>;
 };
 
+/**
+Compact, devirtualized encoding for the hottest commands.
+
+A record is a trivially-copyable struct deriving from `CommandRecord`. Records
+are packed back-to-back into a `CommandRecordBlock`, and a whole block is
+replayed by `CommandRecordInterpreter<Context>::execute` with a single switch
+per record, instead of one virtual call and one pointer chase per command.
+Lambdas remain as the escape hatch for everything else.
+ */
+struct alignas(8) CommandRecord {
+  uint32_t kind;
+  uint32_t size;
+
+  const CommandRecord *
+  next() const {
+    return reinterpret_cast<const CommandRecord *>(reinterpret_cast<const char *>(this) + size);
+  }
+
+  template <typename Record>
+  const Record &
+  as() const {
+    return *static_cast<const Record *>(this);
+  }
+};
+
+/**
+Must be specialized for every context that records are emitted into, providing
+  static void execute(Context &, const CommandRecord *begin, const CommandRecord *end);
+  static void destroy(CommandRecord *begin, CommandRecord *end);
+ */
+template <typename Context> struct CommandRecordInterpreter;
+
+constexpr uint32_t kCommandRecordBlockSize = 512;
+
 namespace impl {
 template <typename context> class CommandBase {
 public:
@@ -37,6 +76,43 @@ public:
   ~EmtpyCommand() noexcept = default;
 };
 
+template <typename context> class CommandRecordBlock final : public CommandBase<context> {
+public:
+  void
+  invoke(context &ctx) final {
+    CommandRecordInterpreter<context>::execute(ctx, begin(), end());
+  };
+  ~CommandRecordBlock() noexcept final {
+    CommandRecordInterpreter<context>::destroy(begin(), end());
+  };
+  CommandRecordBlock(uint32_t capacity) : CommandBase<context>(), capacity(capacity) {}
+  CommandRecordBlock(const CommandRecordBlock &copy) = delete;
+  CommandRecordBlock &operator=(const CommandRecordBlock &copy_assign) = delete;
+
+  void *
+  tryAllocate(uint32_t size) {
+    if (used + size > capacity)
+      return nullptr;
+    void *ret = end();
+    used += size;
+    return ret;
+  }
+
+  CommandRecord *
+  begin() {
+    return reinterpret_cast<CommandRecord *>(this + 1);
+  }
+
+  CommandRecord *
+  end() {
+    return reinterpret_cast<CommandRecord *>(reinterpret_cast<char *>(this + 1) + used);
+  }
+
+private:
+  uint32_t used = 0;
+  uint32_t capacity;
+};
+
 template <typename value_t> struct LinkedListNode {
   value_t value;
   LinkedListNode *next;
@@ -48,6 +124,7 @@ template <typename Context> class CommandList {
 
   impl::EmtpyCommand<Context> empty;
   impl::CommandBase<Context> *list_end;
+  impl::CommandRecordBlock<Context> *record_block = nullptr;
 
 public:
   CommandList() : list_end(&empty) {
@@ -67,6 +144,7 @@ public:
     }
     empty.next = nullptr;
     list_end = &empty;
+    record_block = nullptr;
   }
 
   CommandList(const CommandList &copy) = delete;
@@ -74,8 +152,10 @@ public:
     this->reset();
     empty.next = move.empty.next;
     list_end = move.list_end;
+    record_block = move.record_block;
     move.empty.next = nullptr;
     move.list_end = nullptr;
+    move.record_block = nullptr;
   }
 
   CommandList& operator=(CommandList&& move) {
@@ -83,8 +163,10 @@ public:
     this->reset();
     empty.next = move.empty.next;
     list_end = move.list_end;
+    record_block = move.record_block;
     move.empty.next = nullptr;
     move.list_end = nullptr;
+    move.record_block = nullptr;
     return *this;
   }
 
@@ -105,11 +187,40 @@ public:
     return sizeof(command_t);
   }
 
+  /**
+  Appends a record of `extra` trailing bytes to the record block at the end of
+  the list, or starts a new block (allocated through `allocate(size, alignment)`)
+  when the last command is not a block or it has no room left. The returned
+  record is value-initialized, only its payload has to be filled.
+   */
+  template <typename Record, typename Allocator>
+  Record *
+  emitRecord(Allocator &&allocate, uint32_t extra = 0) {
+    using block_t = impl::CommandRecordBlock<Context>;
+    uint32_t size = (sizeof(Record) + extra + 7) & ~7u;
+    void *storage = nullptr;
+    if (record_block && list_end == record_block)
+      storage = record_block->tryAllocate(size);
+    if (!storage) {
+      uint32_t capacity = std::max<uint32_t>(kCommandRecordBlockSize - sizeof(block_t), size);
+      record_block = new (allocate(sizeof(block_t) + capacity, 16)) block_t(capacity);
+      list_end->next = record_block;
+      list_end = record_block;
+      storage = record_block->tryAllocate(size);
+    }
+    auto record = new (storage) Record();
+    record->kind = uint32_t(Record::record_kind);
+    record->size = size;
+    return record;
+  }
+
   void append(CommandList &&list) {
     list_end->next = list.empty.next;
     list_end = list.list_end;
+    record_block = nullptr;
     list.empty.next = nullptr;
     list.list_end = nullptr;
+    list.record_block = nullptr;
   }
 
   void
@@ -4,6 +4,7 @@
 #include "Foundation/NSAutoreleasePool.hpp"
 #include "dxmt_statistics.hpp"
 #include "util_env.hpp"
+#include <algorithm>
 #include <atomic>
 
 #define ASYNC_ENCODING 1
@@ -33,6 +34,27 @@ CommandQueue::CommandQueue(MTL::Device *device) :
   };
   event = transfer(device->newSharedEvent());
 
+#if ASYNC_ENCODING
+  std::string worker_count = env::getEnvVar("DXMT_ENCODING_THREADS");
+  encoding_worker_count_ = std::clamp(dxmt::thread::hardware_concurrency() / 4, 1u, kMaxEncodingWorkerCount);
+  if (!worker_count.empty()) {
+    try {
+      encoding_worker_count_ = std::min((uint32_t)std::stoul(worker_count), kMaxEncodingWorkerCount);
+    } catch (const std::invalid_argument &) {
+    }
+  }
+#endif
+  // one heap per worker, and one for the chunk being prepared meanwhile
+  encoder_heaps.init(encoding_worker_count_ + 1, kCommandChunkCPUHeapSize);
+  flush_workers.start(
+      encoding_worker_count_, [this](uint64_t seq) { this->FlushChunk(seq); },
+      [](uint32_t) {
+        env::setThreadName("dxmt-encode-worker");
+        __pthread_set_qos_class_self_np(__QOS_CLASS_USER_INTERACTIVE, 0);
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+      }
+  );
+
   std::string env = env::getEnvVar("DXMT_CAPTURE_FRAME");
 
   if (!env.empty()) {
@@ -50,6 +72,8 @@ CommandQueue::~CommandQueue() {
   ready_for_encode.notify_one();
   ready_for_commit++;
   ready_for_commit.notify_one();
+  encoder_heaps.stop();
+  flush_workers.stop();
   encodeThread.join();
   finishThread.join();
   for (unsigned i = 0; i < kCommandChunkCount; i++) {
@@ -124,8 +148,15 @@ CommandQueue::CommitChunkInternal(CommandChunk &chunk, uint64_t seq) {
 
   chunk.attached_cmdbuf = commandQueue->commandBuffer();
   auto cmdbuf = chunk.attached_cmdbuf;
+  // reserve the position in queue, so command buffers flushed by workers still
+  // execute in submission order regardless of when they are committed
+  cmdbuf->enqueue();
+  chunk.cpu_encoder_heap = encoder_heaps.acquire();
+  if (!chunk.cpu_encoder_heap)
+    return;
   chunk.encode(cmdbuf, this->argument_encoding_ctx);
-  cmdbuf->commit();
+  // drawables must be acquired in present order
+  flush_workers.submit(seq, chunk.batch.acquires_drawable);
 
   ready_for_commit.fetch_add(1, std::memory_order_release);
   ready_for_commit.notify_one();
@@ -152,6 +183,18 @@ CommandQueue::EncodingThread() {
   return 0;
 }
 
+void
+CommandQueue::FlushChunk(uint64_t seq) {
+  auto pool = transfer(NS::AutoreleasePool::alloc()->init());
+  auto &chunk = chunks[seq % kCommandChunkCount];
+  chunk.flush(this->argument_encoding_ctx);
+  // encoder data is destroyed once flushed, the heap is free for another chunk
+  encoder_heaps.release(chunk.cpu_encoder_heap);
+  chunk.cpu_encoder_heap = nullptr;
+  // the chunk can be recycled by finish thread once committed
+  chunk.attached_cmdbuf->commit();
+}
+
 uint32_t
 CommandQueue::WaitForFinishThread() {
   env::setThreadName("dxmt-finish-thread");
@@ -162,6 +205,8 @@ CommandQueue::WaitForFinishThread() {
     ready_for_commit.wait(internal_seq, std::memory_order_acquire);
     if (stopped.load())
       break;
+    if (!flush_workers.waitCommitted(internal_seq))
+      break;
     auto &chunk = chunks[internal_seq % kCommandChunkCount];
     if (chunk.attached_cmdbuf->status() <= MTL::CommandBufferStatusScheduled) {
       chunk.attached_cmdbuf->waitUntilCompleted();
@@ -177,6 +222,15 @@ CommandQueue::WaitForFinishThread() {
       }
     }
 
+    chunk.visibility_readback.resolve();
+
+    if (!chunk.timestamp_readback.resolve(*chunk.attached_cmdbuf.ptr()))
+      timestamp_disjoint_event_seq_id.store(chunk.chunk_event_id, std::memory_order_release);
+
+    auto &frame_statistics = statistics.at(chunk.frame_);
+    frame_statistics.encode_flush_interval += chunk.encode_flush_interval;
+    frame_statistics.drawable_blocking_interval += chunk.batch.drawable_blocking_interval;
+
     if (chunk.signal_frame_latency_fence_ != ~0ull)
       frame_latency_fence_.signal(chunk.signal_frame_latency_fence_);
 
@@ -9,9 +9,12 @@
 #include "dxmt_command.hpp"
 #include "dxmt_command_list.hpp"
 #include "dxmt_context.hpp"
+#include "dxmt_flush_workers.hpp"
+#include "dxmt_heap_pool.hpp"
 #include "dxmt_occlusion_query.hpp"
 #include "dxmt_ring_bump_allocator.hpp"
 #include "dxmt_statistics.hpp"
+#include "dxmt_timestamp_query.hpp"
 #include "log/log.hpp"
 #include "objc_pointer.hpp"
 #include "thread.hpp"
@@ -21,6 +24,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <span>
+#include <vector>
 
 namespace dxmt {
 
@@ -72,6 +76,7 @@ private:
 };
 
 constexpr uint32_t kCommandChunkCount = 32;
+constexpr uint32_t kMaxEncodingWorkerCount = 4;
 
 class CommandQueue;
 
@@ -96,34 +101,61 @@ public:
     list_enc.emit(std::forward<F>(func), allocate_cpu_heap(list_enc.calculateCommandSize<F>(), 16));
   }
 
+  template <typename Record>
+  Record *
+  emitrecord(uint32_t extra = 0) {
+    return list_enc.emitRecord<Record>(
+        [this](size_t size, size_t alignment) { return allocate_cpu_heap(size, alignment); }, extra
+    );
+  }
+
+  /**
+  Replays recorded commands and prepares the encoder batch. Chunks must be
+  encoded one after another in submission order.
+   */
   void
   encode(MTL::CommandBuffer *cmdbuf, ArgumentEncodingContext &enc) {
     enc.$$setEncodingContext(
       chunk_id,
-      frame_
+      frame_,
+      cpu_encoder_heap
     );
     auto& statistics = enc.currentFrameStatistics();
     auto t0 = clock::now();
     list_enc.execute(enc);
     attached_cmdbuf = cmdbuf;
+    enc.flushCommands(cmdbuf, chunk_id, chunk_event_id, batch, visibility_readback);
     auto t1 = clock::now();
-    visibility_readback = enc.flushCommands(cmdbuf, chunk_id, chunk_event_id);
-    auto t2 = clock::now();
     statistics.encode_prepare_interval += (t1 - t0);
-    statistics.encode_flush_interval += (t2 - t1);
   };
 
+  /**
+  Encodes the prepared batch into the attached command buffer. Different chunks
+  can be flushed concurrently.
+   */
+  void
+  flush(ArgumentEncodingContext &enc) {
+    auto t0 = clock::now();
+    enc.encodeCommands(attached_cmdbuf, batch);
+    auto t1 = clock::now();
+    encode_flush_interval = t1 - t0;
+  }
+
   uint64_t chunk_id;
   uint64_t chunk_event_id;
   uint64_t frame_;
   uint64_t signal_frame_latency_fence_;
-  std::unique_ptr<VisibilityResultReadback> visibility_readback;
+  VisibilityResultReadback visibility_readback;
+  TimestampReadback timestamp_readback;
 
 private:
   CommandQueue *queue;
   char *cpu_argument_heap;
+  char *cpu_encoder_heap = nullptr;
   uint64_t cpu_arugment_heap_offset;
   Obj<MTL::CommandBuffer> attached_cmdbuf;
+  EncoderBatch batch;
+  clock::duration encode_flush_interval{};
   
   CommandList<ArgumentEncodingContext> list_enc;
 
@@ -135,10 +167,13 @@ public:
   void
   reset() noexcept {
     signal_frame_latency_fence_ = ~0ull;
-    visibility_readback = {};
+    visibility_readback.reset();
+    timestamp_readback.reset();
     list_enc.reset();
     cpu_arugment_heap_offset = 0;
     attached_cmdbuf = nullptr;
+    batch = {};
+    encode_flush_interval = {};
   }
 };
 
@@ -151,9 +186,12 @@ private:
 
   uint32_t WaitForFinishThread();
 
+  void FlushChunk(uint64_t seq);
+
   std::atomic_uint64_t ready_for_encode = 1; // we start from 1, so 0 is always coherent
   std::atomic_uint64_t ready_for_commit = 1;
   std::atomic_uint64_t chunk_ongoing = 0;
+  std::atomic_uint64_t timestamp_disjoint_event_seq_id = 0;
   CpuFence cpu_coherent;
   CpuFence frame_latency_fence_;
   std::atomic_bool stopped;
@@ -165,6 +203,17 @@ private:
 
   dxmt::thread encodeThread;
   dxmt::thread finishThread;
+  /**
+  When there is no worker, chunks are flushed on the encode thread right after
+  preparation.
+   */
+  FlushWorkers<kCommandChunkCount> flush_workers;
+  /**
+  Encoder data only lives from preparation until flush, so chunks take a heap
+  from here instead of owning one each.
+   */
+  CpuHeapPool encoder_heaps;
+  uint32_t encoding_worker_count_ = 0;
   Obj<MTL::CommandQueue> commandQueue;
 
   friend class CommandChunk;
@@ -205,6 +254,15 @@ public:
     return ready_for_encode.load(std::memory_order_relaxed);
   };
 
+  /**
+  Number of committed chunks that are not yet completed by GPU.
+  0 means GPU is (or is about to be) idle.
+  */
+  uint64_t
+  InflightChunkCount() {
+    return chunk_ongoing.load(std::memory_order_relaxed);
+  };
+
   uint64_t
   GetNextEventSeqId() {
     return ++current_event_seq_id;
@@ -221,6 +279,15 @@ public:
     return event->signaledValue();
   };
 
+  /**
+  Event id of the last chunk whose GPU timings are unreliable. Timestamps
+  bracketed by an earlier event are disjoint.
+  */
+  uint64_t
+  DisjointEventSeqId() {
+    return timestamp_disjoint_event_seq_id.load(std::memory_order_acquire);
+  };
+
   /**
   This is not thread-safe!
   CurrentChunk & CommitCurrentChunk should be called on the same thread
@@ -7,6 +7,7 @@
 #include "dxmt_command_list.hpp"
 #include "dxmt_occlusion_query.hpp"
 #include <cstdint>
+#include <cstring>
 
 namespace dxmt {
 
@@ -19,12 +20,9 @@ ArgumentEncodingContext::ArgumentEncodingContext(CommandQueue &queue, MTL::Devic
                  MTL::ResourceHazardTrackingModeUntracked
   ));
   std::memset(dummy_cbuffer_->contents(), 0, 65536);
-  cpu_buffer_ = malloc(kCommandChunkCPUHeapSize);
 };
 
-ArgumentEncodingContext::~ArgumentEncodingContext() {
-  free(cpu_buffer_);
-};
+ArgumentEncodingContext::~ArgumentEncodingContext() {};
 
 template void ArgumentEncodingContext::encodeVertexBuffers<PipelineKind::Ordinary>(uint32_t slot_mask);
 template void ArgumentEncodingContext::encodeVertexBuffers<PipelineKind::Tessellation>(uint32_t slot_mask);
@@ -40,36 +38,67 @@ ArgumentEncodingContext::encodeVertexBuffers(uint32_t slot_mask) {
   };
   uint32_t max_slot = 32 - __builtin_clz(slot_mask);
   uint32_t num_slots = __builtin_popcount(slot_mask);
+  uint64_t encoder_id = currentEncoder()->id;
+
+  auto generation = [this](unsigned slot) -> uint64_t {
+    auto &buffer = vbuf_[slot].buffer;
+    return buffer.ptr() ? buffer->generation() : 0;
+  };
+
+  uint64_t offset;
+  if (vbuf_table_.reusable(kind, slot_mask, encoder_id, vbuf_dirty_mask_, generation)) {
+    // buffers in the cached table are already accessed and resident in current encoder
+    offset = vbuf_table_.heapOffset();
+  } else {
+    offset = allocate_gpu_heap(16 * num_slots, 16);
+    VERTEX_BUFFER_ENTRY *entries = (VERTEX_BUFFER_ENTRY *)(((char *)gpu_buffer_->contents()) + offset);
 
-  uint64_t offset = allocate_gpu_heap(16 * num_slots, 16);
-  VERTEX_BUFFER_ENTRY *entries = (VERTEX_BUFFER_ENTRY *)(((char *)gpu_buffer_->contents()) + offset);
+    for (unsigned slot = 0, index = 0; slot < max_slot; slot++) {
+      if (!(slot_mask & (1 << slot)))
+        continue;
+      auto &state = vbuf_[slot];
+      auto &buffer = state.buffer;
+      if (!buffer.ptr()) {
+        entries[index].buffer_handle = 0;
+        entries[index].stride = 0;
+        entries[index++].length = 0;
+        continue;
+      }
+      auto current = buffer->current();
+      auto length = buffer->length();
+      entries[index].buffer_handle = current->gpuAddress + state.offset;
+      entries[index].stride = state.stride;
+      entries[index++].length = length > state.offset ? length - state.offset : 0;
+      // FIXME: did we intended to use the whole buffer?
+      access(buffer, DXMT_ENCODER_RESOURCE_ACESS_READ);
+      makeResident<PipelineStage::Vertex, kind>(buffer.ptr());
+    };
+    vbuf_table_.store(kind, slot_mask, encoder_id, offset, generation);
+    vbuf_dirty_mask_ &= ~slot_mask;
+  }
 
-  for (unsigned slot = 0, index = 0; slot < max_slot; slot++) {
+  if constexpr (kind == PipelineKind::Tessellation)
+    encodePreTessBufferOffset(CommandRecordFunction::Object, offset, 16);
+  else if constexpr (kind == PipelineKind::Geometry)
+    encodeRenderBufferOffset(CommandRecordFunction::Object, offset, 16);
+  else
+    encodeRenderBufferOffset(CommandRecordFunction::Vertex, offset, 16);
+}
+
+void
+ArgumentEncodingContext::encodeVertexBuffersStageIn(uint32_t slot_mask) {
+  uint32_t max_slot = 32 - __builtin_clz(slot_mask);
+  for (unsigned slot = 0; slot < max_slot; slot++) {
     if (!(slot_mask & (1 << slot)))
       continue;
     auto &state = vbuf_[slot];
-    auto &buffer = state.buffer;
-    if (!buffer.ptr()) {
-      entries[index].buffer_handle = 0;
-      entries[index].stride = 0;
-      entries[index++].length = 0;
+    if (!state.buffer.ptr())
       continue;
-    }
-    auto current = buffer->current();
-    auto length = buffer->length();
-    entries[index].buffer_handle = current->gpuAddress + state.offset;
-    entries[index].stride = state.stride;
-    entries[index++].length = length > state.offset ? length - state.offset : 0;
-    // FIXME: did we intended to use the whole buffer?
-    access(buffer, DXMT_ENCODER_RESOURCE_ACESS_READ);
-    makeResident<PipelineStage::Vertex, kind>(buffer.ptr());
-  };
-  if constexpr (kind == PipelineKind::Tessellation)
-    encodePreTessCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setObjectBufferOffset(offset, 16); });
-  else if constexpr (kind == PipelineKind::Geometry)
-    encodeRenderCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setObjectBufferOffset(offset, 16); });
-  else
-    encodeRenderCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setVertexBufferOffset(offset, 16); });
+    encodeRenderCommand([buffer = Obj(access(state.buffer, DXMT_ENCODER_RESOURCE_ACESS_READ)), offset = state.offset,
+                         stride = state.stride, index = slot + 1](RenderCommandContext &ctx) {
+      ctx.encoder->setVertexBuffer(buffer, offset, stride, index);
+    });
+  }
 }
 
 template void
@@ -125,28 +154,24 @@ ArgumentEncodingContext::encodeConstantBuffers(const MTL_SHADER_REFLECTION *refl
 
   /* kConstantBufferTableBinding = 29 */
   if constexpr (stage == PipelineStage::Compute) {
-    encodeComputeCommand([offset](ComputeCommandContext &ctx) { ctx.encoder->setBufferOffset(offset, 29); });
+    encodeComputeBufferOffset(offset, 29);
   } else if constexpr (stage == PipelineStage::Hull) {
-    encodePreTessCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setMeshBufferOffset(offset, 29); });
+    encodePreTessBufferOffset(CommandRecordFunction::Mesh, offset, 29);
   } else if constexpr (stage == PipelineStage::Vertex) {
     if constexpr (kind == PipelineKind::Tessellation)
-      encodePreTessCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setObjectBufferOffset(offset, 29); });
+      encodePreTessBufferOffset(CommandRecordFunction::Object, offset, 29);
     else if constexpr (kind == PipelineKind::Geometry)
-      encodeRenderCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setObjectBufferOffset(offset, 29); });
+      encodeRenderBufferOffset(CommandRecordFunction::Object, offset, 29);
     else
-      encodeRenderCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setVertexBufferOffset(offset, 29); });
+      encodeRenderBufferOffset(CommandRecordFunction::Vertex, offset, 29);
+  } else if constexpr (stage == PipelineStage::Pixel) {
+    encodeRenderBufferOffset(CommandRecordFunction::Fragment, offset, 29);
+  } else if constexpr (stage == PipelineStage::Domain) {
+    encodeRenderBufferOffset(CommandRecordFunction::Vertex, offset, 29);
+  } else if constexpr (stage == PipelineStage::Geometry) {
+    encodeRenderBufferOffset(CommandRecordFunction::Mesh, offset, 29);
   } else {
-    encodeRenderCommand([offset](RenderCommandContext &ctx) {
-      if constexpr (stage == PipelineStage::Pixel) {
-        ctx.encoder->setFragmentBufferOffset(offset, 29);
-      } else if constexpr (stage == PipelineStage::Domain) {
-        ctx.encoder->setVertexBufferOffset(offset, 29);
-      } else if constexpr (stage == PipelineStage::Geometry) {
-        ctx.encoder->setMeshBufferOffset(offset, 29);
-      } else {
-        assert(0 && "Not implemented or unreachable");
-      }
-    });
+    assert(0 && "Not implemented or unreachable");
   }
 };
 
@@ -290,28 +315,24 @@ ArgumentEncodingContext::encodeShaderResources(const MTL_SHADER_REFLECTION *refl
   }
 
   if constexpr (stage == PipelineStage::Compute) {
-    encodeComputeCommand([offset](ComputeCommandContext &ctx) { ctx.encoder->setBufferOffset(offset, 30); });
+    encodeComputeBufferOffset(offset, 30);
   } else if constexpr (stage == PipelineStage::Hull) {
-    encodePreTessCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setMeshBufferOffset(offset, 30); });
+    encodePreTessBufferOffset(CommandRecordFunction::Mesh, offset, 30);
   } else if constexpr (stage == PipelineStage::Vertex) {
     if constexpr (kind == PipelineKind::Tessellation)
-      encodePreTessCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setObjectBufferOffset(offset, 30); });
+      encodePreTessBufferOffset(CommandRecordFunction::Object, offset, 30);
     else if constexpr (kind == PipelineKind::Geometry)
-      encodeRenderCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setObjectBufferOffset(offset, 30); });
+      encodeRenderBufferOffset(CommandRecordFunction::Object, offset, 30);
     else
-      encodeRenderCommand([offset](RenderCommandContext &ctx) { ctx.encoder->setVertexBufferOffset(offset, 30); });
+      encodeRenderBufferOffset(CommandRecordFunction::Vertex, offset, 30);
+  } else if constexpr (stage == PipelineStage::Pixel) {
+    encodeRenderBufferOffset(CommandRecordFunction::Fragment, offset, 30);
+  } else if constexpr (stage == PipelineStage::Domain) {
+    encodeRenderBufferOffset(CommandRecordFunction::Vertex, offset, 30);
+  } else if constexpr (stage == PipelineStage::Geometry) {
+    encodeRenderBufferOffset(CommandRecordFunction::Mesh, offset, 30);
   } else {
-    encodeRenderCommand([offset](RenderCommandContext &ctx) {
-      if constexpr (stage == PipelineStage::Pixel) {
-        ctx.encoder->setFragmentBufferOffset(offset, 30);
-      } else if constexpr (stage == PipelineStage::Domain) {
-        ctx.encoder->setVertexBufferOffset(offset, 30);
-      } else if constexpr (stage == PipelineStage::Geometry) {
-        ctx.encoder->setMeshBufferOffset(offset, 30);
-      } else {
-        assert(0 && "Not implemented or unreachable");
-      }
-    });
+    assert(0 && "Not implemented or unreachable");
   }
 }
 
@@ -329,6 +350,7 @@ ArgumentEncodingContext::clearColor(
   encoder_info->array_length = arrayLength;
 
   encoder_info->tex_write.add(texture->current()->depkey);
+  texture->current()->mipmappedView = ~0u;
 
   encoder_current = encoder_info;
 
@@ -351,6 +373,7 @@ ArgumentEncodingContext::clearDepthStencil(
   encoder_info->array_length = arrayLength;
 
   encoder_info->tex_write.add(texture->current()->depkey);
+  texture->current()->mipmappedView = ~0u;
 
   encoder_current = encoder_info;
 
@@ -375,6 +398,7 @@ ArgumentEncodingContext::resolveTexture(
 
   encoder_info->tex_read.add(src->current()->depkey);
   encoder_info->tex_write.add(dst->current()->depkey);
+  dst->current()->mipmappedView = ~0u;
 
   encoder_current = encoder_info;
   endPass();
@@ -408,6 +432,7 @@ ArgumentEncodingContext::upscale(Rc<Texture> &texture, Rc<Texture> &upscaled, Ob
 
   encoder_info->tex_read.add(texture->current()->depkey);
   encoder_info->tex_write.add(upscaled->current()->depkey);
+  upscaled->current()->mipmappedView = ~0u;
 
   encoder_current = encoder_info;
   endPass();
@@ -433,6 +458,7 @@ ArgumentEncodingContext::upscaleTemporal(
   encoder_info->tex_read.add(depth->current()->depkey);
   encoder_info->tex_read.add(motion_vector->current()->depkey);
   encoder_info->tex_write.add(output->current()->depkey);
+  output->current()->mipmappedView = ~0u;
   if(exposure) {
     encoder_info->exposure = exposure->current()->texture();
     encoder_info->tex_read.add(exposure->current()->depkey);
@@ -470,6 +496,7 @@ ArgumentEncodingContext::startRenderPass(
 
   currentFrameStatistics().render_pass_count++;
 
+  visibility_result_encoder_begin_ = vro_state_.getNextReadOffset();
   vro_state_.beginEncoder();
 
   return encoder_info;
@@ -514,6 +541,102 @@ ArgumentEncodingContext::endPass() {
   encoder_count_++;
 }
 
+void
+ArgumentEncodingContext::generateMipmaps(Rc<Texture> const &texture, unsigned viewId) {
+  assert(encoder_current);
+  auto allocation = texture->current();
+  if (allocation->mipmappedView == viewId)
+    return;
+  if (encoder_current->type == EncoderType::Blit) {
+    auto view = access(texture, viewId, DXMT_ENCODER_RESOURCE_ACESS_READ | DXMT_ENCODER_RESOURCE_ACESS_WRITE);
+    if (view->mipmapLevelCount() > 1)
+      encodeBlitCommand([view](BlitCommandContext &ctx) { ctx.encoder->generateMipmaps(view); });
+    allocation->mipmappedView = viewId;
+    return;
+  }
+  assert(encoder_current->type == EncoderType::Render);
+  auto view = texture->view(viewId);
+  if (view->mipmapLevelCount() > 1) {
+    // a blit encoder right before the current render encoder, reused until another encoder is inserted
+    if (mipmap_encoder_ != encoder_last) {
+      mipmap_encoder_ = allocate<BlitEncoderData>();
+      mipmap_encoder_->type = EncoderType::Blit;
+      mipmap_encoder_->id = nextEncoderId();
+      encoder_last->next = mipmap_encoder_;
+      encoder_last = mipmap_encoder_;
+      encoder_count_++;
+      currentFrameStatistics().blit_pass_count++;
+    }
+    auto fn = [view](BlitCommandContext &ctx) { ctx.encoder->generateMipmaps(view); };
+    mipmap_encoder_->cmds.emit(
+        std::move(fn), allocate_cpu_heap(mipmap_encoder_->cmds.calculateCommandSize<decltype(fn)>(), 16)
+    );
+    if (!allocation->flags().test(TextureAllocationFlag::GpuReadonly)) {
+      mipmap_encoder_->tex_read.add(allocation->depkey);
+      mipmap_encoder_->tex_write.add(allocation->depkey);
+    }
+  }
+  allocation->mipmappedView = viewId;
+}
+
+Rc<BufferAllocation>
+ArgumentEncodingContext::aliasBuffer(Rc<Buffer> const &dst, Rc<Buffer> const &src) {
+  // untracked allocations would stay untracked in the aliasing buffer
+  assert(!src->current()->flags().test(BufferAllocationFlag::GpuReadonly));
+  currentFrameStatistics().blit_pass_aliased++;
+  return dst->alias(*src);
+}
+
+void
+ArgumentEncodingContext::unaliasBuffer(Rc<Buffer> const &buffer) {
+  assert(encoder_current);
+  auto shared = buffer->current();
+  auto copy = buffer->allocate(shared->flags());
+
+  auto encoder_info = allocate<BlitEncoderData>();
+  encoder_info->type = EncoderType::Blit;
+  encoder_info->id = nextEncoderId();
+  auto fn = [src = Obj(shared->buffer()), dst = Obj(copy->buffer()),
+             length = buffer->length()](BlitCommandContext &ctx) {
+    ctx.encoder->copyFromBuffer(src, 0, dst, 0, length);
+  };
+  encoder_info->cmds.emit(std::move(fn), allocate_cpu_heap(encoder_info->cmds.calculateCommandSize<decltype(fn)>(), 16));
+  encoder_info->buf_read.add(shared->depkey);
+  encoder_info->buf_write.add(copy->depkey);
+
+  // runs before the current encoder: buffers are only aliased between passes,
+  // and an earlier write in this encoder would have unaliased already
+  encoder_last->next = encoder_info;
+  encoder_last = encoder_info;
+  encoder_count_++;
+
+  currentFrameStatistics().blit_pass_count++;
+
+  // still referenced by the other buffer(s)
+  auto _ = buffer->rename(std::move(copy));
+}
+
+void
+ArgumentEncodingContext::discardTexture(Rc<Texture> &&texture, unsigned viewId) {
+  if (!encoder_current && encoder_last->type == EncoderType::Render) {
+    auto allocation = texture->current();
+    auto render = reinterpret_cast<RenderEncoderData *>(encoder_last);
+    auto base = allocation->texture();
+    auto view = viewId == kDiscardAllViews ? nullptr : texture->view(viewId);
+    auto match = [=](MTL::Texture *attached) { return IsDiscardedAttachment(attached, base, view); };
+    for (unsigned i = 0; i < render->render_target_count; i++) {
+      auto attachment = render->descriptor->colorAttachments()->object(i);
+      if (match(attachment->texture()))
+        attachment->setStoreAction(MTL::StoreActionDontCare);
+    }
+    if ((render->dsv_planar_flags & 1) && match(render->descriptor->depthAttachment()->texture()))
+      render->descriptor->depthAttachment()->setStoreAction(MTL::StoreActionDontCare);
+    if ((render->dsv_planar_flags & 2) && match(render->descriptor->stencilAttachment()->texture()))
+      render->descriptor->stencilAttachment()->setStoreAction(MTL::StoreActionDontCare);
+  }
+  discarded_textures_.add(std::move(texture), viewId, encoder_last);
+}
+
 std::pair<MTL::Buffer *, size_t>
 ArgumentEncodingContext::allocateTempBuffer(size_t size, size_t alignment) {
   auto [_, buffer, offset] = queue_.AllocateTempBuffer(seq_id_, size, alignment);
@@ -532,6 +655,26 @@ ArgumentEncodingContext::endVisibilityResultQuery(Rc<VisibilityResultQuery> &&qu
   assert(active_visibility_query_count_);
   active_visibility_query_count_--;
 }
+
+PredicateResult
+ArgumentEncodingContext::checkPredicate(bool can_marshal) {
+  // results are only visible to GPU after the render encoder writing them ends
+  auto result = predicate_.evaluate(seq_id_, visibility_result_encoder_begin_, can_marshal);
+  if (result != PredicateResult::Unsupported)
+    return result;
+  setCompatibilityFlag(FeatureCompatibility::UnsupportedPredication);
+  return PredicateResult::Draw;
+}
+
+uint64_t
+ArgumentEncodingContext::allocatePredicatedDrawArguments(size_t size) {
+  auto offset = allocate_gpu_heap(size, 4);
+  currentRenderEncoder()->predicate_marshal_tasks.push_back(
+      {offset, (uint32_t)predicate_.resultBegin(), (uint32_t)predicate_.resultEnd(), predicate_.value()}
+  );
+  has_predicated_draw_ = true;
+  return offset;
+}
 void
 ArgumentEncodingContext::bumpVisibilityResultOffset() {
   auto render_encoder = currentRenderEncoder();
@@ -548,13 +691,220 @@ ArgumentEncodingContext::bumpVisibilityResultOffset() {
   }
 }
 
+void
+CommandRecordInterpreter<RenderCommandContext>::execute(
+    RenderCommandContext &ctx, const CommandRecord *begin, const CommandRecord *end
+) {
+  auto encoder = ctx.encoder;
+  for (auto record = begin; record != end; record = record->next()) {
+    switch (CommandRecordKind(record->kind)) {
+    case CommandRecordKind::Draw: {
+      auto &draw = record->as<DrawRecord>();
+      if (draw.instance_count == 1 && draw.base_instance == 0)
+        encoder->drawPrimitives(draw.primitive, draw.vertex_start, draw.vertex_count);
+      else
+        encoder->drawPrimitives(
+            draw.primitive, draw.vertex_start, draw.vertex_count, draw.instance_count, draw.base_instance
+        );
+      break;
+    }
+    case CommandRecordKind::DrawIndexed: {
+      auto &draw = record->as<DrawIndexedRecord>();
+      assert(draw.index_buffer);
+      encoder->drawIndexedPrimitives(
+          draw.primitive, draw.index_count, draw.index_type, draw.index_buffer, draw.index_buffer_offset,
+          draw.instance_count, draw.base_vertex, draw.base_instance
+      );
+      break;
+    }
+    case CommandRecordKind::DrawIndirect: {
+      auto &draw = record->as<DrawIndirectRecord>();
+      encoder->drawPrimitives(draw.primitive, ctx.current_gpu_heap, draw.arguments_offset);
+      break;
+    }
+    case CommandRecordKind::DrawIndexedIndirect: {
+      auto &draw = record->as<DrawIndexedIndirectRecord>();
+      assert(draw.index_buffer);
+      encoder->drawIndexedPrimitives(
+          draw.primitive, draw.index_type, draw.index_buffer, draw.index_buffer_offset, ctx.current_gpu_heap,
+          draw.arguments_offset
+      );
+      break;
+    }
+    case CommandRecordKind::SetBufferOffset: {
+      auto &set = record->as<SetBufferOffsetRecord>();
+      switch (set.function) {
+      case CommandRecordFunction::Vertex:
+        encoder->setVertexBufferOffset(set.offset, set.index);
+        break;
+      case CommandRecordFunction::Fragment:
+        encoder->setFragmentBufferOffset(set.offset, set.index);
+        break;
+      case CommandRecordFunction::Object:
+        encoder->setObjectBufferOffset(set.offset, set.index);
+        break;
+      case CommandRecordFunction::Mesh:
+        encoder->setMeshBufferOffset(set.offset, set.index);
+        break;
+      default:
+        DXMT_UNREACHABLE
+      }
+      break;
+    }
+    case CommandRecordKind::SetViewports: {
+      auto &set = record->as<SetViewportsRecord>();
+      encoder->setViewports(set.viewports(), set.count);
+      break;
+    }
+    case CommandRecordKind::SetScissorRects: {
+      auto &set = record->as<SetScissorRectsRecord>();
+      encoder->setScissorRects(set.scissor_rects(), set.count);
+      break;
+    }
+    default:
+      DXMT_UNREACHABLE
+    }
+  }
+}
+
+void
+CommandRecordInterpreter<RenderCommandContext>::destroy(CommandRecord *begin, CommandRecord *end) {
+  for (const CommandRecord *record = begin; record != end; record = record->next()) {
+    if (CommandRecordKind(record->kind) == CommandRecordKind::DrawIndexed)
+      record->as<DrawIndexedRecord>().index_buffer->release();
+    if (CommandRecordKind(record->kind) == CommandRecordKind::DrawIndexedIndirect)
+      record->as<DrawIndexedIndirectRecord>().index_buffer->release();
+  }
+}
+
+void
+CommandRecordInterpreter<ComputeCommandContext>::execute(
+    ComputeCommandContext &ctx, const CommandRecord *begin, const CommandRecord *end
+) {
+  auto encoder = ctx.encoder;
+  for (auto record = begin; record != end; record = record->next()) {
+    switch (CommandRecordKind(record->kind)) {
+    case CommandRecordKind::Dispatch: {
+      auto &dispatch = record->as<DispatchRecord>();
+      encoder->dispatchThreadgroups(
+          MTL::Size::Make(dispatch.threadgroup_count_x, dispatch.threadgroup_count_y, dispatch.threadgroup_count_z),
+          ctx.threadgroup_size
+      );
+      break;
+    }
+    case CommandRecordKind::SetBufferOffset: {
+      auto &set = record->as<SetBufferOffsetRecord>();
+      assert(set.function == CommandRecordFunction::Compute);
+      encoder->setBufferOffset(set.offset, set.index);
+      break;
+    }
+    default:
+      DXMT_UNREACHABLE
+    }
+  }
+}
+
+void
+CommandRecordInterpreter<ArgumentEncodingContext>::execute(
+    ArgumentEncodingContext &enc, const CommandRecord *begin, const CommandRecord *end
+) {
+  for (auto record = begin; record != end; record = record->next()) {
+    switch (CommandRecordKind(record->kind)) {
+    case CommandRecordKind::Draw: {
+      auto predicate = enc.checkPredicate();
+      if (predicate == PredicateResult::Skip)
+        break;
+      enc.bumpVisibilityResultOffset();
+      auto &src = record->as<DrawRecord>();
+      if (predicate == PredicateResult::Marshal) {
+        auto offset = enc.allocatePredicatedDrawArguments(sizeof(MTL::DrawPrimitivesIndirectArguments));
+        *enc.get_gpu_heap_pointer<MTL::DrawPrimitivesIndirectArguments>(offset) = {
+            src.vertex_count, src.instance_count, src.vertex_start, src.base_instance
+        };
+        auto draw = enc.encodeRenderRecord<DrawIndirectRecord>();
+        draw->primitive = src.primitive;
+        draw->arguments_offset = offset;
+        break;
+      }
+      *enc.encodeRenderRecord<DrawRecord>() = src;
+      break;
+    }
+    case CommandRecordKind::DrawIndexed: {
+      auto predicate = enc.checkPredicate();
+      if (predicate == PredicateResult::Skip)
+        break;
+      auto index_buffer = enc.currentIndexBuffer();
+      // drawing with no index buffer bound is valid and draws nothing
+      if (!index_buffer)
+        break;
+      enc.bumpVisibilityResultOffset();
+      auto &src = record->as<DrawIndexedRecord>();
+      index_buffer->retain();
+      if (predicate == PredicateResult::Marshal) {
+        auto offset = enc.allocatePredicatedDrawArguments(sizeof(MTL::DrawIndexedPrimitivesIndirectArguments));
+        *enc.get_gpu_heap_pointer<MTL::DrawIndexedPrimitivesIndirectArguments>(offset) = {
+            src.index_count, src.instance_count, 0, src.base_vertex, src.base_instance
+        };
+        auto draw = enc.encodeRenderRecord<DrawIndexedIndirectRecord>();
+        draw->primitive = src.primitive;
+        draw->index_type = src.index_type;
+        draw->index_buffer_offset = src.index_buffer_offset;
+        draw->index_buffer = index_buffer;
+        draw->arguments_offset = offset;
+        break;
+      }
+      auto draw = enc.encodeRenderRecord<DrawIndexedRecord>();
+      *draw = src;
+      draw->index_buffer = index_buffer;
+      break;
+    }
+    case CommandRecordKind::Dispatch: {
+      *enc.encodeComputeRecord<DispatchRecord>() = record->as<DispatchRecord>();
+      break;
+    }
+    case CommandRecordKind::SetViewports: {
+      auto &src = record->as<SetViewportsRecord>();
+      auto set = enc.encodeRenderRecord<SetViewportsRecord>(sizeof(MTL::Viewport) * src.count);
+      set->count = src.count;
+      std::memcpy(set->viewports(), src.viewports(), sizeof(MTL::Viewport) * src.count);
+      break;
+    }
+    case CommandRecordKind::SetScissorRects: {
+      auto &src = record->as<SetScissorRectsRecord>();
+      auto set = enc.encodeRenderRecord<SetScissorRectsRecord>(sizeof(MTL::ScissorRect) * src.count);
+      set->count = src.count;
+      std::memcpy(set->scissor_rects(), src.scissor_rects(), sizeof(MTL::ScissorRect) * src.count);
+      break;
+    }
+    case CommandRecordKind::BindVertexBufferOffset: {
+      auto &bind = record->as<BindVertexBufferOffsetRecord>();
+      enc.bindVertexBufferOffset(bind.slot, bind.offset, bind.stride);
+      break;
+    }
+    case CommandRecordKind::BindConstantBufferOffset: {
+      auto &bind = record->as<BindConstantBufferOffsetRecord>();
+      enc.bindConstantBufferOffset(bind.stage, bind.slot, bind.offset);
+      break;
+    }
+    case CommandRecordKind::BindSampler: {
+      auto &bind = record->as<BindSamplerRecord>();
+      enc.bindSampler(bind.stage, bind.slot, bind.sampler, bind.bias);
+      break;
+    }
+    default:
+      DXMT_UNREACHABLE
+    }
+  }
+}
+
 FrameStatistics&
 ArgumentEncodingContext::currentFrameStatistics() {
   return queue_.statistics.at(frame_id_);
 }
 
 void
-ArgumentEncodingContext::$$setEncodingContext(uint64_t seq_id, uint64_t frame_id) {
+ArgumentEncodingContext::$$setEncodingContext(uint64_t seq_id, uint64_t frame_id, void *cpu_heap) {
+  cpu_buffer_ = cpu_heap;
   cpu_buffer_offset_ = 0;
   seq_id_ = seq_id;
   frame_id_ = frame_id;
@@ -565,8 +915,11 @@ ArgumentEncodingContext::$$setEncodingContext(uint64_t seq_id, uint64_t frame_id
 
 constexpr unsigned kEncoderOptimizerThreshold = 64;
 
-std::unique_ptr<VisibilityResultReadback>
-ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqId, uint64_t event_seq_id) {
+void
+ArgumentEncodingContext::flushCommands(
+    MTL::CommandBuffer *cmdbuf, uint64_t seqId, uint64_t event_seq_id, EncoderBatch &batch,
+    VisibilityResultReadback &visibility_readback
+) {
   assert(!encoder_current);
 
   unsigned encoder_count = encoder_count_;
@@ -575,9 +928,11 @@ ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqI
       reinterpret_cast<EncoderData **>(allocate_cpu_heap(sizeof(EncoderData *) * encoder_count, alignof(EncoderData *))
       );
 
+  bool acquires_drawable = false;
   {
     EncoderData *current = encoder_head.next;
     while (current) {
+      acquires_drawable |= current->type == EncoderType::Present;
       encoders[encoder_index++] = current;
       current = current->next;
     }
@@ -598,17 +953,91 @@ ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqI
     }
   }
 
-  std::unique_ptr<VisibilityResultReadback> visibility_readback {};
+  // predicated draws read visibility results written by previous encoders
+  auto visibility_result_heap = visibility_readback.prepare(
+      cmdbuf->device(), seqId, vro_state_.reset(), pending_queries_, has_predicated_draw_
+  );
+  std::erase_if(pending_queries_, [=](auto &query) -> bool { return query->queryEndAt() == seqId; });
 
-  if (auto count = vro_state_.reset()) {
-    visibility_readback = std::make_unique<VisibilityResultReadback>(
-        seqId, count, pending_queries_,
-        transfer(cmdbuf->device()->newBuffer(
-            count * sizeof(uint64_t), MTL::ResourceHazardTrackingModeUntracked | MTL::ResourceStorageModeShared
-        ))
-    );
+  for (unsigned i = 0; i < encoder_count; i++) {
+    if (encoders[i]->type != EncoderType::Render)
+      continue;
+    auto data = static_cast<RenderEncoderData *>(encoders[i]);
+    if (!data->gs_arg_marshal_tasks.size())
+      continue;
+    struct GS_MARSHAL_TASK {
+      uint64_t draw_args;
+      uint64_t dispatch_args_out;
+      uint32_t vertex_count_per_warp;
+      uint32_t end_of_command;
+    };
+    auto task_count = data->gs_arg_marshal_tasks.size();
+    auto offset = allocate_gpu_heap(sizeof(GS_MARSHAL_TASK) * task_count, 8);
+    auto tasks_data = get_gpu_heap_pointer<GS_MARSHAL_TASK>(offset);
+    for (unsigned j = 0; j < task_count; j++) {
+      auto &task = data->gs_arg_marshal_tasks[j];
+      tasks_data[j].draw_args = task.draw_arguments->gpuAddress() + task.draw_arguments_offset;
+      tasks_data[j].dispatch_args_out = gpu_buffer_->gpuAddress() + task.dispatch_arguments_offset;
+      tasks_data[j].vertex_count_per_warp = task.vertex_count_per_warp;
+      tasks_data[j].end_of_command = 0;
+    }
+    tasks_data[task_count - 1].end_of_command = 1;
+    data->gs_arg_marshal_tasks_offset = offset;
   }
-  std::erase_if(pending_queries_, [=](auto &query) -> bool { return query->queryEndAt() == seqId; });
+
+  for (unsigned i = 0; has_predicated_draw_ && i < encoder_count; i++) {
+    if (encoders[i]->type != EncoderType::Render)
+      continue;
+    auto data = static_cast<RenderEncoderData *>(encoders[i]);
+    if (!data->predicate_marshal_tasks.size())
+      continue;
+    struct PREDICATE_MARSHAL_TASK {
+      uint64_t draw_args;
+      uint64_t visibility_result;
+      uint32_t visibility_result_count;
+      uint32_t predicate_value;
+      uint32_t end_of_command;
+      uint32_t _;
+    };
+    assert(visibility_result_heap);
+    auto visibility_result = visibility_result_heap->gpuAddress();
+    auto task_count = data->predicate_marshal_tasks.size();
+    auto offset = allocate_gpu_heap(sizeof(PREDICATE_MARSHAL_TASK) * task_count, 8);
+    auto tasks_data = get_gpu_heap_pointer<PREDICATE_MARSHAL_TASK>(offset);
+    for (unsigned j = 0; j < task_count; j++) {
+      auto &task = data->predicate_marshal_tasks[j];
+      tasks_data[j].draw_args = gpu_buffer_->gpuAddress() + task.draw_arguments_offset;
+      tasks_data[j].visibility_result = visibility_result + task.visibility_result_begin * sizeof(uint64_t);
+      tasks_data[j].visibility_result_count = task.visibility_result_end - task.visibility_result_begin;
+      tasks_data[j].predicate_value = task.predicate_value;
+      tasks_data[j].end_of_command = 0;
+    }
+    tasks_data[task_count - 1].end_of_command = 1;
+    data->predicate_marshal_tasks_offset = offset;
+  }
+  has_predicated_draw_ = false;
+
+  batch.encoders = encoders;
+  batch.encoder_count = encoder_count;
+  batch.gpu_buffer = gpu_buffer_;
+  batch.visibility_result_heap = visibility_result_heap;
+  batch.event_seq_id = event_seq_id;
+  batch.acquires_drawable = acquires_drawable;
+  batch.drawable_blocking_interval = {};
+
+  encoder_head.next = nullptr;
+  encoder_last = &encoder_head;
+  encoder_count_ = 0;
+  mipmap_encoder_ = nullptr;
+  discarded_textures_.clear();
+}
+
+void
+ArgumentEncodingContext::encodeCommands(MTL::CommandBuffer *cmdbuf, EncoderBatch &batch) {
+  auto encoders = batch.encoders;
+  auto encoder_count = batch.encoder_count;
+  auto gpu_buffer = batch.gpu_buffer;
+  unsigned encoder_index = encoder_count;
 
   while (encoder_index) {
     auto current = encoders[encoder_count - encoder_index];
@@ -616,62 +1045,53 @@ ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqI
     case EncoderType::Render: {
       auto data = static_cast<RenderEncoderData *>(current);
       if (data->use_visibility_result) {
-        assert(visibility_readback);
-        data->descriptor->setVisibilityResultBuffer(visibility_readback->visibility_result_heap);
+        assert(batch.visibility_result_heap);
+        data->descriptor->setVisibilityResultBuffer(batch.visibility_result_heap);
       }
       auto encoder = cmdbuf->renderCommandEncoder(data->descriptor.ptr());
-      RenderCommandContext ctx{encoder, data->dsv_planar_flags, gpu_buffer_};
-      ctx.encoder->setVertexBuffer(gpu_buffer_, 0, 16);
-      ctx.encoder->setVertexBuffer(gpu_buffer_, 0, 29);
-      ctx.encoder->setVertexBuffer(gpu_buffer_, 0, 30);
-      ctx.encoder->setFragmentBuffer(gpu_buffer_, 0, 29);
-      ctx.encoder->setFragmentBuffer(gpu_buffer_, 0, 30);
+      RenderCommandContext ctx{encoder, data->dsv_planar_flags, gpu_buffer};
+      ctx.encoder->setVertexBuffer(gpu_buffer, 0, 16);
+      ctx.encoder->setVertexBuffer(gpu_buffer, 0, 29);
+      ctx.encoder->setVertexBuffer(gpu_buffer, 0, 30);
+      ctx.encoder->setFragmentBuffer(gpu_buffer, 0, 29);
+      ctx.encoder->setFragmentBuffer(gpu_buffer, 0, 30);
       if (data->use_tessellation) {
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 16);
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 21); // draw arguments
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 29);
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 30);
-        ctx.encoder->setMeshBuffer(gpu_buffer_, 0, 29);
-        ctx.encoder->setMeshBuffer(gpu_buffer_, 0, 30);
-        ctx.encoder->setVertexBuffer(gpu_buffer_, 0, 23); // draw arguments
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 16);
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 21); // draw arguments
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 29);
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 30);
+        ctx.encoder->setMeshBuffer(gpu_buffer, 0, 29);
+        ctx.encoder->setMeshBuffer(gpu_buffer, 0, 30);
+        ctx.encoder->setVertexBuffer(gpu_buffer, 0, 23); // draw arguments
         data->pretess_cmds.execute(ctx);
         encoder->memoryBarrier(MTL::BarrierScopeBuffers, MTL::RenderStageMesh, MTL::RenderStageVertex);
       }
       if (data->use_geometry && !data->use_tessellation) {
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 16);
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 21); // draw arguments
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 29);
-        ctx.encoder->setObjectBuffer(gpu_buffer_, 0, 30);
-        ctx.encoder->setMeshBuffer(gpu_buffer_, 0, 29);
-        ctx.encoder->setMeshBuffer(gpu_buffer_, 0, 30);
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 16);
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 21); // draw arguments
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 29);
+        ctx.encoder->setObjectBuffer(gpu_buffer, 0, 30);
+        ctx.encoder->setMeshBuffer(gpu_buffer, 0, 29);
+        ctx.encoder->setMeshBuffer(gpu_buffer, 0, 30);
       }
       if (data->gs_arg_marshal_tasks.size()) {
-        auto task_count = data->gs_arg_marshal_tasks.size();
-        struct GS_MARSHAL_TASK {
-          uint64_t draw_args;
-          uint64_t dispatch_args_out;
-          uint32_t vertex_count_per_warp;
-          uint32_t end_of_command;
-        };
-        auto offset = allocate_gpu_heap(sizeof(GS_MARSHAL_TASK) * task_count, 8);
-        auto tasks_data = (GS_MARSHAL_TASK *)((char*)gpu_buffer_->contents() + offset);
-        for (unsigned i = 0; i<task_count; i++) {
-          auto & task = data->gs_arg_marshal_tasks[i];
-          tasks_data[i].draw_args = task.draw_arguments->gpuAddress() + task.draw_arguments_offset;
-          tasks_data[i].dispatch_args_out = gpu_buffer_->gpuAddress() + task.dispatch_arguments_offset;
-          tasks_data[i].vertex_count_per_warp = task.vertex_count_per_warp;
-          tasks_data[i].end_of_command = 0;
+        for (auto &task : data->gs_arg_marshal_tasks) {
           encoder->useResource(task.draw_arguments, MTL::ResourceUsageRead, MTL::RenderStageVertex);
         }
-        tasks_data[task_count - 1].end_of_command = 1;
         // FIXME: 
-        encoder->useResource(gpu_buffer_, MTL::ResourceUsageWrite | MTL::ResourceUsageRead, MTL::RenderStageVertex);
-        queue_.emulated_cmd.MarshalGSDispatchArguments(ctx.encoder, gpu_buffer_, offset);
+        encoder->useResource(gpu_buffer, MTL::ResourceUsageWrite | MTL::ResourceUsageRead, MTL::RenderStageVertex);
+        queue_.emulated_cmd.MarshalGSDispatchArguments(ctx.encoder, gpu_buffer, data->gs_arg_marshal_tasks_offset);
         encoder->memoryBarrier(
             MTL::BarrierScopeBuffers, MTL::RenderStageVertex,
             MTL::RenderStageVertex | MTL::RenderStageMesh | MTL::RenderStageObject
         );
       }
+      if (data->predicate_marshal_tasks.size()) {
+        encoder->useResource(batch.visibility_result_heap, MTL::ResourceUsageRead, MTL::RenderStageVertex);
+        encoder->useResource(gpu_buffer, MTL::ResourceUsageWrite | MTL::ResourceUsageRead, MTL::RenderStageVertex);
+        queue_.emulated_cmd.MarshalPredicatedDrawArguments(ctx.encoder, gpu_buffer, data->predicate_marshal_tasks_offset);
+        encoder->memoryBarrier(MTL::BarrierScopeBuffers, MTL::RenderStageVertex, MTL::RenderStageVertex);
+      }
       data->cmds.execute(ctx);
       ctx.encoder->endEncoding();
       data->~RenderEncoderData();
@@ -680,8 +1100,8 @@ ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqI
     case EncoderType::Compute: {
       auto data = static_cast<ComputeEncoderData *>(current);
       ComputeCommandContext ctx{cmdbuf->computeCommandEncoder(), {}, queue_.emulated_cmd};
-      ctx.encoder->setBuffer(gpu_buffer_, 0, 29);
-      ctx.encoder->setBuffer(gpu_buffer_, 0, 30);
+      ctx.encoder->setBuffer(gpu_buffer, 0, 29);
+      ctx.encoder->setBuffer(gpu_buffer, 0, 30);
       data->cmds.execute(ctx);
       ctx.encoder->endEncoding();
       data->~ComputeEncoderData();
@@ -700,7 +1120,7 @@ ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqI
       auto t0 = clock::now();
       auto drawable = data->layer->nextDrawable();
       auto t1 = clock::now();
-      currentFrameStatistics().drawable_blocking_interval += (t1 - t0);
+      batch.drawable_blocking_interval += (t1 - t0);
       queue_.emulated_cmd.PresentToDrawable(cmdbuf, data->backbuffer, drawable->texture());
       if (data->after > 0)
         cmdbuf->presentDrawableAfterMinimumDuration(drawable, data->after);
@@ -815,13 +1235,8 @@ ArgumentEncodingContext::flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqI
     }
     encoder_index--;
   }
-  encoder_head.next = nullptr;
-  encoder_last = &encoder_head;
-  encoder_count_ = 0;
 
-  cmdbuf->encodeSignalEvent(queue_.event, event_seq_id);
-
-  return visibility_readback;
+  cmdbuf->encodeSignalEvent(queue_.event, batch.event_seq_id);
 }
 
 DXMT_ENCODER_LIST_OP
@@ -907,7 +1322,7 @@ ArgumentEncodingContext::checkEncoderRelation(EncoderData *former, EncoderData *
     auto r1 = reinterpret_cast<RenderEncoderData *>(latter);
     auto r0 = reinterpret_cast<RenderEncoderData *>(former);
 
-    if (isEncoderSignatureMatched(r0, r1)) {
+    if (isEncoderSignatureMatched(r0, r1) && !readsVisibilityResult(r1, r0)) {
       for (unsigned i = 0; i < r0->render_target_count; i++) {
         auto a0 = r0->descriptor->colorAttachments()->object(i);
         auto a1 = r1->descriptor->colorAttachments()->object(i);
@@ -932,6 +1347,12 @@ ArgumentEncodingContext::checkEncoderRelation(EncoderData *former, EncoderData *
         std::back_inserter(r0->gs_arg_marshal_tasks)
       );
       r1->gs_arg_marshal_tasks = std::move(r0->gs_arg_marshal_tasks);
+      std::move(
+        r1->predicate_marshal_tasks.begin(),
+        r1->predicate_marshal_tasks.end(),
+        std::back_inserter(r0->predicate_marshal_tasks)
+      );
+      r1->predicate_marshal_tasks = std::move(r0->predicate_marshal_tasks);
       r1->use_visibility_result = r0->use_visibility_result || r1->use_visibility_result;
 
       r1->buf_read.merge(r0->buf_read);
@@ -951,12 +1372,22 @@ ArgumentEncodingContext::checkEncoderRelation(EncoderData *former, EncoderData *
   return hasDataDependency(latter, former) ? DXMT_ENCODER_LIST_OP_SYNCHRONIZE : DXMT_ENCODER_LIST_OP_SWAP;
 }
 
+bool
+ArgumentEncodingContext::readsVisibilityResult(EncoderData *latter, EncoderData *former) {
+  if (latter->type != EncoderType::Render || former->type != EncoderType::Render)
+    return false;
+  return static_cast<RenderEncoderData *>(latter)->predicate_marshal_tasks.size() &&
+         static_cast<RenderEncoderData *>(former)->use_visibility_result;
+}
+
 bool
 ArgumentEncodingContext::hasDataDependency(EncoderData *latter, EncoderData *former) {
   if (latter->type == EncoderType::Clear && former->type == EncoderType::Clear) {
     // FIXME: prove it's safe to return false
     return false;
   }
+  if (readsVisibilityResult(latter, former))
+    return true;
   // read-after-write
   if (!former->buf_write.isDisjointWith(latter->buf_read))
     return true;
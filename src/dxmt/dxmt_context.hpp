@@ -15,10 +15,12 @@
 #include "dxmt_command.hpp"
 #include "dxmt_command_list.hpp"
 #include "dxmt_deptrack.hpp"
+#include "dxmt_discard.hpp"
 #include "dxmt_occlusion_query.hpp"
 #include "dxmt_residency.hpp"
 #include "dxmt_statistics.hpp"
 #include "dxmt_texture.hpp"
+#include "dxmt_vertex_buffer_table.hpp"
 #include "log/log.hpp"
 #include "rc/util_rc_ptr.hpp"
 #include "airconv_public.h"
@@ -107,12 +109,143 @@ struct EncoderData {
   EncoderDepSet tex_write;
 };
 
+enum class CommandRecordKind : uint32_t {
+  Draw,
+  DrawIndexed,
+  DrawIndirect,
+  DrawIndexedIndirect,
+  Dispatch,
+  SetBufferOffset,
+  SetViewports,
+  SetScissorRects,
+  BindVertexBufferOffset,
+  BindConstantBufferOffset,
+  BindSampler,
+};
+
+enum class CommandRecordFunction : uint32_t { Vertex, Fragment, Object, Mesh, Compute };
+
+struct DrawRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::Draw;
+  MTL::PrimitiveType primitive;
+  uint32_t vertex_start;
+  uint32_t vertex_count;
+  uint32_t instance_count;
+  uint32_t base_instance;
+};
+
+/**
+When emitted into a render encoder, `index_buffer` is retained by the record
+and released when the command list is reset.
+ */
+struct DrawIndexedRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::DrawIndexed;
+  MTL::PrimitiveType primitive;
+  MTL::IndexType index_type;
+  uint32_t index_count;
+  uint32_t instance_count;
+  int32_t base_vertex;
+  uint32_t base_instance;
+  uint64_t index_buffer_offset;
+  MTL::Buffer *index_buffer;
+};
+
+/**
+Draw arguments are read from the GPU heap, see `PredicatedDrawMarshal`.
+ */
+struct DrawIndirectRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::DrawIndirect;
+  MTL::PrimitiveType primitive;
+  uint64_t arguments_offset;
+};
+
+/**
+Same as `DrawIndexedRecord` regarding `index_buffer`.
+ */
+struct DrawIndexedIndirectRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::DrawIndexedIndirect;
+  MTL::PrimitiveType primitive;
+  MTL::IndexType index_type;
+  uint64_t index_buffer_offset;
+  MTL::Buffer *index_buffer;
+  uint64_t arguments_offset;
+};
+
+struct DispatchRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::Dispatch;
+  uint32_t threadgroup_count_x;
+  uint32_t threadgroup_count_y;
+  uint32_t threadgroup_count_z;
+};
+
+struct SetBufferOffsetRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::SetBufferOffset;
+  CommandRecordFunction function;
+  uint32_t index;
+  uint64_t offset;
+};
+
+struct SetViewportsRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::SetViewports;
+  uint32_t count;
+
+  MTL::Viewport *
+  viewports() {
+    return reinterpret_cast<MTL::Viewport *>(this + 1);
+  }
+  const MTL::Viewport *
+  viewports() const {
+    return reinterpret_cast<const MTL::Viewport *>(this + 1);
+  }
+};
+
+struct SetScissorRectsRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::SetScissorRects;
+  uint32_t count;
+
+  MTL::ScissorRect *
+  scissor_rects() {
+    return reinterpret_cast<MTL::ScissorRect *>(this + 1);
+  }
+  const MTL::ScissorRect *
+  scissor_rects() const {
+    return reinterpret_cast<const MTL::ScissorRect *>(this + 1);
+  }
+};
+
+struct BindVertexBufferOffsetRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::BindVertexBufferOffset;
+  uint32_t slot;
+  uint32_t offset;
+  uint32_t stride;
+};
+
+struct BindConstantBufferOffsetRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::BindConstantBufferOffset;
+  PipelineStage stage;
+  uint32_t slot;
+  uint32_t offset;
+};
+
+struct BindSamplerRecord : CommandRecord {
+  static constexpr CommandRecordKind record_kind = CommandRecordKind::BindSampler;
+  PipelineStage stage;
+  uint32_t slot;
+  float bias;
+  MTL::SamplerState *sampler;
+};
+
 struct RenderCommandContext {
   MTL::RenderCommandEncoder *encoder;
   uint32_t dsv_planar_flags;
   MTL::Buffer *current_gpu_heap;
 };
 
+template <> struct CommandRecordInterpreter<RenderCommandContext> {
+  static void execute(RenderCommandContext &ctx, const CommandRecord *begin, const CommandRecord *end);
+  static void destroy(CommandRecord *begin, CommandRecord *end);
+};
+
 struct GSDispatchArgumentsMarshal {
   Obj<MTL::Buffer> draw_arguments;
   uint32_t draw_arguments_offset;
@@ -120,11 +253,26 @@ struct GSDispatchArgumentsMarshal {
   uint32_t dispatch_arguments_offset;
 };
 
+/**
+Zeroes the draw arguments at `draw_arguments_offset` of GPU heap if the
+visibility results in [visibility_result_begin, visibility_result_end) match
+the predicate value.
+ */
+struct PredicatedDrawMarshal {
+  uint64_t draw_arguments_offset;
+  uint32_t visibility_result_begin;
+  uint32_t visibility_result_end;
+  bool predicate_value;
+};
+
 struct RenderEncoderData : EncoderData {
   Obj<MTL::RenderPassDescriptor> descriptor;
   CommandList<RenderCommandContext> cmds;
   CommandList<RenderCommandContext> pretess_cmds;
   std::vector<GSDispatchArgumentsMarshal> gs_arg_marshal_tasks;
+  uint64_t gs_arg_marshal_tasks_offset = 0;
+  std::vector<PredicatedDrawMarshal> predicate_marshal_tasks;
+  uint64_t predicate_marshal_tasks_offset = 0;
   uint32_t dsv_planar_flags;
   uint32_t render_target_count = 0;
   bool use_visibility_result = 0;
@@ -142,6 +290,12 @@ struct ComputeEncoderData : EncoderData {
   CommandList<ComputeCommandContext> cmds;
 };
 
+template <> struct CommandRecordInterpreter<ComputeCommandContext> {
+  static void execute(ComputeCommandContext &ctx, const CommandRecord *begin, const CommandRecord *end);
+  static void
+  destroy(CommandRecord *begin, CommandRecord *end) {}
+};
+
 struct BlitCommandContext {
   MTL::BlitCommandEncoder *encoder;
 };
@@ -209,6 +363,21 @@ struct TemporalUpscaleData : EncoderData {
   TemporalScalerProps props;
 };
 
+/**
+Encoders of one chunk, reordered and detached from the context that recorded
+them. Everything it points to lives in the chunk's own heaps, so a batch can be
+encoded into its command buffer on any thread while the next chunk is prepared.
+ */
+struct EncoderBatch {
+  EncoderData **encoders = nullptr;
+  unsigned encoder_count = 0;
+  MTL::Buffer *gpu_buffer = nullptr;
+  MTL::Buffer *visibility_result_heap = nullptr;
+  uint64_t event_seq_id = 0;
+  bool acquires_drawable = false;
+  clock::duration drawable_blocking_interval{};
+};
+
 template <PipelineKind kind>
 constexpr DXMT_RESOURCE_RESIDENCY
 GetResidencyMask(PipelineStage type, bool read, bool write) {
@@ -255,6 +424,12 @@ enum DXMT_ENCODER_RESOURCE_ACESS {
 };
 
 class ArgumentEncodingContext {
+  /**
+  Moves an aliased buffer to a private copy of the shared allocation before it
+  gets written. The copy is inserted before the current encoder.
+  */
+  void unaliasBuffer(Rc<Buffer> const &buffer);
+
   void
   trackBuffer(BufferAllocation *allocation, DXMT_ENCODER_RESOURCE_ACESS flags) {
     if (allocation->flags().test(BufferAllocationFlag::GpuReadonly))
@@ -271,13 +446,24 @@ class ArgumentEncodingContext {
       return;
     if (flags & DXMT_ENCODER_RESOURCE_ACESS_READ)
       encoder_current->tex_read.add(allocation->depkey);
-    if (flags & DXMT_ENCODER_RESOURCE_ACESS_WRITE)
+    if (flags & DXMT_ENCODER_RESOURCE_ACESS_WRITE) {
       encoder_current->tex_write.add(allocation->depkey);
+      allocation->mipmappedView = ~0u;
+    }
   }
 
 public:
+  /**
+  Makes `dst` share the current allocation of `src`, see `Buffer::alias`.
+  Returns the replaced allocation, which should be kept alive until previously
+  encoded commands have completed.
+  */
+  Rc<BufferAllocation> aliasBuffer(Rc<Buffer> const &dst, Rc<Buffer> const &src);
+
   MTL::Buffer *
   access(Rc<Buffer> const &buffer, unsigned offset, unsigned length, DXMT_ENCODER_RESOURCE_ACESS flags) {
+    if ((flags & DXMT_ENCODER_RESOURCE_ACESS_WRITE) && buffer->current()->aliases)
+      unaliasBuffer(buffer);
     auto allocation = buffer->current();
     trackBuffer(allocation, flags);
     return allocation->buffer();
@@ -285,6 +471,8 @@ public:
 
   MTL::Texture *
   access(Rc<Buffer> const &buffer, unsigned viewId, DXMT_ENCODER_RESOURCE_ACESS flags) {
+    if ((flags & DXMT_ENCODER_RESOURCE_ACESS_WRITE) && buffer->current()->aliases)
+      unaliasBuffer(buffer);
     auto allocation = buffer->current();
     trackBuffer(allocation, flags);
     return buffer->view(viewId);
@@ -292,6 +480,8 @@ public:
 
   MTL::Buffer *
   access(Rc<Buffer> const &buffer, DXMT_ENCODER_RESOURCE_ACESS flags) {
+    if ((flags & DXMT_ENCODER_RESOURCE_ACESS_WRITE) && buffer->current()->aliases)
+      unaliasBuffer(buffer);
     auto allocation = buffer->current();
     trackBuffer(allocation, flags);
     return allocation->buffer();
@@ -330,6 +520,11 @@ public:
   template <PipelineStage stage>
   void
   bindConstantBufferOffset(unsigned slot, unsigned offset) {
+    bindConstantBufferOffset(stage, slot, offset);
+  }
+
+  void
+  bindConstantBufferOffset(PipelineStage stage, unsigned slot, unsigned offset) {
     unsigned idx = slot + 14 * unsigned(stage);
     auto &entry = cbuf_[idx];
     entry.offset = offset;
@@ -338,6 +533,11 @@ public:
   template <PipelineStage stage>
   void
   bindSampler(unsigned slot, MTL::SamplerState *sampler, float bias) {
+    bindSampler(stage, slot, sampler, bias);
+  }
+
+  void
+  bindSampler(PipelineStage stage, unsigned slot, MTL::SamplerState *sampler, float bias) {
     unsigned idx = slot + 16 * unsigned(stage);
     auto &entry = sampler_[idx];
     entry.sampler = sampler;
@@ -376,6 +576,8 @@ public:
   void
   bindVertexBuffer(unsigned slot, unsigned offset, unsigned stride, Rc<Buffer> &&buffer) {
     auto &entry = vbuf_[slot];
+    if (entry.buffer.ptr() != buffer.ptr() || entry.offset != offset || entry.stride != stride)
+      vbuf_dirty_mask_ |= (1 << slot);
     entry.buffer = std::move(buffer);
     entry.offset = offset;
     entry.stride = stride;
@@ -384,6 +586,8 @@ public:
   void
   bindVertexBufferOffset(unsigned slot, unsigned offset, unsigned stride) {
     auto &entry = vbuf_[slot];
+    if (entry.offset != offset || entry.stride != stride)
+      vbuf_dirty_mask_ |= (1 << slot);
     entry.offset = offset;
     entry.stride = stride;
   }
@@ -395,21 +599,30 @@ public:
 
   MTL::Buffer *
   currentIndexBuffer() {
+    if (!ibuf_)
+      return nullptr;
     // because of indirect draw, we can't predicate the accessed buffer range
     return access(ibuf_, 0, ibuf_->length(), DXMT_ENCODER_RESOURCE_ACESS_READ);
   };
 
   void clearState() {
     vbuf_ = {{}};
+    vbuf_dirty_mask_ = ~0u;
     ibuf_ = {};
     cbuf_ = {{}};
     sampler_ = {{}};
     resview_ = {{}};
     om_uav_ = {{}};
     cs_uav_ = {{}};
+    predicate_.reset();
   }
 
   template <PipelineKind kind> void encodeVertexBuffers(uint32_t ia_slot_mask);
+  /**
+  Binds vertex buffers for a pipeline with a vertex descriptor: IA slot N goes
+  to buffer index N + 1, with the stride set dynamically.
+  */
+  void encodeVertexBuffersStageIn(uint32_t ia_slot_mask);
   template <PipelineStage stage, PipelineKind kind>
   void encodeConstantBuffers(const MTL_SHADER_REFLECTION *reflection);
   template <PipelineStage stage, PipelineKind kind>
@@ -502,6 +715,60 @@ public:
     cmds.emit(std::forward<cmd>(fn), allocate_cpu_heap(cmds.calculateCommandSize<cmd>(), 16));
   }
 
+  template <typename Record>
+  Record *
+  encodeRenderRecord(uint32_t extra = 0) {
+    assert(encoder_current->type == EncoderType::Render);
+    auto &cmds = static_cast<RenderEncoderData *>(encoder_current)->cmds;
+    return cmds.template emitRecord<Record>(
+        [this](size_t size, size_t alignment) { return allocate_cpu_heap(size, alignment); }, extra
+    );
+  }
+
+  template <typename Record>
+  Record *
+  encodePreTessRecord(uint32_t extra = 0) {
+    assert(encoder_current->type == EncoderType::Render);
+    auto &cmds = static_cast<RenderEncoderData *>(encoder_current)->pretess_cmds;
+    return cmds.template emitRecord<Record>(
+        [this](size_t size, size_t alignment) { return allocate_cpu_heap(size, alignment); }, extra
+    );
+  }
+
+  template <typename Record>
+  Record *
+  encodeComputeRecord(uint32_t extra = 0) {
+    assert(encoder_current->type == EncoderType::Compute);
+    auto &cmds = static_cast<ComputeEncoderData *>(encoder_current)->cmds;
+    return cmds.template emitRecord<Record>(
+        [this](size_t size, size_t alignment) { return allocate_cpu_heap(size, alignment); }, extra
+    );
+  }
+
+  void
+  encodeRenderBufferOffset(CommandRecordFunction function, uint64_t offset, uint32_t index) {
+    auto record = encodeRenderRecord<SetBufferOffsetRecord>();
+    record->function = function;
+    record->offset = offset;
+    record->index = index;
+  }
+
+  void
+  encodePreTessBufferOffset(CommandRecordFunction function, uint64_t offset, uint32_t index) {
+    auto record = encodePreTessRecord<SetBufferOffsetRecord>();
+    record->function = function;
+    record->offset = offset;
+    record->index = index;
+  }
+
+  void
+  encodeComputeBufferOffset(uint64_t offset, uint32_t index) {
+    auto record = encodeComputeRecord<SetBufferOffsetRecord>();
+    record->function = CommandRecordFunction::Compute;
+    record->offset = offset;
+    record->index = index;
+  }
+
   template <typename T>
   T *
   allocate() {
@@ -519,6 +786,32 @@ public:
 
   void signalEvent(uint64_t value);
 
+  /**
+  Generates mipmaps of a texture view, skipped if the same view has been
+  mipmapped without being written since. In a render pass the blit is hoisted
+  before the render encoder, and shared by all mipmaps generated during the
+  pass: the caller must make sure the render pass doesn't write the texture.
+  */
+  void generateMipmaps(Rc<Texture> const &texture, unsigned viewId);
+
+  static constexpr unsigned kDiscardAllViews = DiscardedTextureList<Texture, EncoderData>::kAllViews;
+
+  /**
+  Contents of the texture (or the subresources of a view) are no longer needed.
+  If the previous pass is the last writer and renders into it, its store action
+  is changed to DontCare. The discard is remembered until the next render pass
+  that attaches it, see `takeDiscardedAttachment`.
+  */
+  void discardTexture(Rc<Texture> &&texture, unsigned viewId);
+  /**
+  Returns true if the attachment has been discarded and not written since then,
+  so the render pass doesn't need to load it.
+  */
+  bool
+  takeDiscardedAttachment(Rc<Texture> const &texture, unsigned viewId) {
+    return discarded_textures_.take(texture, viewId);
+  }
+
   uint64_t
   nextEncoderId() {
     static std::atomic_uint64_t global_id = 0;
@@ -578,7 +871,22 @@ public:
 
   std::pair<MTL::Buffer* , size_t> allocateTempBuffer(size_t size, size_t alignment);
 
-  std::unique_ptr<VisibilityResultReadback> flushCommands(MTL::CommandBuffer *cmdbuf, uint64_t seqId, uint64_t event_seq_id);
+  /**
+  Finishes recording of the current chunk: reorders its encoders and moves
+  them into `batch`, and prepares `visibility_readback` of the chunk. Must be
+  called in submission order.
+   */
+  void flushCommands(
+      MTL::CommandBuffer *cmdbuf, uint64_t seqId, uint64_t event_seq_id, EncoderBatch &batch,
+      VisibilityResultReadback &visibility_readback
+  );
+
+  /**
+  Encodes a batch produced by `flushCommands` into its command buffer. Only
+  reads immutable state of the context, thus it's safe to encode different
+  batches concurrently.
+   */
+  void encodeCommands(MTL::CommandBuffer *cmdbuf, EncoderBatch &batch);
 
   uint64_t currentSeqId() {return seq_id_;}
 
@@ -587,9 +895,23 @@ public:
   CommandQueue& queue() { return queue_;}
 
   void
-  $$setEncodingContext(uint64_t seq_id, uint64_t frame_id);
+  $$setEncodingContext(uint64_t seq_id, uint64_t frame_id, void *cpu_heap);
 
   void bumpVisibilityResultOffset();
+
+  void
+  setPredicate(Rc<VisibilityResultQuery> &&query, bool value) {
+    predicate_.set(std::move(query), value);
+  }
+
+  /**
+  Never returns Unsupported, the draw is executed and flagged instead. On
+  Marshal, use `allocatePredicatedDrawArguments`. Draws that can't be marshaled
+  (indirect, tessellation and geometry draws) are still skipped once the
+  result is known.
+  */
+  PredicateResult checkPredicate(bool can_marshal = true);
+  uint64_t allocatePredicatedDrawArguments(size_t size);
   void beginVisibilityResultQuery(Rc<VisibilityResultQuery> &&query);
   void endVisibilityResultQuery(Rc<VisibilityResultQuery> &&query);
   void
@@ -625,6 +947,7 @@ public:
 private:
   DXMT_ENCODER_LIST_OP checkEncoderRelation(EncoderData* former, EncoderData* latter);
   bool hasDataDependency(EncoderData* from, EncoderData* to);
+  bool readsVisibilityResult(EncoderData *latter, EncoderData *former);
   bool isEncoderSignatureMatched(RenderEncoderData* former, RenderEncoderData* latter);
   MTL::RenderPassColorAttachmentDescriptor *isClearColorSignatureMatched(ClearEncoderData* former, RenderEncoderData* latter);
   MTL::RenderPassDepthAttachmentDescriptor *isClearDepthSignatureMatched(ClearEncoderData* former, RenderEncoderData* latter);
@@ -633,6 +956,9 @@ private:
   std::array<VertexBufferBinding, kVertexBufferSlots> vbuf_;
   Rc<Buffer> ibuf_;
 
+  VertexBufferTableCache<PipelineKind, kVertexBufferSlots> vbuf_table_;
+  uint32_t vbuf_dirty_mask_ = ~0u;
+
   std::array<ConstantBufferBinding, 14 * kStages> cbuf_;
   std::array<SamplerBinding, 16 * kStages> sampler_;
   std::array<ResourceViewBinding, kSRVBindings * kStages> resview_;
@@ -647,6 +973,7 @@ private:
   EncoderData *encoder_last = &encoder_head;
   EncoderData *encoder_current = nullptr;
   unsigned encoder_count_ = 0;
+  BlitEncoderData *mipmap_encoder_ = nullptr;
 
   void *cpu_buffer_;
   uint64_t cpu_buffer_offset_;
@@ -658,13 +985,24 @@ private:
   VisibilityResultOffsetBumpState vro_state_;
   std::vector<Rc<VisibilityResultQuery>> pending_queries_;
   unsigned active_visibility_query_count_ = 0;
+  uint64_t visibility_result_encoder_begin_ = 0;
+  VisibilityPredicate predicate_;
+  bool has_predicated_draw_ = false;
   Flags<FeatureCompatibility> compatibility_flag_;
 
   std::vector<Rc<VisibilityResultQuery> *> deferred_visibility_query_stack_;
 
+  DiscardedTextureList<Texture, EncoderData> discarded_textures_;
+
   CommandQueue& queue_;
 };
 
+template <> struct CommandRecordInterpreter<ArgumentEncodingContext> {
+  static void execute(ArgumentEncodingContext &enc, const CommandRecord *begin, const CommandRecord *end);
+  static void
+  destroy(CommandRecord *begin, CommandRecord *end) {}
+};
+
 template <>
 inline void
 ArgumentEncodingContext::bindOutputBuffer<PipelineStage::Compute>(
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "dxmt_deptrack.hpp"
+#include "rc/util_rc_ptr.hpp"
+#include <utility>
+#include <vector>
+
+namespace dxmt {
+
+/**
+Whether an attachment is covered by a discard of `view`, or of the whole
+texture `base` if there is no view.
+*/
+template <typename MetalTexture>
+bool
+IsDiscardedAttachment(MetalTexture *attached, MetalTexture *base, MetalTexture *view) {
+  if (!attached)
+    return false;
+  if (view)
+    return attached == view;
+  return attached == base || attached->parentTexture() == base;
+}
+
+/**
+Textures (or views of them) discarded in the chunk being encoded, until a
+render pass that attaches them takes the discard and skips loading.
+
+`Texture::current()` is the allocation being discarded, `Encoder` is the
+linked list of encoders recorded since the discard.
+*/
+template <typename Texture, typename Encoder> class DiscardedTextureList {
+public:
+  static constexpr unsigned kAllViews = ~0u;
+
+  void
+  add(Rc<Texture> &&texture, unsigned viewId, Encoder *since) {
+    auto allocation = texture->current();
+    entries_.push_back({std::move(texture), allocation, viewId, since});
+  }
+
+  /**
+  Returns true if the attachment has been discarded, and neither renamed nor
+  written by any encoder since then. The discard is consumed either way.
+  */
+  bool
+  take(Rc<Texture> const &texture, unsigned viewId) {
+    for (auto it = entries_.begin(); it != entries_.end(); it++) {
+      if (it->texture.ptr() != texture.ptr())
+        continue;
+      if (it->viewId != kAllViews && it->viewId != viewId)
+        continue;
+      auto discarded = std::move(*it);
+      entries_.erase(it);
+      if (discarded.allocation != texture->current())
+        return false;
+      // any write after the discard makes the content valid again
+      EncoderDepSet written;
+      written.add(discarded.allocation->depkey);
+      for (auto encoder = discarded.since->next; encoder; encoder = encoder->next) {
+        if (!encoder->tex_write.isDisjointWith(written))
+          return false;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void
+  clear() {
+    entries_.clear();
+  }
+
+private:
+  struct Entry {
+    Rc<Texture> texture;
+    decltype(std::declval<Texture &>().current()) allocation;
+    unsigned viewId;
+    Encoder *since;
+  };
+  std::vector<Entry> entries_;
+};
+
+} // namespace dxmt
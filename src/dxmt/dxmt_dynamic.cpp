@@ -1,5 +1,6 @@
 #include "dxmt_dynamic.hpp"
 #include "dxmt_texture.hpp"
+#include <algorithm>
 
 namespace dxmt {
 DynamicBuffer::DynamicBuffer(Buffer *buffer, Flags<BufferAllocationFlag> flags) :
@@ -42,10 +43,17 @@ DynamicBuffer::allocate(uint64_t coherent_seq_id) {
 void
 DynamicBuffer::updateImmediateName(uint64_t current_seq_id, Rc<BufferAllocation> &&allocation, bool owned_by_command_list) {
   std::lock_guard<dxmt::mutex> lock(mutex_);
-  if (!owned_by_command_list_)
+  if (aliased) {
+    // the allocation may still be read through another buffer, so it's never
+    // recycled, but released along with the last buffer sharing it
+    if (owned_by_command_list_)
+      shared_by_command_list_.push_back(name_.ptr());
+  } else if (!owned_by_command_list_) {
     fifo.push(QueueEntry{.allocation = std::move(name_), .will_free_at = current_seq_id});
+  }
   name_ = std::move(allocation);
   owned_by_command_list_ = owned_by_command_list;
+  aliased = false;
 }
 
 void
@@ -58,6 +66,12 @@ DynamicBuffer::recycle(uint64_t current_seq_id, Rc<BufferAllocation> &&allocatio
       return;
     }
   }
+  auto shared = std::find(shared_by_command_list_.begin(), shared_by_command_list_.end(), allocation.ptr());
+  if (shared != shared_by_command_list_.end()) {
+    shared_by_command_list_.erase(shared);
+    auto _ = std::move(allocation);
+    return;
+  }
   fifo.push(QueueEntry{.allocation = std::move(allocation), .will_free_at = current_seq_id});
 }
 
@@ -2,6 +2,7 @@
 #include "dxmt_buffer.hpp"
 #include "dxmt_texture.hpp"
 #include <queue>
+#include <vector>
 
 namespace dxmt {
 
@@ -36,6 +37,13 @@ public:
    */
   Buffer *buffer;
 
+  /**
+  Set when the allocation of `buffer` may be shared with another buffer (see
+  `Buffer::alias`), thus the immediate name must not be written in place, nor
+  recycled. Cleared by `updateImmediateName`.
+  */
+  bool aliased = false;
+
 private:
   Flags<BufferAllocationFlag> flags_;
   std::atomic<uint32_t> refcount_ = {0u};
@@ -43,6 +51,11 @@ private:
   dxmt::mutex mutex_;
   Rc<BufferAllocation> name_;
   bool owned_by_command_list_ = false;
+  /**
+  Names handed over by command lists that have been shared with another
+  buffer, dropped instead of recycled once the command list gives them back.
+  */
+  std::vector<BufferAllocation *> shared_by_command_list_;
 };
 
 class DynamicTexture {
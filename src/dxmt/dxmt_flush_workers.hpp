@@ -0,0 +1,142 @@
+#pragma once
+
+#include "thread.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace dxmt {
+
+/**
+Flushes chunks, which are prepared one after another in submission order, on
+a fixed set of workers. Chunk N is flushed by worker (N - 1) % worker count.
+Workers commit as soon as they are done, so chunks can be committed out of
+order. The submitter is responsible for reserving the execution order
+beforehand (i.e. `MTL::CommandBuffer::enqueue`).
+
+An ordered chunk (e.g. one that acquires a drawable) is flushed on the
+submitting thread instead, so ordered chunks are flushed in order with respect
+to each other. Without any worker, every chunk is flushed that way.
+
+Chunk N occupies slot N % NumSlots. The submitter must not reuse a slot
+before the previous chunk in it has been waited with `waitCommitted`.
+*/
+template <size_t NumSlots> class FlushWorkers {
+public:
+  using FlushFn = std::function<void(uint64_t seq)>;
+  using WorkerInitFn = std::function<void(uint32_t worker_index)>;
+
+  FlushWorkers() = default;
+  FlushWorkers(const FlushWorkers &) = delete;
+
+  ~FlushWorkers() {
+    stop();
+  }
+
+  /**
+  `flush(seq)` encodes chunk `seq`, and has committed it once it returns.
+  */
+  void
+  start(uint32_t worker_count, FlushFn &&flush, WorkerInitFn &&init = {}) {
+    flush_ = std::move(flush);
+    init_ = std::move(init);
+    worker_count_ = worker_count;
+    for (uint32_t i = 0; i < worker_count_; i++) {
+      workers_.emplace_back([this, i]() { this->worker(i); });
+    }
+  }
+
+  void
+  stop() {
+    if (stopped_.exchange(true))
+      return;
+    prepared_.fetch_add(1, std::memory_order_release);
+    prepared_.notify_all();
+    // wakes up `waitCommitted`, which checks `stopped_` once woken
+    for (auto &committed : committed_) {
+      committed.store(~0ull, std::memory_order_release);
+      committed.notify_all();
+    }
+    for (auto &worker : workers_)
+      worker.join();
+    workers_.clear();
+  }
+
+  /**
+  Hands chunk `seq` over once it's prepared. Must be called in order.
+  */
+  void
+  submit(uint64_t seq, bool ordered) {
+    auto slot = seq % NumSlots;
+    ordered_[slot] = ordered || !worker_count_;
+    if (ordered_[slot]) {
+      flush_(seq);
+      markCommitted(seq);
+    }
+    prepared_.store(seq + 1, std::memory_order_release);
+    prepared_.notify_all();
+  }
+
+  /**
+  Blocks until chunk `seq` is committed. Returns false if stopped meanwhile.
+  */
+  bool
+  waitCommitted(uint64_t seq) {
+    auto &committed = committed_[seq % NumSlots];
+    while (true) {
+      uint64_t current = committed.load(std::memory_order_acquire);
+      if (stopped_.load())
+        return false;
+      if (current >= seq)
+        return true;
+      committed.wait(current, std::memory_order_acquire);
+    }
+  }
+
+  uint32_t
+  workerCount() const {
+    return worker_count_;
+  }
+
+private:
+  void
+  markCommitted(uint64_t seq) {
+    auto &committed = committed_[seq % NumSlots];
+    committed.store(seq, std::memory_order_release);
+    committed.notify_all();
+  }
+
+  void
+  worker(uint32_t worker_index) {
+    if (init_)
+      init_(worker_index);
+    uint64_t seq = 1 + worker_index;
+    while (!stopped_.load()) {
+      uint64_t prepared = prepared_.load(std::memory_order_acquire);
+      if (prepared <= seq) {
+        prepared_.wait(prepared, std::memory_order_acquire);
+        continue;
+      }
+      if (stopped_.load())
+        break;
+      if (!ordered_[seq % NumSlots]) {
+        flush_(seq);
+        markCommitted(seq);
+      }
+      seq += worker_count_;
+    }
+  }
+
+  FlushFn flush_;
+  WorkerInitFn init_;
+  uint32_t worker_count_ = 0;
+  std::vector<dxmt::thread> workers_;
+  std::atomic_bool stopped_ = false;
+  std::atomic_uint64_t prepared_ = 1;
+  std::array<bool, NumSlots> ordered_{};
+  std::array<std::atomic_uint64_t, NumSlots> committed_{};
+};
+
+} // namespace dxmt
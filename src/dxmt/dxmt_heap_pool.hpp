@@ -0,0 +1,78 @@
+#pragma once
+
+#include "thread.hpp"
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace dxmt {
+
+/**
+A fixed set of equally sized CPU heaps. A heap is only needed while a chunk is
+between preparation and flush, which is at most one chunk per flush worker
+plus the one being prepared, so the pool is sized to the worker count instead
+of the chunk count. `acquire` blocks until a heap is released.
+*/
+class CpuHeapPool {
+public:
+  CpuHeapPool() = default;
+  CpuHeapPool(const CpuHeapPool &) = delete;
+
+  ~CpuHeapPool() {
+    for (auto heap : heaps_)
+      free(heap);
+  }
+
+  void
+  init(uint32_t heap_count, size_t heap_size) {
+    for (uint32_t i = 0; i < heap_count; i++)
+      heaps_.push_back((char *)malloc(heap_size));
+    available_ = heaps_;
+  }
+
+  /**
+  Returns nullptr if the pool has been stopped meanwhile.
+  */
+  char *
+  acquire() {
+    std::unique_lock<dxmt::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return stopped_ || !available_.empty(); });
+    if (stopped_)
+      return nullptr;
+    auto heap = available_.back();
+    available_.pop_back();
+    return heap;
+  }
+
+  void
+  release(char *heap) {
+    {
+      std::lock_guard<dxmt::mutex> lock(mutex_);
+      available_.push_back(heap);
+    }
+    cond_.notify_one();
+  }
+
+  void
+  stop() {
+    {
+      std::lock_guard<dxmt::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    cond_.notify_all();
+  }
+
+  size_t
+  size() const {
+    return heaps_.size();
+  }
+
+private:
+  dxmt::mutex mutex_;
+  dxmt::condition_variable cond_;
+  std::vector<char *> heaps_;
+  std::vector<char *> available_;
+  bool stopped_ = false;
+};
+
+} // namespace dxmt
@@ -1,183 +1,79 @@
 #pragma once
 
 #include "Metal/MTLBuffer.hpp"
+#include "Metal/MTLDevice.hpp"
+#include "dxmt_visibility_result.hpp"
 #include "objc_pointer.hpp"
 #include "rc/util_rc_ptr.hpp"
-#include <atomic>
-#include <cassert>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 namespace dxmt {
-class VisibilityResultOffsetBumpState {
-public:
-  void
-  beginEncoder() {
-    assert(!within_encoder);
-    assert(!current_data_is_dirty);
-    assert(!~previous_offset);
-    within_encoder = true;
-  }
-
-  bool
-  tryGetNextWriteOffset(bool has_active_occlusion_queries, uint64_t &offset) {
-    assert(within_encoder);
-    offset = getNextWriteOffset(has_active_occlusion_queries);
-    if (offset == previous_offset) {
-      return false;
-    }
-    previous_offset = offset;
-    return true;
-  }
+/**
+Visibility results written within a command chunk, and the queries to be
+resolved from them once the chunk completes.
 
-  uint64_t
-  getNextReadOffset() {
-    if (within_encoder) {
-      if (current_data_is_dirty) {
-        current_data_is_dirty = false;
-        return ++next_offset;
-      }
-    }
-    assert(!current_data_is_dirty);
-    return next_offset;
-  }
-
-  void
-  endEncoder() {
-    assert(within_encoder);
-    within_encoder = false;
-    previous_offset = ~0uLL;
-    if (current_data_is_dirty) {
-      next_offset++;
-      current_data_is_dirty = false;
-    }
-  }
-
-  uint64_t
-  reset() {
-    assert(!within_encoder && "encoder still active");
-    assert(!current_data_is_dirty && "encoder still active");
-    auto ret = next_offset;
-    next_offset = 0;
-    return ret;
-  }
-
-private:
-  uint64_t
-  getNextWriteOffset(bool has_active_occlusion_queries) {
-    if (has_active_occlusion_queries) {
-      current_data_is_dirty = true;
-      return next_offset;
-    }
-    return ~0uLL;
-  };
-
-  bool within_encoder = false;
-  bool current_data_is_dirty = false;
-  uint64_t previous_offset = ~0uLL;
-  uint64_t next_offset = 0;
-};
-
-class VisibilityResultQuery {
+Chunks are reused in a ring, the result heap and the storage are kept across
+reuse, so a chunk normally doesn't allocate anything.
+*/
+class VisibilityResultReadback {
 public:
-  void
-  incRef() {
-    refcount_.fetch_add(1u, std::memory_order_acquire);
-  }
-  void
-  decRef() {
-    if (refcount_.fetch_sub(1u, std::memory_order_release) == 1u)
-      delete this;
-  }
-
-  void
-  begin(uint64_t seqId, unsigned offset) {
-    accumulated_value_ = 0;
-    seq_id_begin = seqId;
-    occlusion_counter_begin = offset;
-    seq_id_end = ~0uLL;
-    occlusion_counter_end = ~0uLL;
-  }
-
-  void
-  end(uint64_t seqId, unsigned offset) {
-    seq_id_end = seqId;
-    occlusion_counter_end = offset;
-    if (seq_id_begin == seq_id_end && occlusion_counter_begin == occlusion_counter_end) {
-      seq_id_issued = seq_id_end;
+  /**
+  Takes the queries pending in this chunk, and returns a zero-initialized heap
+  for `num_results` results, or nullptr if there is no result at all.
+  */
+  MTL::Buffer *
+  prepare(
+      MTL::Device *device, uint64_t seq_id, uint64_t num_results, std::vector<Rc<VisibilityResultQuery>> const &queries,
+      bool hazard_tracking
+  ) {
+    seq_id_ = seq_id;
+    num_results_ = num_results;
+    queries_.assign(queries.begin(), queries.end());
+    if (!num_results)
+      return nullptr;
+    if (!heap_ || capacity_ < num_results || hazard_tracking_ != hazard_tracking) {
+      capacity_ = std::max<uint64_t>(capacity_, 64);
+      while (capacity_ < num_results)
+        capacity_ <<= 1;
+      hazard_tracking_ = hazard_tracking;
+      auto tracking_mode =
+          hazard_tracking ? MTL::ResourceHazardTrackingModeTracked : MTL::ResourceHazardTrackingModeUntracked;
+      heap_ = transfer(device->newBuffer(capacity_ * sizeof(uint64_t), tracking_mode | MTL::ResourceStorageModeShared));
     }
+    std::memset(heap_->contents(), 0, num_results * sizeof(uint64_t));
+    return heap_.ptr();
   }
 
-  uint64_t queryEndAt() {
-    return seq_id_end;
-  };
-
+  /**
+  Sums the results up once, then each query is resolved in constant time
+  regardless of how many results it spans.
+  */
   void
-  issue(uint64_t seqId, uint64_t const *readbackBuffer, unsigned numResults) {
-    assert(seqId >= seq_id_begin);
-    assert(seqId <= seq_id_end);
-    uint64_t const *start = seqId == seq_id_begin ? readbackBuffer + occlusion_counter_begin : readbackBuffer;
-    uint64_t const *end = seqId == seq_id_end ? readbackBuffer + occlusion_counter_end : readbackBuffer + numResults;
-    assert(start <= end);
-    while (start != end) {
-      accumulated_value_ += *start;
-      start++;
-    }
-    seq_id_issued = seqId;
-  }
-
-  bool
-  getValue(uint64_t *value) {
-    if (seq_id_end <= seq_id_issued) {
-      *value = accumulated_value_;
-      return true;
-    }
-    return false;
+  resolve() {
+    if (queries_.empty())
+      return;
+    auto results = num_results_ ? (uint64_t const *)heap_->contents() : nullptr;
+    ResolveVisibilityResults(seq_id_, results, num_results_, queries_, prefix_sum_);
+    queries_.clear();
   }
 
   void
   reset() {
-    accumulated_value_ = 0;
-    seq_id_begin = ~0uLL;
-    occlusion_counter_begin = ~0uLL;
-    seq_id_end = ~0uLL;
-    occlusion_counter_end = ~0uLL;
-    seq_id_issued = 0;
-  };
-
-private:
-  uint64_t accumulated_value_ = 0;
-  uint64_t seq_id_begin = ~0uLL;
-  uint64_t occlusion_counter_begin = ~0uLL;
-  uint64_t seq_id_end = ~0uLL;
-  uint64_t occlusion_counter_end = ~0uLL;
-  uint64_t seq_id_issued = 0;
-  std::atomic<uint32_t> refcount_ = {0u};
-};
-
-class VisibilityResultReadback {
-public:
-  VisibilityResultReadback(
-      uint64_t seq_id, uint64_t num_results, std::vector<Rc<VisibilityResultQuery>> &queries,
-      Obj<MTL::Buffer> &&visibility_result_heap
-  ) :
-      seq_id(seq_id),
-      num_results(num_results),
-      queries(queries),
-      visibility_result_heap(std::move(visibility_result_heap)) {}
-  ~VisibilityResultReadback() {
-    for (auto query : queries) {
-      query->issue(seq_id, (uint64_t *)visibility_result_heap->contents(), num_results);
-    }
+    queries_.clear();
+    num_results_ = 0;
   }
 
-  VisibilityResultReadback(const VisibilityResultReadback &) = delete;
-  VisibilityResultReadback(VisibilityResultReadback &&) = default;
-
-  uint64_t seq_id;
-  uint64_t num_results;
-  std::vector<Rc<VisibilityResultQuery>> queries;
-  Obj<MTL::Buffer> visibility_result_heap;
+private:
+  uint64_t seq_id_ = 0;
+  uint64_t num_results_ = 0;
+  uint64_t capacity_ = 0;
+  bool hazard_tracking_ = false;
+  Obj<MTL::Buffer> heap_;
+  std::vector<Rc<VisibilityResultQuery>> queries_;
+  std::vector<uint64_t> prefix_sum_;
 };
 
 } // namespace dxmt
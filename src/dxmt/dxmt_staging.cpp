@@ -1,5 +1,6 @@
 #include "dxmt_staging.hpp"
 #include "Metal/MTLDevice.hpp"
+#include <algorithm>
 
 namespace dxmt {
 
@@ -20,39 +21,6 @@ StagingResource::decRef() {
     delete this;
 };
 
-void
-StagingResource::useCopyDestination(uint64_t seq_id) {
-  assert(!mapped && "write to staging resource while being mapped");
-  // coherent read-after-write
-  cpu_coherent_after_finished_seq_id = std::max(seq_id, cpu_coherent_after_finished_seq_id);
-  // coherent write-after-write
-  gpu_occupied_until_finished_seq_id = std::max(seq_id, gpu_occupied_until_finished_seq_id);
-}
-void
-StagingResource::useCopySource(uint64_t seq_id) {
-  assert(!mapped && "read from staging resource while being mapped");
-  gpu_occupied_until_finished_seq_id = std::max(seq_id, gpu_occupied_until_finished_seq_id);
-}
-
-StagingMapResult
-StagingResource::tryMap(uint64_t coherent_seq_id, bool read, bool write) {
-  if (mapped)
-    return StagingMapResult::Mapped;
-  if (read && coherent_seq_id < cpu_coherent_after_finished_seq_id)
-    return StagingMapResult(cpu_coherent_after_finished_seq_id - coherent_seq_id);
-  if (write && coherent_seq_id < gpu_occupied_until_finished_seq_id) {
-    if (coherent_seq_id >= cpu_coherent_after_finished_seq_id)
-      return StagingMapResult::Renamable;
-    return StagingMapResult(gpu_occupied_until_finished_seq_id - coherent_seq_id);
-  }
-  return StagingMapResult::Mappable;
-}
-
-void
-StagingResource::unmap() {
-  mapped = false;
-}
-
 Obj<MTL::Buffer>
 StagingResource::allocate(uint64_t coherent_seq_id) {
   std::lock_guard<dxmt::mutex> lock(mutex_);
@@ -79,8 +47,7 @@ StagingResource::updateImmediateName(uint64_t current_seq_id, Obj<MTL::Buffer> &
   std::lock_guard<dxmt::mutex> lock(mutex_);
   fifo.push(QueueEntry{.allocation = std::move(name_), .will_free_at = current_seq_id});
   name_ = std::move(allocation);
-  cpu_coherent_after_finished_seq_id = 0;
-  gpu_occupied_until_finished_seq_id = 0;
+  renamed();
 }
 
 } // namespace dxmt
@@ -1,5 +1,6 @@
 #pragma once
 #include "Metal/MTLBuffer.hpp"
+#include "dxmt_staging_state.hpp"
 #include "objc_pointer.hpp"
 #include "thread.hpp"
 #include <cstdint>
@@ -8,23 +9,11 @@
 
 namespace dxmt {
 
-enum class StagingMapResult : uint64_t {
-  Mappable = 0,
-  Renamable = 0xffffffffffffffff,
-  Mapped = 0xfffffffffffffffe,
-};
-
-class StagingResource {
+class StagingResource : public StagingMapState {
 public:
   void incRef();
   void decRef();
 
-  void useCopyDestination(uint64_t seq_id);
-  void useCopySource(uint64_t seq_id);
-
-  StagingMapResult tryMap(uint64_t coherent_seq_id, bool read, bool write);
-  void unmap();
-
   Obj<MTL::Buffer> allocate(uint64_t coherent_seq_id);
   void updateImmediateName(uint64_t current_seq_id, Obj<MTL::Buffer> &&allocation);
 
@@ -60,11 +49,6 @@ private:
   std::atomic<uint32_t> refcount_ = {0u};
   std::queue<QueueEntry> fifo;
   dxmt::mutex mutex_;
-  bool mapped = false;
-  // prevent read from staging before
-  uint64_t cpu_coherent_after_finished_seq_id = 0;
-  // prevent write to staging before
-  uint64_t gpu_occupied_until_finished_seq_id = 0;
 };
 
 } // namespace dxmt
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace dxmt {
+
+enum class StagingMapResult : uint64_t {
+  Mappable = 0,
+  Renamable = 0xffffffffffffffff,
+  Mapped = 0xfffffffffffffffe,
+};
+
+/**
+Tracks which chunks access a staging resource, to tell if it can be mapped
+now. Otherwise the result is the number of chunks to wait for, or whether
+the resource can be renamed instead.
+*/
+class StagingMapState {
+public:
+  void
+  useCopyDestination(uint64_t seq_id) {
+    assert(!mapped && "write to staging resource while being mapped");
+    // the content is going to be valid again
+    discarded = false;
+    // coherent read-after-write
+    cpu_coherent_after_finished_seq_id = std::max(seq_id, cpu_coherent_after_finished_seq_id);
+    // coherent write-after-write
+    gpu_occupied_until_finished_seq_id = std::max(seq_id, gpu_occupied_until_finished_seq_id);
+  }
+
+  void
+  useCopySource(uint64_t seq_id) {
+    assert(!mapped && "read from staging resource while being mapped");
+    gpu_occupied_until_finished_seq_id = std::max(seq_id, gpu_occupied_until_finished_seq_id);
+  }
+
+  StagingMapResult
+  tryMap(uint64_t coherent_seq_id, bool read, bool write) {
+    if (mapped)
+      return StagingMapResult::Mapped;
+    if (read && coherent_seq_id < cpu_coherent_after_finished_seq_id)
+      return StagingMapResult(cpu_coherent_after_finished_seq_id - coherent_seq_id);
+    if (write && !read && discarded &&
+        coherent_seq_id < std::max(gpu_occupied_until_finished_seq_id, cpu_coherent_after_finished_seq_id))
+      return StagingMapResult::Renamable;
+    if (write && coherent_seq_id < gpu_occupied_until_finished_seq_id) {
+      if (coherent_seq_id >= cpu_coherent_after_finished_seq_id)
+        return StagingMapResult::Renamable;
+      return StagingMapResult(gpu_occupied_until_finished_seq_id - coherent_seq_id);
+    }
+    return StagingMapResult::Mappable;
+  }
+
+  void
+  unmap() {
+    mapped = false;
+  }
+
+  /**
+  content is discarded, next write map can rename without waiting or copying,
+  until the GPU writes it again
+  */
+  bool discarded = false;
+
+protected:
+  /**
+  A new allocation has not been accessed by any chunk yet
+  */
+  void
+  renamed() {
+    cpu_coherent_after_finished_seq_id = 0;
+    gpu_occupied_until_finished_seq_id = 0;
+  }
+
+  bool mapped = false;
+  // prevent read from staging before
+  uint64_t cpu_coherent_after_finished_seq_id = 0;
+  // prevent write to staging before
+  uint64_t gpu_occupied_until_finished_seq_id = 0;
+};
+
+} // namespace dxmt
@@ -17,6 +17,7 @@ enum class FeatureCompatibility {
     UnsupportedPredication,
     UnsupportedStreamOutputAppending,
     UnsupportedMultipleStreamOutput,
+    UnsupportedIndirectPipelineStatistics,
   };
 
 enum class ScalerType {
@@ -38,6 +39,9 @@ struct ScalerInfo {
 struct FrameStatistics {
   Flags<FeatureCompatibility> compatibility_flags;
   uint32_t command_buffer_count = 0;
+  uint32_t adaptive_commit_count = 0;
+  uint32_t chunk_command_count = 0;
+  uint32_t max_chunk_command_count = 0;
   uint32_t sync_count = 0;
   clock::duration sync_interval{};
   clock::duration commit_interval{};
@@ -47,7 +51,10 @@ struct FrameStatistics {
   uint32_t clear_pass_optimized = 0;
   uint32_t compute_pass_count = 0;
   uint32_t blit_pass_count = 0;
+  uint32_t blit_pass_aliased = 0;
   uint32_t event_stall = 0;
+  uint32_t query_pass_saved = 0;
+  uint32_t sampler_specialization_count = 0;
   uint32_t latency = 0;
   clock::duration encode_prepare_interval{};
   clock::duration encode_flush_interval{};
@@ -59,6 +66,9 @@ struct FrameStatistics {
   reset() {
     compatibility_flags.clrAll();
     command_buffer_count = 0;
+    adaptive_commit_count = 0;
+    chunk_command_count = 0;
+    max_chunk_command_count = 0;
     sync_count = 0;
     sync_interval = {};
     commit_interval = {};
@@ -68,7 +78,10 @@ struct FrameStatistics {
     clear_pass_optimized = 0;
     compute_pass_count = 0;
     blit_pass_count = 0;
+    blit_pass_aliased = 0;
     event_stall = 0;
+    query_pass_saved = 0;
+    sampler_specialization_count = 0;
     latency = 0;
     encode_prepare_interval = {};
     encode_flush_interval = {};
@@ -121,6 +134,8 @@ public:
       if (i == current_frame)
         continue; // deliberately exclude current frame since it
       min_.command_buffer_count = std::min(min_.command_buffer_count, frames_[i].command_buffer_count);
+      min_.adaptive_commit_count = std::min(min_.adaptive_commit_count, frames_[i].adaptive_commit_count);
+      min_.chunk_command_count = std::min(min_.chunk_command_count, frames_[i].chunk_command_count);
       min_.sync_count = std::min(min_.sync_count, frames_[i].sync_count);
       min_.event_stall = std::min(min_.sync_count, frames_[i].event_stall);
       min_.commit_interval = std::min(min_.commit_interval, frames_[i].commit_interval);
@@ -132,8 +147,12 @@ public:
       min_.present_lantency_interval = std::min(min_.present_lantency_interval, frames_[i].present_lantency_interval);
 
       max_.command_buffer_count = std::max(max_.command_buffer_count, frames_[i].command_buffer_count);
+      max_.adaptive_commit_count = std::max(max_.adaptive_commit_count, frames_[i].adaptive_commit_count);
+      max_.chunk_command_count = std::max(max_.chunk_command_count, frames_[i].chunk_command_count);
+      max_.max_chunk_command_count = std::max(max_.max_chunk_command_count, frames_[i].max_chunk_command_count);
       max_.sync_count = std::max(max_.sync_count, frames_[i].sync_count);
       max_.event_stall = std::max(max_.event_stall, frames_[i].event_stall);
+      max_.query_pass_saved = std::max(max_.query_pass_saved, frames_[i].query_pass_saved);
       max_.commit_interval = std::max(max_.commit_interval, frames_[i].commit_interval);
       max_.sync_interval = std::max(max_.sync_interval, frames_[i].sync_interval);
       max_.encode_prepare_interval = std::max(max_.encode_prepare_interval, frames_[i].encode_prepare_interval);
@@ -143,8 +162,11 @@ public:
       max_.present_lantency_interval = std::max(min_.present_lantency_interval, frames_[i].present_lantency_interval);
 
       average_.command_buffer_count += frames_[i].command_buffer_count;
+      average_.adaptive_commit_count += frames_[i].adaptive_commit_count;
+      average_.chunk_command_count += frames_[i].chunk_command_count;
       average_.sync_count += frames_[i].sync_count;
       average_.event_stall += frames_[i].event_stall;
+      average_.query_pass_saved += frames_[i].query_pass_saved;
       average_.commit_interval += frames_[i].commit_interval;
       average_.sync_interval += frames_[i].sync_interval;
       average_.encode_prepare_interval += frames_[i].encode_prepare_interval;
@@ -153,8 +175,14 @@ public:
       average_.present_lantency_interval += frames_[i].present_lantency_interval;
     }
     average_.command_buffer_count /= (kFrameStatisticsCount - 1);
+    average_.adaptive_commit_count /= (kFrameStatisticsCount - 1);
+    average_.chunk_command_count /= (kFrameStatisticsCount - 1);
+    // a maximum is not averaged
+    min_.max_chunk_command_count = max_.max_chunk_command_count;
+    average_.max_chunk_command_count = max_.max_chunk_command_count;
     average_.sync_count /= (kFrameStatisticsCount - 1);
     average_.event_stall /= (kFrameStatisticsCount - 1);
+    average_.query_pass_saved /= (kFrameStatisticsCount - 1);
     average_.commit_interval /= (kFrameStatisticsCount - 1);
     average_.sync_interval /= (kFrameStatisticsCount - 1);
     average_.encode_prepare_interval /= (kFrameStatisticsCount - 1);
@@ -132,7 +132,11 @@ task_scheduler<Task>::submit(Task task) {
   std::unique_lock<dxmt::mutex> lock(worker_mutex_);
   task_queue_.push(task);
 
-  if (running.load(std::memory_order_relaxed) == threads && threads < max_threads) {
+  // tasks are often submitted in bursts (e.g. all stages of a pipeline), so
+  // grow as soon as pending work outnumbers the workers instead of waiting
+  // for all of them to be busy
+  uint64_t pending = running.load(std::memory_order_relaxed) + task_queue_.size() + task_continuation_queue_.size();
+  if (pending > threads && threads < max_threads) {
     workers_.emplace_back([this]() { worker_func(); });
     threads++;
   }
@@ -59,6 +59,11 @@ public:
   uint64_t gpuResourceID;
   DXMT_RESOURCE_RESIDENCY_STATE residencyState;
   EncoderDepKey depkey;
+  /**
+  The view whose mipmaps have been generated and not written since, so that
+  generating them again can be skipped. Only accessed from the encoding thread.
+  */
+  TextureViewKey mipmappedView = ~0u;
 
 private:
   TextureAllocation(
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "rc/util_rc_ptr.hpp"
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dxmt {
+
+/**
+Timestamps are reported in nanoseconds, so the frequency of
+D3D11_QUERY_TIMESTAMP_DISJOINT is always 1GHz.
+*/
+constexpr uint64_t kTimestampFrequency = 1'000'000'000;
+
+/**
+Anything that reports when GPU started and finished executing a batch of
+work, in seconds. `MTL::CommandBuffer` is one.
+*/
+template <typename T>
+concept TimestampSource = requires(T &source) {
+  { source.GPUStartTime() } -> std::convertible_to<double>;
+  { source.GPUEndTime() } -> std::convertible_to<double>;
+};
+
+class TimestampQuery {
+public:
+  void
+  incRef() {
+    refcount_.fetch_add(1u, std::memory_order_acquire);
+  }
+  void
+  decRef() {
+    if (refcount_.fetch_sub(1u, std::memory_order_release) == 1u)
+      delete this;
+  }
+
+  void
+  resolve(uint64_t value) {
+    value_ = value;
+    resolved_.store(true, std::memory_order_release);
+  }
+
+  bool
+  getValue(uint64_t *value) {
+    if (!resolved_.load(std::memory_order_acquire))
+      return false;
+    *value = value_;
+    return true;
+  }
+
+private:
+  uint64_t value_ = 0;
+  std::atomic_bool resolved_ = false;
+  std::atomic<uint32_t> refcount_ = {0u};
+};
+
+/**
+Timestamps written within a command chunk. They are resolved to the start
+time of the chunk if no command has been recorded before, otherwise to the end
+time of the chunk, which is the earliest point known to follow all previous
+commands. The chunk is committed before the next pass starts after such a
+timestamp, so consecutive timestamps share the chunk (and its end time), while
+later work doesn't.
+
+Chunks are reused in a ring, the storage is kept across reuse.
+*/
+class TimestampReadback {
+public:
+  void
+  record(Rc<TimestampQuery> &&query, bool at_start) {
+    queries_.emplace_back(std::move(query), at_start);
+  }
+
+  /**
+  Returns false if the source doesn't provide valid timings (e.g. command
+  buffer failed), in which case the timestamps previously resolved in this
+  slot are reused and should be considered disjoint.
+  */
+  template <TimestampSource Source>
+  bool
+  resolve(Source &source) {
+    double start = source.GPUStartTime();
+    double end = source.GPUEndTime();
+    bool valid = start > 0 && end >= start;
+    if (valid) {
+      last_start_ = toTimestamp(start);
+      last_end_ = toTimestamp(end);
+    }
+    for (auto &[query, at_start] : queries_) {
+      query->resolve(at_start ? last_start_ : last_end_);
+    }
+    queries_.clear();
+    return valid;
+  }
+
+  void
+  reset() {
+    queries_.clear();
+  }
+
+  static uint64_t
+  toTimestamp(double seconds) {
+    return uint64_t(seconds * double(kTimestampFrequency));
+  }
+
+private:
+  std::vector<std::pair<Rc<TimestampQuery>, bool>> queries_;
+  uint64_t last_start_ = 0;
+  uint64_t last_end_ = 0;
+};
+
+} // namespace dxmt
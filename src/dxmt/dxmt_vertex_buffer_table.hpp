@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace dxmt {
+
+/**
+The last encoded vertex buffer table. Within the same encoder it can be reused
+as long as no slot in it has been rebound (tracked by a dirty mask owned by
+the caller) and no bound buffer has been renamed since. It's never reused
+across encoders, because residency is tracked per encoder and each chunk has
+its own heap.
+*/
+template <typename Kind, unsigned NumSlots> class VertexBufferTableCache {
+public:
+  /**
+  `generation(slot)` returns the rename generation of the buffer currently
+  bound to `slot`, or 0 if none is bound.
+  */
+  template <typename GenerationFn>
+  bool
+  reusable(Kind kind, uint32_t slot_mask, uint64_t encoder_id, uint32_t dirty_mask, GenerationFn &&generation) const {
+    if (!valid_ || kind_ != kind || slot_mask_ != slot_mask || encoder_id_ != encoder_id)
+      return false;
+    if (dirty_mask & slot_mask)
+      return false;
+    for (unsigned slot = 0; slot < NumSlots; slot++) {
+      if (!(slot_mask & (1u << slot)))
+        continue;
+      if (generation(slot) != generation_[slot])
+        return false;
+    }
+    return true;
+  }
+
+  /**
+  Records a newly encoded table. `generation(slot)` is sampled for every slot
+  in `slot_mask`, the same way as `reusable`.
+  */
+  template <typename GenerationFn>
+  void
+  store(Kind kind, uint32_t slot_mask, uint64_t encoder_id, uint64_t heap_offset, GenerationFn &&generation) {
+    for (unsigned slot = 0; slot < NumSlots; slot++) {
+      if (slot_mask & (1u << slot))
+        generation_[slot] = generation(slot);
+    }
+    valid_ = true;
+    kind_ = kind;
+    slot_mask_ = slot_mask;
+    encoder_id_ = encoder_id;
+    heap_offset_ = heap_offset;
+  }
+
+  uint64_t
+  heapOffset() const {
+    return heap_offset_;
+  }
+
+private:
+  bool valid_ = false;
+  Kind kind_{};
+  uint32_t slot_mask_ = 0;
+  uint64_t encoder_id_ = 0;
+  uint64_t heap_offset_ = 0;
+  std::array<uint64_t, NumSlots> generation_{};
+};
+
+} // namespace dxmt
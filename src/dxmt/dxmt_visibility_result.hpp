@@ -0,0 +1,261 @@
+#pragma once
+
+#include "rc/util_rc_ptr.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace dxmt {
+class VisibilityResultOffsetBumpState {
+public:
+  void
+  beginEncoder() {
+    assert(!within_encoder);
+    assert(!current_data_is_dirty);
+    assert(!~previous_offset);
+    within_encoder = true;
+  }
+
+  bool
+  tryGetNextWriteOffset(bool has_active_occlusion_queries, uint64_t &offset) {
+    assert(within_encoder);
+    offset = getNextWriteOffset(has_active_occlusion_queries);
+    if (offset == previous_offset) {
+      return false;
+    }
+    previous_offset = offset;
+    return true;
+  }
+
+  uint64_t
+  getNextReadOffset() {
+    if (within_encoder) {
+      if (current_data_is_dirty) {
+        current_data_is_dirty = false;
+        return ++next_offset;
+      }
+    }
+    assert(!current_data_is_dirty);
+    return next_offset;
+  }
+
+  void
+  endEncoder() {
+    assert(within_encoder);
+    within_encoder = false;
+    previous_offset = ~0uLL;
+    if (current_data_is_dirty) {
+      next_offset++;
+      current_data_is_dirty = false;
+    }
+  }
+
+  uint64_t
+  reset() {
+    assert(!within_encoder && "encoder still active");
+    assert(!current_data_is_dirty && "encoder still active");
+    auto ret = next_offset;
+    next_offset = 0;
+    return ret;
+  }
+
+private:
+  uint64_t
+  getNextWriteOffset(bool has_active_occlusion_queries) {
+    if (has_active_occlusion_queries) {
+      current_data_is_dirty = true;
+      return next_offset;
+    }
+    return ~0uLL;
+  };
+
+  bool within_encoder = false;
+  bool current_data_is_dirty = false;
+  uint64_t previous_offset = ~0uLL;
+  uint64_t next_offset = 0;
+};
+
+class VisibilityResultQuery {
+public:
+  void
+  incRef() {
+    refcount_.fetch_add(1u, std::memory_order_acquire);
+  }
+  void
+  decRef() {
+    if (refcount_.fetch_sub(1u, std::memory_order_release) == 1u)
+      delete this;
+  }
+
+  void
+  begin(uint64_t seqId, unsigned offset) {
+    accumulated_value_ = 0;
+    seq_id_begin = seqId;
+    occlusion_counter_begin = offset;
+    seq_id_end = ~0uLL;
+    occlusion_counter_end = ~0uLL;
+  }
+
+  void
+  end(uint64_t seqId, unsigned offset) {
+    seq_id_end = seqId;
+    occlusion_counter_end = offset;
+    if (seq_id_begin == seq_id_end && occlusion_counter_begin == occlusion_counter_end) {
+      seq_id_issued = seq_id_end;
+    }
+  }
+
+  uint64_t queryEndAt() {
+    return seq_id_end;
+  };
+
+  /**
+  Returns true if the query has begun and ended within chunk `seqId`, in which
+  case its results are in [begin, end) of the visibility result heap of that
+  chunk.
+  */
+  bool
+  resultRange(uint64_t seqId, uint64_t &begin, uint64_t &end) {
+    if (seq_id_begin != seqId || seq_id_end != seqId)
+      return false;
+    begin = occlusion_counter_begin;
+    end = occlusion_counter_end;
+    return true;
+  }
+
+  /**
+  `prefixSum[i]` is the sum of the first i results of chunk `seqId`, and has
+  `numResults + 1` elements.
+  */
+  void
+  issue(uint64_t seqId, uint64_t const *prefixSum, uint64_t numResults) {
+    assert(seqId >= seq_id_begin);
+    assert(seqId <= seq_id_end);
+    uint64_t start = seqId == seq_id_begin ? occlusion_counter_begin : 0;
+    uint64_t end = seqId == seq_id_end ? occlusion_counter_end : numResults;
+    assert(start <= end);
+    accumulated_value_ += prefixSum[end] - prefixSum[start];
+    seq_id_issued = seqId;
+  }
+
+  bool
+  getValue(uint64_t *value) {
+    if (seq_id_end <= seq_id_issued) {
+      *value = accumulated_value_;
+      return true;
+    }
+    return false;
+  }
+
+  void
+  reset() {
+    accumulated_value_ = 0;
+    seq_id_begin = ~0uLL;
+    occlusion_counter_begin = ~0uLL;
+    seq_id_end = ~0uLL;
+    occlusion_counter_end = ~0uLL;
+    seq_id_issued = 0;
+  };
+
+private:
+  uint64_t accumulated_value_ = 0;
+  uint64_t seq_id_begin = ~0uLL;
+  uint64_t occlusion_counter_begin = ~0uLL;
+  uint64_t seq_id_end = ~0uLL;
+  uint64_t occlusion_counter_end = ~0uLL;
+  uint64_t seq_id_issued = 0;
+  std::atomic<uint32_t> refcount_ = {0u};
+};
+
+/**
+Resolves `queries` from the `num_results` visibility results written by chunk
+`seq_id`. The results are summed up once into `prefix_sum` (kept by the caller
+to reuse its storage), then each query is resolved in constant time regardless
+of how many results it spans.
+*/
+inline void
+ResolveVisibilityResults(
+    uint64_t seq_id, uint64_t const *results, uint64_t num_results,
+    std::vector<Rc<VisibilityResultQuery>> const &queries, std::vector<uint64_t> &prefix_sum
+) {
+  prefix_sum.resize(num_results + 1);
+  uint64_t sum = 0;
+  prefix_sum[0] = 0;
+  for (uint64_t i = 0; i < num_results; i++) {
+    sum += results[i];
+    prefix_sum[i + 1] = sum;
+  }
+  for (auto &query : queries)
+    query->issue(seq_id, prefix_sum.data(), num_results);
+}
+
+enum class PredicateResult {
+  Draw,
+  Skip,
+  /* evaluated on GPU, by zeroing the arguments of an indirect draw */
+  Marshal,
+  /* can't be evaluated in time, the draw is executed anyway */
+  Unsupported,
+};
+
+/**
+The occlusion predicate set by SetPredication. A draw is skipped once the
+result of the query is read back and matches the predicate value. Before
+that, if the query began and ended in the current chunk and its results
+were written by an earlier render encoder, the draw can be predicated on GPU
+instead. Only draws with plain arguments can be marshaled that way.
+*/
+class VisibilityPredicate {
+public:
+  void
+  set(Rc<VisibilityResultQuery> &&query, bool value) {
+    query_ = std::move(query);
+    value_ = value;
+  }
+
+  void
+  reset() {
+    query_ = {};
+  }
+
+  /**
+  `encoder_begin` is the first visibility result offset written by the
+  current render encoder.
+  */
+  PredicateResult
+  evaluate(uint64_t seq_id, uint64_t encoder_begin, bool can_marshal) {
+    if (!query_)
+      return PredicateResult::Draw;
+    uint64_t value;
+    if (query_->getValue(&value))
+      return (value != 0) == value_ ? PredicateResult::Skip : PredicateResult::Draw;
+    if (can_marshal && query_->resultRange(seq_id, result_begin_, result_end_) && result_end_ <= encoder_begin)
+      return PredicateResult::Marshal;
+    return PredicateResult::Unsupported;
+  }
+
+  /**
+  Result range of the last `evaluate` that returned Marshal.
+  */
+  uint64_t
+  resultBegin() const {
+    return result_begin_;
+  }
+  uint64_t
+  resultEnd() const {
+    return result_end_;
+  }
+  bool
+  value() const {
+    return value_;
+  }
+
+private:
+  Rc<VisibilityResultQuery> query_;
+  bool value_ = false;
+  uint64_t result_begin_ = 0;
+  uint64_t result_end_ = 0;
+};
+
+} // namespace dxmt
@@ -241,6 +241,40 @@ template <typename T> bool bcmpeq(const T *a, const T *b) {
 #endif
 }
 
+/**
+ * \brief Compares two arrays of pointers element-wise
+ *
+ * \param [in] a First array
+ * \param [in] b Second array
+ * \param [in] count Number of elements, at most 64
+ * \returns Mask with bit \c i set if \c a[i] and \c b[i] differ
+ */
+inline uint64_t pcmpneq(const void *const *a, const void *const *b, size_t count) {
+  uint64_t mask = 0;
+  size_t i = 0;
+#if defined(DXMT_ARCH_X86) &&                                              \
+    (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+  constexpr size_t Lanes = 16 / sizeof(void *);
+  for (; i + Lanes <= count; i += Lanes) {
+    __m128i eq = _mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+    uint32_t neq;
+    if constexpr (sizeof(void *) == 8) {
+      // both halves of a pointer have to be equal
+      eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+      neq = ~_mm_movemask_pd(_mm_castsi128_pd(eq)) & 0x3;
+    } else {
+      neq = ~_mm_movemask_ps(_mm_castsi128_ps(eq)) & 0xF;
+    }
+    mask |= uint64_t(neq) << i;
+  }
+#endif
+  for (; i < count; i++)
+    mask |= uint64_t(a[i] != b[i]) << i;
+  return mask;
+}
+
 template <size_t Bits> class bitset {
   static constexpr size_t Qwords = align(Bits, 64) / 64;
 
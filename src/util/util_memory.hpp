@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+namespace dxmt {
+
+/**
+Copies `rows` rows of `bytes_per_row` bytes between two pitched layouts. Rows
+are coalesced into a single copy when both pitches are tight, so the copy
+itself is left to the (vectorized) memcpy of the C runtime.
+*/
+inline void
+copy_rows(
+    void *dst, size_t dst_row_pitch, const void *src, size_t src_row_pitch, size_t bytes_per_row, size_t rows
+) {
+  if (dst_row_pitch == bytes_per_row && src_row_pitch == bytes_per_row) {
+    std::memcpy(dst, src, bytes_per_row * rows);
+    return;
+  }
+  auto dst_row = reinterpret_cast<char *>(dst);
+  auto src_row = reinterpret_cast<const char *>(src);
+  for (size_t row = 0; row < rows; row++) {
+    std::memcpy(dst_row, src_row, bytes_per_row);
+    dst_row += dst_row_pitch;
+    src_row += src_row_pitch;
+  }
+}
+
+/**
+Same as `copy_rows`, for `slices` images of `rows` rows. Slices are coalesced
+too when there is no padding between them. For block-compressed formats a row
+is a row of blocks.
+*/
+inline void
+copy_rows(
+    void *dst, size_t dst_row_pitch, size_t dst_slice_pitch, const void *src, size_t src_row_pitch,
+    size_t src_slice_pitch, size_t bytes_per_row, size_t rows, size_t slices
+) {
+  if (slices == 1 || (dst_slice_pitch == dst_row_pitch * rows && src_slice_pitch == src_row_pitch * rows)) {
+    copy_rows(dst, dst_row_pitch, src, src_row_pitch, bytes_per_row, rows * slices);
+    return;
+  }
+  auto dst_slice = reinterpret_cast<char *>(dst);
+  auto src_slice = reinterpret_cast<const char *>(src);
+  for (size_t slice = 0; slice < slices; slice++) {
+    copy_rows(dst_slice, dst_row_pitch, src_slice, src_row_pitch, bytes_per_row, rows);
+    dst_slice += dst_slice_pitch;
+    src_slice += src_slice_pitch;
+  }
+}
+
+} // namespace dxmt
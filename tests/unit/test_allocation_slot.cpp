@@ -0,0 +1,130 @@
+#include "dxmt_allocation_slot.hpp"
+#include "test_utils.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace dxmt;
+
+struct FakeAllocation {
+  AliasCount aliases;
+  unsigned *destroyed;
+  std::atomic<uint32_t> refcount = {0u};
+
+  explicit FakeAllocation(unsigned *destroyed) : destroyed(destroyed) {}
+
+  void
+  incRef() {
+    refcount.fetch_add(1u, std::memory_order_acquire);
+  }
+  void
+  decRef() {
+    if (refcount.fetch_sub(1u, std::memory_order_release) == 1u) {
+      (*destroyed)++;
+      delete this;
+    }
+  }
+};
+
+using Slot = AllocationSlot<FakeAllocation>;
+
+static void
+test_alias_and_write() {
+  unsigned destroyed = 0;
+  Slot src, dst;
+  auto _ = src.rename(new FakeAllocation(&destroyed));
+  auto original = dst.rename(new FakeAllocation(&destroyed));
+  CHECK(!original.ptr());
+  auto shared = src.ptr();
+
+  auto replaced = dst.alias(src);
+  CHECK(replaced.ptr());
+  CHECK(dst.ptr() == shared);
+  CHECK_EQ(shared->aliases.get(), 1u);
+  CHECK(bool(shared->aliases));
+  replaced = nullptr;
+  CHECK_EQ(destroyed, 1u);
+
+  // aliasing again is a no-op
+  CHECK(!dst.alias(src).ptr());
+  CHECK_EQ(shared->aliases.get(), 1u);
+
+  // the writer moves to a private copy, the other one is the only holder
+  auto generation = dst.generation();
+  auto left = dst.rename(new FakeAllocation(&destroyed));
+  CHECK(left.ptr() == shared);
+  CHECK(dst.generation() == generation + 1);
+  CHECK_EQ(shared->aliases.get(), 0u);
+  CHECK(!shared->aliases);
+}
+
+static void
+test_three_holders() {
+  unsigned destroyed = 0;
+  Slot a, b, c;
+  auto _ = a.rename(new FakeAllocation(&destroyed));
+  auto shared = a.ptr();
+  auto _b = b.alias(a);
+  auto _c = c.alias(b);
+  CHECK(c.ptr() == shared);
+  CHECK_EQ(shared->aliases.get(), 2u);
+  // the owner writes first
+  auto _a = a.rename(new FakeAllocation(&destroyed));
+  CHECK_EQ(shared->aliases.get(), 1u);
+  auto _d = b.rename(new FakeAllocation(&destroyed));
+  CHECK_EQ(shared->aliases.get(), 0u);
+  // the last holder renames without underflow
+  auto last = c.rename(new FakeAllocation(&destroyed));
+  CHECK_EQ(last->aliases.get(), 0u);
+}
+
+// a destroyed resource releases its share
+static void
+test_destroy() {
+  unsigned destroyed = 0;
+  auto src = std::make_unique<Slot>();
+  Slot dst;
+  auto _ = src->rename(new FakeAllocation(&destroyed));
+  auto shared = src->ptr();
+  auto _d = dst.alias(*src);
+  CHECK_EQ(shared->aliases.get(), 1u);
+  src.reset();
+  CHECK_EQ(destroyed, 0u);
+  CHECK_EQ(shared->aliases.get(), 0u);
+  // dst is the only holder now, and can be written in place
+  CHECK(dst.ptr() == shared);
+  CHECK(!dst.ptr()->aliases);
+}
+
+static void
+test_release_from_threads() {
+  unsigned destroyed = 0;
+  Slot owner;
+  auto _ = owner.rename(new FakeAllocation(&destroyed));
+  constexpr unsigned kHolders = 64;
+  std::vector<std::unique_ptr<Slot>> holders;
+  for (unsigned i = 0; i < kHolders; i++) {
+    holders.push_back(std::make_unique<Slot>());
+    auto _h = holders.back()->alias(owner);
+  }
+  CHECK_EQ(owner.ptr()->aliases.get(), kHolders);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      for (unsigned i = t; i < kHolders; i += 4)
+        holders[i].reset();
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  CHECK_EQ(owner.ptr()->aliases.get(), 0u);
+}
+
+int
+main() {
+  test_alias_and_write();
+  test_three_holders();
+  test_destroy();
+  test_release_from_threads();
+  return 0;
+}
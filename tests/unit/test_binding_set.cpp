@@ -0,0 +1,116 @@
+#include "dxmt_binding_set.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+using namespace dxmt;
+
+struct TestBinding {
+  const void *RawPointer = nullptr;
+};
+
+template <> struct dxmt::redunant_binding_trait<TestBinding> {
+  static bool
+  is_redunant(const TestBinding &left, const TestBinding &right) {
+    return left.RawPointer == right.RawPointer;
+  }
+};
+
+static const void *
+ptr(uintptr_t value) {
+  return reinterpret_cast<const void *>(value);
+}
+
+static void
+test_pcmpneq() {
+  std::mt19937_64 rng(1);
+  const void *a[64];
+  const void *b[64];
+  for (unsigned iteration = 0; iteration < 1000; iteration++) {
+    for (unsigned i = 0; i < 64; i++) {
+      a[i] = ptr(rng() & 0xF);
+      b[i] = rng() & 1 ? a[i] : ptr(rng() & 0xF);
+      // pointers that differ only in the upper half
+      if (sizeof(void *) == 8 && (rng() & 7) == 0)
+        b[i] = ptr(uintptr_t(a[i]) ^ (uintptr_t(1) << 40));
+    }
+    for (size_t count = 0; count <= 64; count++) {
+      uint64_t expected = 0;
+      for (size_t i = 0; i < count; i++)
+        expected |= uint64_t(a[i] != b[i]) << i;
+      CHECK_EQ(bit::pcmpneq(a, b, count), expected);
+    }
+  }
+}
+
+static void
+test_changed_mask() {
+  BindingSet<TestBinding, 128> set;
+  bool replaced = false;
+  set.bind(1, {ptr(0x10)}, replaced);
+  set.bind(2, {ptr(0x20)}, replaced);
+  set.bind(70, {ptr(0x30)}, replaced);
+
+  const void *same[4] = {nullptr, ptr(0x10), ptr(0x20), nullptr};
+  CHECK_EQ(set.changed_mask(0, 4, same), 0u);
+
+  const void *changed[4] = {ptr(0x10), ptr(0x10), nullptr, ptr(0x40)};
+  CHECK_EQ(set.changed_mask(0, 4, changed), 0b1101u);
+
+  const void *high[2] = {ptr(0x30), nullptr};
+  CHECK_EQ(set.changed_mask(70, 2, high), 0u);
+
+  // an unbound slot is compared as null again
+  CHECK(set.unbind(2));
+  const void *unbound[4] = {nullptr, ptr(0x10), nullptr, nullptr};
+  CHECK_EQ(set.changed_mask(0, 4, unbound), 0u);
+  CHECK_EQ(set.changed_mask(0, 4, same), 0b0100u);
+}
+
+/**
+Time per Set*() call of `count` slots when every binding is redundant, which
+is the common case: one `bind()` per slot versus one bulk comparison.
+*/
+static void
+measure_redundant_set(size_t count) {
+  constexpr unsigned kIterations = 200000;
+  BindingSet<TestBinding, 128> set;
+  const void *pointers[128];
+  bool replaced = false;
+  for (size_t i = 0; i < count; i++) {
+    pointers[i] = ptr(0x1000 + i * 16);
+    set.bind(i, {pointers[i]}, replaced);
+  }
+
+  uint64_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned iteration = 0; iteration < kIterations; iteration++) {
+    for (size_t i = 0; i < count; i++) {
+      replaced = false;
+      set.bind(i, {pointers[i]}, replaced);
+      sink += replaced;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (unsigned iteration = 0; iteration < kIterations; iteration++) {
+    for (size_t base = 0; base < count; base += 64)
+      sink += set.changed_mask(base, std::min<size_t>(count - base, 64), pointers + base);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  CHECK_EQ(sink, 0u);
+
+  auto ns = [](auto duration) {
+    return std::chrono::duration<double, std::nano>(duration).count() / kIterations;
+  };
+  std::printf("%3zu redundant slots: %6.1fns per-slot, %6.1fns bulk\n", count, ns(t1 - t0), ns(t2 - t1));
+}
+
+int
+main() {
+  test_pcmpneq();
+  test_changed_mask();
+  for (size_t count : {1, 4, 16, 128})
+    measure_redundant_set(count);
+  return 0;
+}
@@ -0,0 +1,224 @@
+#include "dxmt_command_list.hpp"
+#include "test_utils.hpp"
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace dxmt;
+
+/**
+Stands in for the Metal encoder, calls are opaque so neither encoding is
+optimized away.
+*/
+struct StubEncoder {
+  uint64_t draws = 0;
+  uint64_t checksum = 0;
+
+  [[gnu::noinline]] void
+  drawPrimitives(uint32_t primitive, uint32_t start, uint32_t count, uint32_t instances, uint32_t base_instance) {
+    draws++;
+    checksum = checksum * 31 + primitive + start + count + instances + base_instance;
+  }
+};
+
+struct StubContext {
+  StubEncoder *encoder;
+  std::vector<int> order;
+};
+
+enum class StubRecordKind : uint32_t { Draw, Marker };
+
+struct StubDrawRecord : CommandRecord {
+  static constexpr StubRecordKind record_kind = StubRecordKind::Draw;
+  uint32_t primitive;
+  uint32_t vertex_start;
+  uint32_t vertex_count;
+  uint32_t instance_count;
+  uint32_t base_instance;
+};
+
+struct StubMarkerRecord : CommandRecord {
+  static constexpr StubRecordKind record_kind = StubRecordKind::Marker;
+  int value;
+};
+
+static unsigned destroyed_records = 0;
+
+template <> struct dxmt::CommandRecordInterpreter<StubContext> {
+  static void
+  execute(StubContext &ctx, const CommandRecord *begin, const CommandRecord *end) {
+    for (auto record = begin; record != end; record = record->next()) {
+      switch (StubRecordKind(record->kind)) {
+      case StubRecordKind::Draw: {
+        auto &draw = record->as<StubDrawRecord>();
+        ctx.encoder->drawPrimitives(
+            draw.primitive, draw.vertex_start, draw.vertex_count, draw.instance_count, draw.base_instance
+        );
+        break;
+      }
+      case StubRecordKind::Marker:
+        ctx.order.push_back(record->as<StubMarkerRecord>().value);
+        break;
+      }
+    }
+  }
+  static void
+  destroy(CommandRecord *begin, CommandRecord *end) {
+    for (auto record = begin; record != end; record = const_cast<CommandRecord *>(record->next()))
+      destroyed_records++;
+  }
+};
+
+/**
+Bump allocator in the way of the encoder CPU heap, which is reset per chunk.
+*/
+class Arena {
+public:
+  explicit Arena(size_t size) : storage_(new char[size]), size_(size) {}
+
+  void *
+  allocate(size_t size, size_t alignment) {
+    offset_ = (offset_ + alignment - 1) & ~(alignment - 1);
+    CHECK(offset_ + size <= size_);
+    void *ret = storage_.get() + offset_;
+    offset_ += size;
+    return ret;
+  }
+
+  void
+  reset() {
+    offset_ = 0;
+  }
+
+private:
+  std::unique_ptr<char[]> storage_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+static void
+emitMarker(CommandList<StubContext> &list, Arena &arena, int value) {
+  auto record = list.emitRecord<StubMarkerRecord>([&](size_t size, size_t align) {
+    return arena.allocate(size, align);
+  });
+  record->value = value;
+}
+
+static void
+emitMarkerLambda(CommandList<StubContext> &list, Arena &arena, int value) {
+  auto fn = [value](StubContext &ctx) { ctx.order.push_back(value); };
+  list.emit(std::move(fn), arena.allocate(list.calculateCommandSize<decltype(fn)>(), 16));
+}
+
+// records and lambdas keep their relative order, across block boundaries
+static void
+test_order() {
+  Arena arena(1 << 20);
+  StubEncoder encoder;
+  StubContext ctx{&encoder, {}};
+  destroyed_records = 0;
+  {
+    CommandList<StubContext> list;
+    int value = 0;
+    for (int round = 0; round < 4; round++) {
+      // enough records to overflow a block
+      for (unsigned i = 0; i < kCommandRecordBlockSize / sizeof(StubMarkerRecord) + 3; i++)
+        emitMarker(list, arena, value++);
+      emitMarkerLambda(list, arena, value++);
+    }
+    list.execute(ctx);
+    CHECK_EQ(ctx.order.size(), size_t(value));
+    for (int i = 0; i < value; i++)
+      CHECK_EQ(ctx.order[i], i);
+  }
+  // every record is handed to destroy() exactly once
+  CHECK_EQ(destroyed_records, unsigned(ctx.order.size() - 4));
+}
+
+// a record with trailing bytes is padded to the record alignment
+static void
+test_extra_bytes() {
+  Arena arena(1 << 16);
+  CommandList<StubContext> list;
+  auto first = list.emitRecord<StubMarkerRecord>([&](size_t size, size_t align) { return arena.allocate(size, align); }, 5);
+  CHECK_EQ(first->size % 8, 0u);
+  CHECK(first->size >= sizeof(StubMarkerRecord) + 5);
+  first->value = 1;
+  emitMarker(list, arena, 2);
+  StubEncoder encoder;
+  StubContext ctx{&encoder, {}};
+  list.execute(ctx);
+  CHECK_EQ(ctx.order.size(), 2u);
+  CHECK_EQ(ctx.order[1], 2);
+}
+
+static void
+measure_draws(unsigned draws_per_list) {
+  constexpr unsigned kIterations = 2000;
+  Arena arena(draws_per_list * 128 + (1 << 16));
+  StubEncoder record_encoder, lambda_encoder;
+  StubContext record_ctx{&record_encoder, {}};
+  StubContext lambda_ctx{&lambda_encoder, {}};
+  using clock = std::chrono::steady_clock;
+  clock::duration record_emit{}, record_execute{}, lambda_emit{}, lambda_execute{};
+
+  for (unsigned iteration = 0; iteration < kIterations; iteration++) {
+    {
+      arena.reset();
+      CommandList<StubContext> list;
+      auto t0 = clock::now();
+      for (unsigned i = 0; i < draws_per_list; i++) {
+        auto draw = list.emitRecord<StubDrawRecord>([&](size_t size, size_t align) {
+          return arena.allocate(size, align);
+        });
+        draw->primitive = 3;
+        draw->vertex_start = i;
+        draw->vertex_count = 6;
+        draw->instance_count = 1;
+        draw->base_instance = 0;
+      }
+      auto t1 = clock::now();
+      list.execute(record_ctx);
+      auto t2 = clock::now();
+      record_emit += t1 - t0;
+      record_execute += t2 - t1;
+    }
+    {
+      arena.reset();
+      CommandList<StubContext> list;
+      auto t0 = clock::now();
+      for (unsigned i = 0; i < draws_per_list; i++) {
+        auto fn = [primitive = 3u, start = i, count = 6u, instances = 1u, base_instance = 0u](StubContext &ctx) {
+          ctx.encoder->drawPrimitives(primitive, start, count, instances, base_instance);
+        };
+        list.emit(std::move(fn), arena.allocate(list.calculateCommandSize<decltype(fn)>(), 16));
+      }
+      auto t1 = clock::now();
+      list.execute(lambda_ctx);
+      auto t2 = clock::now();
+      lambda_emit += t1 - t0;
+      lambda_execute += t2 - t1;
+    }
+  }
+  CHECK_EQ(record_encoder.draws, lambda_encoder.draws);
+  CHECK_EQ(record_encoder.checksum, lambda_encoder.checksum);
+
+  auto ns = [&](clock::duration duration) {
+    return std::chrono::duration<double, std::nano>(duration).count() / (double(kIterations) * draws_per_list);
+  };
+  std::printf(
+      "%5u draws: emit %5.1fns record, %5.1fns lambda; execute %5.1fns record, %5.1fns lambda (per draw)\n",
+      draws_per_list, ns(record_emit), ns(lambda_emit), ns(record_execute), ns(lambda_execute)
+  );
+}
+
+int
+main() {
+  test_order();
+  test_extra_bytes();
+  for (unsigned count : {16, 256, 4096})
+    measure_draws(count);
+  return 0;
+}
@@ -0,0 +1,60 @@
+#include "test_utils.hpp"
+#include "util_memory.hpp"
+#include <cstdint>
+#include <vector>
+
+using namespace dxmt;
+
+// a tightly packed source into an aligned destination, as dynamic textures are initialized
+static void
+test_tight_source_padded_destination() {
+  constexpr size_t width = 12, rows = 3, dst_pitch = 16;
+  std::vector<uint8_t> src(width * rows);
+  for (size_t i = 0; i < src.size(); i++)
+    src[i] = uint8_t(i + 1);
+  std::vector<uint8_t> dst(dst_pitch * rows, 0xcc);
+
+  copy_rows(dst.data(), dst_pitch, src.data(), width, width, rows);
+
+  for (size_t row = 0; row < rows; row++) {
+    for (size_t x = 0; x < width; x++)
+      CHECK_EQ(dst[row * dst_pitch + x], src[row * width + x]);
+    // padding is left alone
+    for (size_t x = width; x < dst_pitch; x++)
+      CHECK_EQ(dst[row * dst_pitch + x], 0xcc);
+  }
+}
+
+static void
+test_coalesced() {
+  std::vector<uint8_t> src(64), dst(64);
+  for (size_t i = 0; i < src.size(); i++)
+    src[i] = uint8_t(i * 3);
+  copy_rows(dst.data(), 16, src.data(), 16, 16, 4);
+  CHECK(dst == src);
+}
+
+static void
+test_slices() {
+  constexpr size_t row = 4, rows = 2, slices = 2;
+  constexpr size_t src_slice = 12, dst_pitch = 8, dst_slice = 20;
+  std::vector<uint8_t> src(src_slice * slices);
+  for (size_t i = 0; i < src.size(); i++)
+    src[i] = uint8_t(i + 1);
+  std::vector<uint8_t> dst(dst_slice * slices, 0);
+
+  copy_rows(dst.data(), dst_pitch, dst_slice, src.data(), row, src_slice, row, rows, slices);
+
+  for (size_t z = 0; z < slices; z++)
+    for (size_t y = 0; y < rows; y++)
+      for (size_t x = 0; x < row; x++)
+        CHECK_EQ(dst[z * dst_slice + y * dst_pitch + x], src[z * src_slice + y * row + x]);
+}
+
+int
+main() {
+  test_tight_source_padded_destination();
+  test_coalesced();
+  test_slices();
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "dxmt_discard.hpp"
+#include "dxmt_staging_state.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+struct StubMetalTexture {
+  StubMetalTexture *parent = nullptr;
+
+  StubMetalTexture *
+  parentTexture() {
+    return parent;
+  }
+};
+
+struct StubAllocation {
+  EncoderDepKey depkey;
+};
+
+struct StubTexture {
+  StubAllocation *allocation;
+  uint32_t refcount = 0;
+
+  StubAllocation *
+  current() {
+    return allocation;
+  }
+  void
+  incRef() {
+    refcount++;
+  }
+  void
+  decRef() {
+    refcount--;
+  }
+};
+
+struct StubEncoder {
+  StubEncoder *next = nullptr;
+  EncoderDepSet tex_write;
+};
+
+using DiscardList = DiscardedTextureList<StubTexture, StubEncoder>;
+
+static void
+test_store_action_match() {
+  StubMetalTexture base, other;
+  StubMetalTexture view_a{&base}, view_b{&base};
+
+  // whole texture: the texture itself or any view of it
+  CHECK(IsDiscardedAttachment(&base, &base, (StubMetalTexture *)nullptr));
+  CHECK(IsDiscardedAttachment(&view_a, &base, (StubMetalTexture *)nullptr));
+  CHECK(!IsDiscardedAttachment(&other, &base, (StubMetalTexture *)nullptr));
+  CHECK(!IsDiscardedAttachment((StubMetalTexture *)nullptr, &base, (StubMetalTexture *)nullptr));
+
+  // a view: only that view
+  CHECK(IsDiscardedAttachment(&view_a, &base, &view_a));
+  CHECK(!IsDiscardedAttachment(&view_b, &base, &view_a));
+  CHECK(!IsDiscardedAttachment(&base, &base, &view_a));
+}
+
+static void
+test_load_action() {
+  StubAllocation allocation{EncoderDepSet::generateNewKey(1)};
+  StubAllocation renamed{EncoderDepSet::generateNewKey(2)};
+  StubAllocation unrelated{EncoderDepSet::generateNewKey(3)};
+  StubTexture texture{&allocation};
+  Rc<StubTexture> ref = &texture;
+
+  StubEncoder head;
+  StubEncoder pass;
+  head.next = &pass;
+
+  DiscardList list;
+
+  // nothing written since: load can be skipped, once
+  list.add(Rc(ref), DiscardList::kAllViews, &head);
+  CHECK(list.take(ref, 0));
+  CHECK(!list.take(ref, 0));
+
+  // a whole-texture discard covers any view, a view discard only that view
+  list.add(Rc(ref), 3, &head);
+  CHECK(!list.take(ref, 2));
+  CHECK(list.take(ref, 3));
+
+  // written by an encoder after the discard
+  StubEncoder writer;
+  writer.tex_write.add(allocation.depkey);
+  list.add(Rc(ref), DiscardList::kAllViews, &pass);
+  pass.next = &writer;
+  CHECK(!list.take(ref, 0));
+
+  // encoders writing other textures don't matter
+  StubEncoder other_writer;
+  other_writer.tex_write.add(unrelated.depkey);
+  pass.next = nullptr;
+  list.add(Rc(ref), DiscardList::kAllViews, &pass);
+  pass.next = &other_writer;
+  CHECK(list.take(ref, 0));
+
+  // renamed since the discard
+  pass.next = nullptr;
+  list.add(Rc(ref), DiscardList::kAllViews, &pass);
+  texture.allocation = &renamed;
+  CHECK(!list.take(ref, 0));
+  texture.allocation = &allocation;
+
+  list.add(Rc(ref), DiscardList::kAllViews, &pass);
+  list.clear();
+  CHECK(!list.take(ref, 0));
+  ref = nullptr;
+  CHECK_EQ(texture.refcount, 0u);
+}
+
+static void
+test_staging_discard() {
+  StagingMapState state;
+
+  // GPU still reads it: a discarded resource renames instead of waiting
+  state.useCopySource(5);
+  CHECK(state.tryMap(3, false, true) == StagingMapResult::Renamable);
+  state.discarded = true;
+  CHECK(state.tryMap(3, false, true) == StagingMapResult::Renamable);
+
+  // GPU writes it after the discard: a write map must wait for the content
+  StagingMapState written;
+  written.discarded = true;
+  written.useCopyDestination(5);
+  CHECK(!written.discarded);
+  CHECK_EQ(uint64_t(written.tryMap(3, false, true)), 2u);
+  CHECK_EQ(uint64_t(written.tryMap(3, true, false)), 2u);
+  CHECK(written.tryMap(5, true, true) == StagingMapResult::Mappable);
+
+  // discarded after the GPU write: no need to wait
+  written.discarded = true;
+  CHECK(written.tryMap(3, false, true) == StagingMapResult::Renamable);
+  // but a read still needs the GPU write
+  CHECK_EQ(uint64_t(written.tryMap(3, true, true)), 2u);
+}
+
+int
+main() {
+  test_store_action_match();
+  test_load_action();
+  test_staging_discard();
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include "dxmt_flush_workers.hpp"
+#include "test_utils.hpp"
+#include <chrono>
+#include <thread>
+
+using namespace dxmt;
+
+constexpr size_t kSlots = 8;
+
+/**
+Stands in for `MTL::CommandBuffer`: the position in queue is reserved by
+`enqueue` on the submitting thread, and the stub GPU executes committed buffers
+strictly in that order.
+*/
+struct StubCommandBuffer {
+  uint64_t seq = 0;
+  uint64_t enqueued_at = 0;
+  bool ordered = false;
+  std::atomic_uint32_t flush_count = 0;
+  std::atomic_bool committed = false;
+};
+
+struct Harness {
+  std::array<StubCommandBuffer, kSlots> buffers;
+  std::atomic_uint64_t ongoing = 0;
+  uint64_t enqueue_count = 0;
+  std::thread::id submitter;
+  uint64_t last_ordered_flush = 0;
+  std::chrono::microseconds flush_cost{0};
+  FlushWorkers<kSlots> workers;
+
+  void
+  flush(uint64_t seq) {
+    auto &buffer = buffers[seq % kSlots];
+    CHECK_EQ(buffer.seq, seq);
+    CHECK(!buffer.committed.load());
+    buffer.flush_count++;
+    if (buffer.ordered) {
+      CHECK(std::this_thread::get_id() == submitter);
+      CHECK(seq > last_ordered_flush);
+      last_ordered_flush = seq;
+    }
+    auto until = std::chrono::steady_clock::now() + flush_cost;
+    while (std::chrono::steady_clock::now() < until) {
+    }
+    buffer.committed.store(true, std::memory_order_release);
+  }
+
+  /**
+  Submits `count` chunks, every `ordered_every`-th being ordered, and returns
+  once the last one has been executed by the stub GPU.
+  */
+  void
+  run(uint32_t worker_count, uint64_t count, uint64_t ordered_every) {
+    submitter = std::this_thread::get_id();
+    workers.start(worker_count, [this](uint64_t seq) { flush(seq); });
+
+    dxmt::thread finish([this, count]() {
+      uint64_t executed = 0;
+      for (uint64_t seq = 1; seq <= count; seq++) {
+        CHECK(workers.waitCommitted(seq));
+        auto &buffer = buffers[seq % kSlots];
+        CHECK_EQ(buffer.seq, seq);
+        CHECK(buffer.committed.load(std::memory_order_acquire));
+        CHECK_EQ(buffer.flush_count.load(), 1u);
+        // a committed buffer can't run before the ones enqueued earlier
+        CHECK(buffer.enqueued_at > executed);
+        executed = buffer.enqueued_at;
+        ongoing.fetch_sub(1, std::memory_order_release);
+        ongoing.notify_one();
+      }
+    });
+
+    for (uint64_t seq = 1; seq <= count; seq++) {
+      // same throttling as CommandQueue::CommitCurrentChunk
+      ongoing.wait(kSlots - 1, std::memory_order_acquire);
+      ongoing.fetch_add(1, std::memory_order_relaxed);
+      auto &buffer = buffers[seq % kSlots];
+      buffer.seq = seq;
+      buffer.enqueued_at = ++enqueue_count;
+      buffer.ordered = ordered_every && seq % ordered_every == 0;
+      buffer.flush_count = 0;
+      buffer.committed = false;
+      workers.submit(seq, buffer.ordered);
+    }
+
+    finish.join();
+    workers.stop();
+  }
+};
+
+static void
+test_ordering(uint32_t worker_count) {
+  Harness harness;
+  harness.run(worker_count, 1000, 7);
+}
+
+static void
+test_stop_while_waiting() {
+  FlushWorkers<kSlots> workers;
+  workers.start(2, [](uint64_t) {});
+  std::atomic_bool returned = false;
+  dxmt::thread waiter([&]() {
+    CHECK(!workers.waitCommitted(1));
+    returned = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  CHECK(!returned.load());
+  workers.stop();
+  waiter.join();
+  CHECK(returned.load());
+}
+
+static void
+measure_scaling() {
+  for (uint32_t worker_count : {0u, 1u, 2u, 4u}) {
+    Harness harness;
+    harness.flush_cost = std::chrono::microseconds(200);
+    auto t0 = std::chrono::steady_clock::now();
+    harness.run(worker_count, 256, 0);
+    auto t1 = std::chrono::steady_clock::now();
+    std::printf(
+        "%u worker(s): 256 chunks of 200us in %.1fms\n", worker_count,
+        std::chrono::duration<double, std::milli>(t1 - t0).count()
+    );
+  }
+}
+
+int
+main() {
+  for (uint32_t worker_count = 0; worker_count <= 4; worker_count++)
+    test_ordering(worker_count);
+  test_stop_while_waiting();
+  measure_scaling();
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include "dxmt_heap_pool.hpp"
+#include "test_utils.hpp"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+using namespace dxmt;
+
+static void
+test_distinct_heaps() {
+  CpuHeapPool pool;
+  pool.init(3, 64);
+  CHECK_EQ(pool.size(), 3u);
+  std::set<char *> heaps;
+  for (unsigned i = 0; i < 3; i++)
+    heaps.insert(pool.acquire());
+  CHECK_EQ(heaps.size(), 3u);
+  for (auto heap : heaps) {
+    // each heap is writable over its whole size
+    for (unsigned i = 0; i < 64; i++)
+      heap[i] = char(i);
+    pool.release(heap);
+  }
+  // released heaps are handed out again, no new allocation
+  for (unsigned i = 0; i < 3; i++)
+    CHECK(heaps.count(pool.acquire()));
+}
+
+// the preparing thread waits for a flush to release a heap
+static void
+test_acquire_blocks() {
+  CpuHeapPool pool;
+  pool.init(1, 16);
+  char *held = pool.acquire();
+  std::atomic_bool released = false;
+  std::thread flusher([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    released.store(true);
+    pool.release(held);
+  });
+  char *next = pool.acquire();
+  CHECK(released.load());
+  CHECK_EQ(next, held);
+  flusher.join();
+}
+
+// chunks prepared and flushed on other threads never share a heap
+static void
+test_concurrent_chunks() {
+  constexpr unsigned kWorkers = 4, kChunks = 2000;
+  CpuHeapPool pool;
+  pool.init(kWorkers + 1, 16);
+  std::vector<char *> heaps;
+  for (unsigned i = 0; i < kWorkers + 1; i++)
+    heaps.push_back(pool.acquire());
+  for (auto heap : heaps) {
+    heap[0] = 0;
+    pool.release(heap);
+  }
+  std::atomic_uint32_t in_use = 0, max_in_use = 0;
+  std::atomic_uint64_t next_chunk = 0;
+  std::vector<std::thread> workers;
+  for (unsigned w = 0; w < kWorkers; w++) {
+    workers.emplace_back([&]() {
+      while (next_chunk.fetch_add(1) < kChunks) {
+        char *heap = pool.acquire();
+        CHECK(heap);
+        // a heap shared by two chunks would see the other's mark
+        CHECK_EQ(heap[0], 0);
+        heap[0] = 1;
+        auto count = ++in_use;
+        auto max = max_in_use.load();
+        while (count > max && !max_in_use.compare_exchange_weak(max, count)) {
+        }
+        std::this_thread::yield();
+        in_use--;
+        heap[0] = 0;
+        pool.release(heap);
+      }
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+  CHECK(max_in_use.load() <= kWorkers + 1);
+}
+
+static void
+test_stop_wakes_waiter() {
+  CpuHeapPool pool;
+  pool.init(1, 16);
+  pool.acquire();
+  std::thread waiter([&]() { CHECK(pool.acquire() == nullptr); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  pool.stop();
+  waiter.join();
+}
+
+int
+main() {
+  test_distinct_heaps();
+  test_acquire_blocks();
+  test_concurrent_chunks();
+  test_stop_wakes_waiter();
+  return 0;
+}
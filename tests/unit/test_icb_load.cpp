@@ -0,0 +1,31 @@
+#include "dxbc_icb_load.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt::dxbc;
+
+static void
+test_constant_index() {
+  CHECK(GetICBLoad(true, 0, 4) == ICBLoad::Element);
+  CHECK(GetICBLoad(true, 3, 4) == ICBLoad::Element);
+  // out of range reads zero instead of whatever follows in memory
+  CHECK(GetICBLoad(true, 4, 4) == ICBLoad::Zero);
+  CHECK(GetICBLoad(true, 0xFFFFFFFF, 4) == ICBLoad::Zero);
+  // folded regardless of the buffer size
+  CHECK(GetICBLoad(true, 100, 1024) == ICBLoad::Element);
+  CHECK(GetICBLoad(true, 1024, 1024) == ICBLoad::Zero);
+}
+
+static void
+test_dynamic_index() {
+  CHECK(GetICBLoad(false, 0, 1) == ICBLoad::SelectChain);
+  CHECK(GetICBLoad(false, 0, kMaxSelectChainICBSize) == ICBLoad::SelectChain);
+  CHECK(GetICBLoad(false, 0, kMaxSelectChainICBSize + 1) == ICBLoad::Memory);
+  CHECK(GetICBLoad(false, 0, 4096) == ICBLoad::Memory);
+}
+
+int
+main() {
+  test_constant_index();
+  test_dynamic_index();
+  return 0;
+}
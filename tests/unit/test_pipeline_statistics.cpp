@@ -0,0 +1,91 @@
+#include "d3d11_pipeline_statistics.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+static void
+test_primitive_count() {
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST, 7), 7);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, 7), 3);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP, 7), 6);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP, 1), 0);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 7), 2);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, 7), 5);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, 2), 0);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ, 8), 2);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ, 8), 5);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ, 12), 2);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ, 8), 2);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ, 5), 0);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST, 9), 3);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_32_CONTROL_POINT_PATCHLIST, 64), 2);
+  CHECK_EQ(GetPrimitiveCount(D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED, 9), 0);
+}
+
+static void
+test_draw() {
+  PipelineStatisticsCounter counter;
+  counter.draw(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 6, 3, false, false);
+  CHECK_EQ(counter.data.IAVertices, 18);
+  CHECK_EQ(counter.data.IAPrimitives, 6);
+  CHECK_EQ(counter.data.VSInvocations, 18);
+  CHECK_EQ(counter.data.CInvocations, 6);
+  CHECK_EQ(counter.data.CPrimitives, 6);
+  CHECK_EQ(counter.data.GSInvocations, 0);
+  CHECK_EQ(counter.data.HSInvocations, 0);
+  // never counted
+  CHECK_EQ(counter.data.GSPrimitives, 0);
+  CHECK_EQ(counter.data.DSInvocations, 0);
+  CHECK_EQ(counter.data.PSInvocations, 0);
+}
+
+static void
+test_geometry_and_tessellation() {
+  PipelineStatisticsCounter counter;
+  counter.draw(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 6, 1, true, false);
+  CHECK_EQ(counter.data.GSInvocations, 2);
+  counter.draw(D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST, 9, 2, false, true);
+  CHECK_EQ(counter.data.HSInvocations, 6);
+  CHECK_EQ(counter.data.IAPrimitives, 8);
+  // clipper runs after GS/DS, its input is unknown on CPU
+  CHECK_EQ(counter.data.CInvocations, 0);
+  CHECK_EQ(counter.data.CPrimitives, 0);
+}
+
+static void
+test_dispatch() {
+  PipelineStatisticsCounter counter;
+  counter.dispatch(4 * 2 * 1, 64);
+  counter.dispatch(1, 1);
+  CHECK_EQ(counter.data.CSInvocations, 513);
+}
+
+static void
+test_indirect_and_merge() {
+  PipelineStatisticsCounter immediate, deferred;
+  immediate.draw(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST, 5, 1, false, false);
+  immediate.indirect();
+  deferred.draw(D3D11_PRIMITIVE_TOPOLOGY_LINELIST, 4, 1, false, false);
+  deferred.dispatch(2, 32);
+  deferred.indirect();
+  deferred.indirect();
+  // indirect work is tallied, but contributes nothing to the counts
+  CHECK_EQ(immediate.data.IAVertices, 5);
+  CHECK_EQ(immediate.uncounted_indirect_calls, 1);
+
+  immediate.merge(deferred);
+  CHECK_EQ(immediate.data.IAVertices, 9);
+  CHECK_EQ(immediate.data.IAPrimitives, 7);
+  CHECK_EQ(immediate.data.CSInvocations, 64);
+  CHECK_EQ(immediate.uncounted_indirect_calls, 3);
+}
+
+int
+main() {
+  test_primitive_count();
+  test_draw();
+  test_geometry_and_tessellation();
+  test_dispatch();
+  test_indirect_and_merge();
+  return 0;
+}
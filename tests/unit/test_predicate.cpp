@@ -0,0 +1,142 @@
+#include "dxmt_visibility_result.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+enum class DrawKind { Draw, DrawIndexed, Indirect, Tessellation, Geometry };
+
+/**
+Stands in for the render encoder, and follows what the command interpreter
+does with each result.
+*/
+struct StubEncoder {
+  VisibilityPredicate predicate;
+  uint64_t seq_id = 1;
+  uint64_t encoder_begin = 0;
+  unsigned draws = 0;
+  unsigned marshaled_draws = 0;
+  bool unsupported_predication = false;
+
+  void
+  draw(DrawKind kind) {
+    bool can_marshal = kind == DrawKind::Draw || kind == DrawKind::DrawIndexed;
+    switch (predicate.evaluate(seq_id, encoder_begin, can_marshal)) {
+    case PredicateResult::Skip:
+      return;
+    case PredicateResult::Marshal:
+      CHECK(can_marshal);
+      marshaled_draws++;
+      return;
+    case PredicateResult::Unsupported:
+      unsupported_predication = true;
+      [[fallthrough]];
+    case PredicateResult::Draw:
+      draws++;
+      return;
+    }
+  }
+};
+
+constexpr DrawKind kAllKinds[] = {
+    DrawKind::Draw, DrawKind::DrawIndexed, DrawKind::Indirect, DrawKind::Tessellation, DrawKind::Geometry
+};
+
+static Rc<VisibilityResultQuery>
+makeResolvedQuery(uint64_t value) {
+  Rc<VisibilityResultQuery> query = new VisibilityResultQuery();
+  query->begin(1, 0);
+  query->end(1, 1);
+  std::vector<uint64_t> prefix_sum;
+  ResolveVisibilityResults(1, &value, 1, {query}, prefix_sum);
+  return query;
+}
+
+static void
+test_no_predicate() {
+  StubEncoder encoder;
+  for (auto kind : kAllKinds)
+    encoder.draw(kind);
+  CHECK_EQ(encoder.draws, 5u);
+  CHECK(!encoder.unsupported_predication);
+}
+
+// a resolved predicate skips every kind of draw on CPU
+static void
+test_resolved() {
+  for (bool predicate_value : {false, true}) {
+    StubEncoder encoder;
+    encoder.predicate.set(makeResolvedQuery(0), predicate_value);
+    for (auto kind : kAllKinds)
+      encoder.draw(kind);
+    // zero samples passed: skipped when the predicate value is false
+    CHECK_EQ(encoder.draws, predicate_value ? 5u : 0u);
+    CHECK(!encoder.unsupported_predication);
+  }
+  StubEncoder encoder;
+  encoder.predicate.set(makeResolvedQuery(42), true);
+  for (auto kind : kAllKinds)
+    encoder.draw(kind);
+  CHECK_EQ(encoder.draws, 0u);
+}
+
+// results written by an earlier encoder of the chunk: plain draws are marshaled
+static void
+test_marshal() {
+  StubEncoder encoder;
+  Rc<VisibilityResultQuery> query = new VisibilityResultQuery();
+  query->begin(1, 2);
+  query->end(1, 4);
+  encoder.predicate.set(Rc(query), false);
+  encoder.encoder_begin = 4;
+  encoder.draw(DrawKind::Draw);
+  encoder.draw(DrawKind::DrawIndexed);
+  CHECK_EQ(encoder.marshaled_draws, 2u);
+  CHECK_EQ(encoder.predicate.resultBegin(), 2u);
+  CHECK_EQ(encoder.predicate.resultEnd(), 4u);
+  CHECK(!encoder.unsupported_predication);
+
+  // the rest can't be zeroed on GPU, so they are drawn and flagged
+  for (auto kind : {DrawKind::Indirect, DrawKind::Tessellation, DrawKind::Geometry}) {
+    encoder.unsupported_predication = false;
+    encoder.draw(kind);
+    CHECK(encoder.unsupported_predication);
+  }
+  CHECK_EQ(encoder.draws, 3u);
+}
+
+static void
+test_unsupported() {
+  // written by the current encoder, not visible to GPU yet
+  StubEncoder encoder;
+  Rc<VisibilityResultQuery> query = new VisibilityResultQuery();
+  query->begin(1, 2);
+  query->end(1, 4);
+  encoder.predicate.set(Rc(query), false);
+  encoder.encoder_begin = 3;
+  encoder.draw(DrawKind::Draw);
+  CHECK_EQ(encoder.draws, 1u);
+  CHECK(encoder.unsupported_predication);
+
+  // ended in a previous chunk, but not resolved yet
+  StubEncoder later;
+  later.seq_id = 2;
+  later.predicate.set(Rc(query), false);
+  later.draw(DrawKind::DrawIndexed);
+  CHECK_EQ(later.draws, 1u);
+  CHECK(later.unsupported_predication);
+
+  // reset drops the predicate
+  later.unsupported_predication = false;
+  later.predicate.reset();
+  later.draw(DrawKind::Geometry);
+  CHECK(!later.unsupported_predication);
+}
+
+int
+main() {
+  test_no_predicate();
+  test_resolved();
+  test_marshal();
+  test_unsupported();
+  return 0;
+}
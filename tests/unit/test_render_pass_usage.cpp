@@ -0,0 +1,57 @@
+#include "d3d11_render_pass_usage.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+struct FakeTexture {
+  int id;
+};
+
+static void
+test_fresh_pass() {
+  FakeTexture texture{0};
+  RenderPassUsage<FakeTexture> usage;
+  usage.begin(false);
+  CHECK(usage.canHoistBlit(&texture, false));
+  // rendered to in this pass
+  CHECK(!usage.canHoistBlit(&texture, true));
+}
+
+// earlier draws in the pass must not observe the new mipmaps
+static void
+test_sampled_in_pass() {
+  FakeTexture sampled{0}, other{1};
+  RenderPassUsage<FakeTexture> usage;
+  usage.begin(false);
+  usage.sample(&sampled);
+  usage.sample(&sampled);
+  usage.sample(nullptr);
+  CHECK(!usage.canHoistBlit(&sampled, false));
+  CHECK(usage.canHoistBlit(&other, false));
+  // a new pass starts clean
+  usage.begin(false);
+  CHECK(usage.canHoistBlit(&sampled, false));
+}
+
+static void
+test_uav_bound() {
+  FakeTexture texture{0};
+  RenderPassUsage<FakeTexture> usage;
+  // bound when the pass started
+  usage.begin(true);
+  CHECK(!usage.canHoistBlit(&texture, false));
+  // bound later in the pass, stays until the pass ends
+  usage.begin(false);
+  usage.bindUAV();
+  CHECK(!usage.canHoistBlit(&texture, false));
+  usage.begin(false);
+  CHECK(usage.canHoistBlit(&texture, false));
+}
+
+int
+main() {
+  test_fresh_pass();
+  test_sampled_in_pass();
+  test_uav_bound();
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "d3d11_sampler_specialization.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+constexpr uint32_t kDraws = SamplerSpecialization::kPromoteDraws;
+
+static void
+test_promotion() {
+  SamplerSpecialization specialization;
+  // the first draw only sets the candidate
+  for (uint32_t i = 0; i < kDraws; i++)
+    CHECK_EQ(specialization.draw(1, 0b11), 0);
+  CHECK_EQ(specialization.draw(1, 0b11), 0b11);
+  CHECK_EQ(specialization.draw(1, 0b11), 0b11);
+  // a different set of zero bias samplers starts over
+  CHECK_EQ(specialization.draw(1, 0b01), 0);
+  for (uint32_t i = 1; i < kDraws; i++)
+    CHECK_EQ(specialization.draw(1, 0b01), 0);
+  CHECK_EQ(specialization.draw(1, 0b01), 0b01);
+}
+
+// draws are counted per pixel shader, so alternating shaders still promote
+static void
+test_promotion_per_shader() {
+  SamplerSpecialization specialization;
+  for (uint32_t i = 0; i < kDraws; i++) {
+    CHECK_EQ(specialization.draw(1, 0b01), 0);
+    CHECK_EQ(specialization.draw(2, 0b10), 0);
+  }
+  CHECK_EQ(specialization.draw(1, 0b01), 0b01);
+  CHECK_EQ(specialization.draw(2, 0b10), 0b10);
+}
+
+static void
+test_fallback() {
+  // not specialized yet
+  CHECK(SamplerSpecialization::compatible(0, 0b11, 0));
+  CHECK(SamplerSpecialization::compatible(0, 0, 0));
+  // a specialization became due
+  CHECK(!SamplerSpecialization::compatible(0, 0b11, 0b11));
+  CHECK(SamplerSpecialization::compatible(0b11, 0b11, 0b11));
+  // a biased sampler is bound to a specialized slot
+  CHECK(!SamplerSpecialization::compatible(0b11, 0b01, 0));
+  CHECK(!SamplerSpecialization::compatible(0b11, 0b01, 0b01));
+  // more samplers lost their bias, the specialization still holds until due
+  CHECK(SamplerSpecialization::compatible(0b01, 0b11, 0));
+}
+
+// after a fallback, the biased sampler resets the count for that shader
+static void
+test_fallback_draws() {
+  SamplerSpecialization specialization;
+  for (uint32_t i = 0; i < kDraws; i++)
+    specialization.draw(1, 0b11);
+  uint16_t pipeline_mask = specialization.draw(1, 0b11);
+  CHECK_EQ(pipeline_mask, 0b11);
+  uint16_t due = specialization.draw(1, 0b01);
+  CHECK_EQ(due, 0);
+  CHECK(!SamplerSpecialization::compatible(pipeline_mask, 0b01, due));
+  CHECK(SamplerSpecialization::compatible(0, 0b01, due));
+}
+
+int
+main() {
+  test_promotion();
+  test_promotion_per_shader();
+  test_fallback();
+  test_fallback_draws();
+  return 0;
+}
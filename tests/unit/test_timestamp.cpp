@@ -0,0 +1,111 @@
+#include "dxmt_timestamp_query.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+struct FakeSource {
+  double start;
+  double end;
+
+  double
+  GPUStartTime() {
+    return start;
+  }
+  double
+  GPUEndTime() {
+    return end;
+  }
+};
+
+static uint64_t
+valueOf(Rc<TimestampQuery> const &query) {
+  uint64_t value = 0;
+  CHECK(query->getValue(&value));
+  return value;
+}
+
+static void
+test_start_and_end() {
+  TimestampReadback readback;
+  Rc<TimestampQuery> at_start = new TimestampQuery();
+  Rc<TimestampQuery> at_end = new TimestampQuery();
+  uint64_t value = 0;
+  readback.record(Rc(at_start), true);
+  readback.record(Rc(at_end), false);
+  CHECK(!at_start->getValue(&value));
+
+  FakeSource source{1.0, 1.5};
+  CHECK(readback.resolve(source));
+  CHECK_EQ(valueOf(at_start), 1'000'000'000ull);
+  CHECK_EQ(valueOf(at_end), 1'500'000'000ull);
+}
+
+// work after a timestamp lands in the next chunk
+static void
+test_delta_across_chunks() {
+  TimestampReadback chunk1, chunk2;
+  Rc<TimestampQuery> before = new TimestampQuery();
+  Rc<TimestampQuery> after = new TimestampQuery();
+  chunk1.record(Rc(before), false);
+  chunk2.record(Rc(after), false);
+
+  FakeSource source1{2.0, 2.25};
+  FakeSource source2{2.25, 2.75};
+  CHECK(chunk1.resolve(source1));
+  CHECK(chunk2.resolve(source2));
+  CHECK_EQ(valueOf(after) - valueOf(before), 500'000'000ull);
+}
+
+// consecutive timestamps stay in the chunk and read the same time
+static void
+test_consecutive() {
+  TimestampReadback readback;
+  Rc<TimestampQuery> first = new TimestampQuery();
+  Rc<TimestampQuery> second = new TimestampQuery();
+  readback.record(Rc(first), false);
+  readback.record(Rc(second), false);
+  FakeSource source{1.0, 1.25};
+  CHECK(readback.resolve(source));
+  CHECK_EQ(valueOf(first), 1'250'000'000ull);
+  CHECK_EQ(valueOf(second), valueOf(first));
+}
+
+static void
+test_invalid_source() {
+  TimestampReadback readback;
+  Rc<TimestampQuery> first = new TimestampQuery();
+  readback.record(Rc(first), false);
+  FakeSource valid{3.0, 4.0};
+  CHECK(readback.resolve(valid));
+
+  // failed command buffers report zero, or end before start
+  for (auto invalid : {FakeSource{0.0, 0.0}, FakeSource{5.0, 4.0}}) {
+    Rc<TimestampQuery> query = new TimestampQuery();
+    readback.record(Rc(query), false);
+    CHECK(!readback.resolve(invalid));
+    // still resolved, so GetData() doesn't spin forever
+    CHECK_EQ(valueOf(query), valueOf(first));
+  }
+}
+
+static void
+test_reset() {
+  TimestampReadback readback;
+  Rc<TimestampQuery> dropped = new TimestampQuery();
+  readback.record(Rc(dropped), true);
+  readback.reset();
+  FakeSource source{1.0, 2.0};
+  CHECK(readback.resolve(source));
+  uint64_t value = 0;
+  CHECK(!dropped->getValue(&value));
+}
+
+int
+main() {
+  test_start_and_end();
+  test_delta_across_chunks();
+  test_consecutive();
+  test_invalid_source();
+  test_reset();
+  return 0;
+}
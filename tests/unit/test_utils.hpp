@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/**
+Minimal checks for unit tests, which are plain executables returning non-zero
+on failure.
+*/
+
+#define CHECK(expr)                                                                                                    \
+  do {                                                                                                                 \
+    if (!(expr)) {                                                                                                     \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);                                    \
+      std::exit(1);                                                                                                    \
+    }                                                                                                                  \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                                                                 \
+  do {                                                                                                                 \
+    auto a_ = (a);                                                                                                     \
+    auto b_ = static_cast<decltype(a_)>(b);                                                                            \
+    if (!(a_ == b_)) {                                                                                                 \
+      std::fprintf(                                                                                                    \
+          stderr, "%s:%d: check failed: %s == %s (%llu vs %llu)\n", __FILE__, __LINE__, #a, #b,                        \
+          (unsigned long long)a_, (unsigned long long)b_                                                               \
+      );                                                                                                               \
+      std::exit(1);                                                                                                    \
+    }                                                                                                                  \
+  } while (0)
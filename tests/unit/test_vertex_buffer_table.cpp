@@ -0,0 +1,126 @@
+#include "dxmt_vertex_buffer_table.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+enum class Kind { Ordinary, Tessellation };
+
+/**
+Mirrors the binding state of `ArgumentEncodingContext`: binds mark a slot
+dirty, renames bump the generation of the bound buffer, and encoding a table
+clears the dirty bits of its slots.
+*/
+struct Bindings {
+  std::array<uint64_t, 32> generation{};
+  uint32_t dirty_mask = ~0u;
+  VertexBufferTableCache<Kind, 32> cache;
+  uint64_t next_offset = 0;
+  unsigned tables_written = 0;
+
+  uint64_t
+  encode(Kind kind, uint32_t slot_mask, uint64_t encoder_id) {
+    auto fn = [this](unsigned slot) { return generation[slot]; };
+    if (cache.reusable(kind, slot_mask, encoder_id, dirty_mask, fn))
+      return cache.heapOffset();
+    uint64_t offset = next_offset;
+    next_offset += 16 * __builtin_popcount(slot_mask);
+    tables_written++;
+    cache.store(kind, slot_mask, encoder_id, offset, fn);
+    dirty_mask &= ~slot_mask;
+    return offset;
+  }
+};
+
+static void
+test_reuse_in_same_encoder() {
+  Bindings state;
+  auto first = state.encode(Kind::Ordinary, 0b101, 1);
+  CHECK_EQ(state.encode(Kind::Ordinary, 0b101, 1), first);
+  CHECK_EQ(state.tables_written, 1u);
+}
+
+static void
+test_first_encode_is_dirty() {
+  Bindings state;
+  // nothing encoded yet, even with a clean dirty mask
+  state.dirty_mask = 0;
+  state.encode(Kind::Ordinary, 0b1, 1);
+  CHECK_EQ(state.tables_written, 1u);
+}
+
+static void
+test_dirty_slot() {
+  Bindings state;
+  state.encode(Kind::Ordinary, 0b011, 1);
+  // a rebind outside the table doesn't matter
+  state.dirty_mask |= 0b100;
+  state.encode(Kind::Ordinary, 0b011, 1);
+  CHECK_EQ(state.tables_written, 1u);
+  state.dirty_mask |= 0b010;
+  state.encode(Kind::Ordinary, 0b011, 1);
+  CHECK_EQ(state.tables_written, 2u);
+  // the rebuilt table clears the bit again
+  state.encode(Kind::Ordinary, 0b011, 1);
+  CHECK_EQ(state.tables_written, 2u);
+  CHECK_EQ(state.dirty_mask & 0b111u, 0b100u);
+}
+
+static void
+test_rename() {
+  Bindings state;
+  state.generation[3] = 7;
+  state.encode(Kind::Ordinary, 0b1000, 1);
+  state.generation[3]++;
+  state.encode(Kind::Ordinary, 0b1000, 1);
+  CHECK_EQ(state.tables_written, 2u);
+  // renaming a buffer outside the table doesn't matter
+  state.generation[4]++;
+  state.encode(Kind::Ordinary, 0b1000, 1);
+  CHECK_EQ(state.tables_written, 2u);
+}
+
+static void
+test_encoder_kind_and_mask() {
+  Bindings state;
+  state.encode(Kind::Ordinary, 0b1, 1);
+  // residency is per encoder
+  state.encode(Kind::Ordinary, 0b1, 2);
+  CHECK_EQ(state.tables_written, 2u);
+  // the table is bound to a different stage
+  state.encode(Kind::Tessellation, 0b1, 2);
+  CHECK_EQ(state.tables_written, 3u);
+  // a different layout of the same slots
+  state.encode(Kind::Tessellation, 0b11, 2);
+  CHECK_EQ(state.tables_written, 4u);
+  state.encode(Kind::Tessellation, 0b1, 2);
+  CHECK_EQ(state.tables_written, 5u);
+  // highest slot is compared too
+  state.encode(Kind::Tessellation, 1u << 31, 2);
+  state.generation[31]++;
+  state.encode(Kind::Tessellation, 1u << 31, 2);
+  CHECK_EQ(state.tables_written, 7u);
+}
+
+// draws through stage-in don't touch the table or the dirty bits in between
+static void
+test_stage_in_interleaved() {
+  Bindings state;
+  auto table = state.encode(Kind::Ordinary, 0b11, 1);
+  // stage-in draw with unchanged bindings, then a table draw again
+  CHECK_EQ(state.encode(Kind::Ordinary, 0b11, 1), table);
+  // a rebind while stage-in was used is still seen by the next table draw
+  state.dirty_mask |= 0b01;
+  CHECK(state.encode(Kind::Ordinary, 0b11, 1) != table);
+  CHECK_EQ(state.tables_written, 2u);
+}
+
+int
+main() {
+  test_reuse_in_same_encoder();
+  test_first_encode_is_dirty();
+  test_dirty_slot();
+  test_rename();
+  test_encoder_kind_and_mask();
+  test_stage_in_interleaved();
+  return 0;
+}
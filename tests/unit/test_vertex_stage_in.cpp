@@ -0,0 +1,174 @@
+#include "d3d11_vertex_stage_in.hpp"
+#include "dxmt_binding_set.hpp"
+#include "test_utils.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace dxmt;
+
+struct TestElement {
+  uint32_t Index;
+  uint32_t Offset;
+  uint32_t StepFunction;
+  uint32_t InstanceStepRate;
+};
+
+struct TestVertexBuffer {
+  const void *RawPointer = nullptr;
+  uint32_t Stride = 0;
+  uint32_t Offset = 0;
+};
+
+template <> struct dxmt::redunant_binding_trait<TestVertexBuffer> {
+  static bool
+  is_redunant(const TestVertexBuffer &left, const TestVertexBuffer &right) {
+    return left.RawPointer == right.RawPointer && left.Stride == right.Stride && left.Offset == right.Offset;
+  }
+};
+
+using TestVertexBuffers = BindingSet<TestVertexBuffer, 16>;
+
+static void
+bind(TestVertexBuffers &buffers, unsigned slot, uint32_t stride, uint32_t offset) {
+  bool replaced = false;
+  buffers.bind(slot, {reinterpret_cast<const void *>(uintptr_t(slot + 1) << 4), stride, offset}, replaced);
+}
+
+static bool
+layout_compatible(uint32_t slot_mask, std::vector<TestElement> elements) {
+  return IsStageInCompatibleLayout(slot_mask, elements.data(), elements.size());
+}
+
+static void
+test_layout_offset() {
+  CHECK(layout_compatible(0b1, {{0, 0, 0, 0}, {1, 12, 0, 0}}));
+  CHECK(!layout_compatible(0b1, {{0, 0, 0, 0}, {1, 6, 0, 0}}));
+  CHECK(!layout_compatible(0b1, {{31, 0, 0, 0}}));
+}
+
+// MTLVertexStepFunctionConstant ignores the base instance
+static void
+test_layout_step_rate() {
+  CHECK(layout_compatible(0b1, {{0, 0, 1, 1}}));
+  CHECK(layout_compatible(0b1, {{0, 0, 1, 4}}));
+  CHECK(!layout_compatible(0b1, {{0, 0, 1, 0}}));
+  // per-vertex data has no step rate
+  CHECK(layout_compatible(0b1, {{0, 0, 0, 0}}));
+}
+
+// slot 15 would be bound at buffer index 16, taken by the vertex buffer table
+static void
+test_layout_slot_count() {
+  CHECK(layout_compatible(1u << 14, {{0, 0, 0, 0}}));
+  CHECK(!layout_compatible(1u << 15, {{0, 0, 0, 0}}));
+  CHECK(!layout_compatible(0b1 | (1u << 15), {{0, 0, 0, 0}}));
+}
+
+static void
+test_buffer_alignment() {
+  TestVertexBuffers buffers;
+  bind(buffers, 0, 16, 0);
+  bind(buffers, 1, 12, 4);
+  CHECK(AreStageInBuffersApplicable(0b11, buffers));
+  bind(buffers, 1, 6, 4);
+  CHECK(!AreStageInBuffersApplicable(0b11, buffers));
+  bind(buffers, 1, 12, 2);
+  CHECK(!AreStageInBuffersApplicable(0b11, buffers));
+  // a zero stride can't be expressed by a MTLVertexBufferLayoutDescriptor
+  bind(buffers, 1, 0, 0);
+  CHECK(!AreStageInBuffersApplicable(0b11, buffers));
+  // slots outside of the layout don't matter
+  CHECK(AreStageInBuffersApplicable(0b01, buffers));
+}
+
+static void
+test_buffer_unbound() {
+  TestVertexBuffers buffers;
+  bind(buffers, 0, 16, 0);
+  CHECK(!AreStageInBuffersApplicable(0b101, buffers));
+  bind(buffers, 2, 16, 0);
+  CHECK(AreStageInBuffersApplicable(0b101, buffers));
+  buffers.unbind(2);
+  CHECK(!AreStageInBuffersApplicable(0b101, buffers));
+}
+
+static void
+test_geometry_shader_bound() {
+  TestVertexBuffers buffers;
+  bind(buffers, 0, 16, 0);
+  CHECK(IsStageInApplicable(false, true, 0b1, buffers));
+  CHECK(!IsStageInApplicable(true, true, 0b1, buffers));
+  CHECK(!IsStageInApplicable(false, false, 0b1, buffers));
+}
+
+static void
+test_binding_tracked() {
+  VertexBufferBinding binding;
+  // nothing to prove without an input layout
+  CHECK(!binding.allBound());
+  binding.setInputLayout(true, 0b101);
+  CHECK(!binding.allBound());
+  binding.setBound(0, true);
+  binding.setBound(2, true);
+  CHECK(binding.allBound());
+  binding.setBound(1, false);
+  CHECK(binding.allBound());
+  binding.setBound(2, false);
+  CHECK(!binding.allBound());
+  // a layout reading fewer slots
+  binding.setInputLayout(true, 0b001);
+  CHECK(binding.allBound());
+  binding.setInputLayout(false, 0);
+  CHECK(!binding.allBound());
+  // a layout reading no buffer at all
+  binding.setInputLayout(true, 0);
+  CHECK(binding.allBound());
+}
+
+// the tracked result agrees with scanning the slots after every change
+static void
+test_binding_matches_scan() {
+  std::mt19937 rng(1);
+  TestVertexBuffers buffers;
+  VertexBufferBinding binding;
+  bool has_layout = false;
+  uint32_t slot_mask = 0;
+  for (unsigned iteration = 0; iteration < 10000; iteration++) {
+    unsigned slot = rng() % 16;
+    switch (rng() % 3) {
+    case 0:
+      has_layout = rng() % 4 != 0;
+      slot_mask = has_layout ? rng() & 0xFFFF : 0;
+      binding.setInputLayout(has_layout, slot_mask);
+      break;
+    case 1:
+      bind(buffers, slot, 16, 0);
+      binding.setBound(slot, true);
+      break;
+    case 2:
+      buffers.unbind(slot);
+      binding.setBound(slot, false);
+      break;
+    }
+    bool scanned = has_layout;
+    for (unsigned i = 0; i < 16; i++) {
+      if ((slot_mask & (1u << i)) && !buffers.test_bound(i))
+        scanned = false;
+    }
+    CHECK_EQ(binding.allBound(), scanned);
+  }
+}
+
+int
+main() {
+  test_layout_offset();
+  test_layout_step_rate();
+  test_layout_slot_count();
+  test_buffer_alignment();
+  test_buffer_unbound();
+  test_geometry_shader_bound();
+  test_binding_tracked();
+  test_binding_matches_scan();
+  return 0;
+}
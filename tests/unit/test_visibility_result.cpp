@@ -0,0 +1,84 @@
+#include "dxmt_visibility_result.hpp"
+#include "test_utils.hpp"
+
+using namespace dxmt;
+
+static Rc<VisibilityResultQuery>
+makeQuery(uint64_t begin_seq, unsigned begin_offset, uint64_t end_seq, unsigned end_offset) {
+  Rc<VisibilityResultQuery> query = new VisibilityResultQuery();
+  query->begin(begin_seq, begin_offset);
+  query->end(end_seq, end_offset);
+  return query;
+}
+
+static uint64_t
+valueOf(Rc<VisibilityResultQuery> const &query) {
+  uint64_t value = ~0ull;
+  CHECK(query->getValue(&value));
+  return value;
+}
+
+static void
+test_empty() {
+  std::vector<uint64_t> prefix_sum;
+  // a chunk without any result still resolves queries that ended in it
+  auto query = makeQuery(1, 0, 1, 0);
+  ResolveVisibilityResults(1, nullptr, 0, {query}, prefix_sum);
+  CHECK_EQ(valueOf(query), 0);
+  CHECK_EQ(prefix_sum.size(), 1);
+
+  uint64_t results[] = {5, 6};
+  ResolveVisibilityResults(2, results, 2, {}, prefix_sum);
+  CHECK_EQ(prefix_sum[2], 11);
+}
+
+static void
+test_single() {
+  std::vector<uint64_t> prefix_sum;
+  uint64_t results[] = {3, 7, 11};
+  auto query = makeQuery(1, 1, 1, 2);
+  ResolveVisibilityResults(1, results, 3, {query}, prefix_sum);
+  CHECK_EQ(valueOf(query), 7);
+}
+
+static void
+test_overlapping() {
+  std::vector<uint64_t> prefix_sum;
+  uint64_t results[] = {1, 10, 100, 1000, 10000};
+  auto outer = makeQuery(1, 0, 1, 5);
+  auto left = makeQuery(1, 0, 1, 3);
+  auto right = makeQuery(1, 1, 1, 4);
+  auto inner = makeQuery(1, 2, 1, 3);
+  auto empty = makeQuery(1, 2, 1, 2);
+  ResolveVisibilityResults(1, results, 5, {outer, left, right, inner, empty}, prefix_sum);
+  CHECK_EQ(valueOf(outer), 11111);
+  CHECK_EQ(valueOf(left), 111);
+  CHECK_EQ(valueOf(right), 1110);
+  CHECK_EQ(valueOf(inner), 100);
+  CHECK_EQ(valueOf(empty), 0);
+}
+
+static void
+test_across_chunks() {
+  std::vector<uint64_t> prefix_sum;
+  uint64_t chunk1[] = {1, 2, 4};
+  uint64_t chunk3[] = {8, 16};
+  // begins at the last result of chunk 1, ends after the first result of chunk 3
+  auto query = makeQuery(1, 2, 3, 1);
+  uint64_t value;
+  ResolveVisibilityResults(1, chunk1, 3, {query}, prefix_sum);
+  CHECK(!query->getValue(&value));
+  ResolveVisibilityResults(2, nullptr, 0, {query}, prefix_sum);
+  CHECK(!query->getValue(&value));
+  ResolveVisibilityResults(3, chunk3, 2, {query}, prefix_sum);
+  CHECK_EQ(valueOf(query), 12);
+}
+
+int
+main() {
+  test_empty();
+  test_single();
+  test_overlapping();
+  test_across_chunks();
+  return 0;
+}